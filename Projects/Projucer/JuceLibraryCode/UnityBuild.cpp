@@ -4,6 +4,7 @@
 
 #include "../../Source/Core/Audio/BuiltIn/SoundFont/SoundFont2Sound.cpp"
 #include "../../Source/Core/Audio/BuiltIn/SoundFont/SoundFontSound.cpp"
+#include "../../Source/Core/Audio/BuiltIn/SoundFont/SoundFontSampleCache.cpp"
 #include "../../Source/Core/Audio/BuiltIn/SoundFont/SoundFontSynth.cpp"
 #include "../../Source/Core/Audio/BuiltIn/InternalIODevicesPluginFormat.cpp"
 #include "../../Source/Core/Audio/BuiltIn/BuiltInSynthsPluginFormat.cpp"
@@ -22,6 +23,7 @@
 #include "../../Source/Core/Audio/Transport/Transport.cpp"
 #include "../../Source/Core/Audio/AudioCore.cpp"
 #include "../../Source/Core/Audio/AudioMonitor.cpp"
+#include "../../Source/Core/Audio/ParallelAudioCallback.cpp"
 #include "../../Source/Core/Configuration/Resources/Models/Arpeggiator.cpp"
 #include "../../Source/Core/Configuration/Resources/Models/Chord.cpp"
 #include "../../Source/Core/Configuration/Resources/Models/ColourScheme.cpp"
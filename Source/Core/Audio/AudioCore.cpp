@@ -24,6 +24,7 @@
 #include "SoundFontSynthAudioPlugin.h"
 #include "SerializationKeys.h"
 #include "AudioMonitor.h"
+#include "ParallelAudioCallback.h"
 
 void AudioCore::initAudioFormats(AudioPluginFormatManager &formatManager)
 {
@@ -32,8 +33,98 @@ void AudioCore::initAudioFormats(AudioPluginFormatManager &formatManager)
     formatManager.addFormat(new BuiltInSynthsPluginFormat());
 }
 
+//===----------------------------------------------------------------------===//
+// MidiOutputForwarder
+//===----------------------------------------------------------------------===//
+
+// The instruments may be processed by the parallel render workers,
+// so they only push their MIDI output into their own queues; the queues
+// are drained here, in a device callback on the audio thread: the device
+// manager never swaps its default MIDI output while any callbacks are
+// running, so there's no need to synchronize with the message thread.
+// The forwarder is registered before the instruments, so the messages
+// are sent at the beginning of the next block.
+
+class AudioCore::MidiOutputForwarder final : public AudioIODeviceCallback
+{
+public:
+
+    explicit MidiOutputForwarder(AudioCore &audioCore) :
+        audioCore(audioCore) {}
+
+    void addSource(Instrument::AudioCallback *source)
+    {
+        {
+            const ScopedLock sl(this->sourcesLock);
+            this->sources.addIfNotAlreadyThere(source);
+        }
+
+        source->setForwardingMidiOutput(true);
+    }
+
+    void removeSource(Instrument::AudioCallback *source)
+    {
+        source->setForwardingMidiOutput(false);
+
+        const ScopedLock sl(this->sourcesLock);
+        this->sources.removeFirstMatchingValue(source);
+    }
+
+    void audioDeviceIOCallback(const float **, int,
+        float **outputChannelData, int numOutputChannels, int numSamples) override
+    {
+        // the callbacks are expected to overwrite the output
+        for (int i = 0; i < numOutputChannels; ++i)
+        {
+            FloatVectorOperations::clear(outputChannelData[i], numSamples);
+        }
+
+        // the sources are only changed on the message thread,
+        // so if it's busy doing that, just try again the next block
+        const ScopedTryLock sl(this->sourcesLock);
+        if (!sl.isLocked())
+        {
+            return;
+        }
+
+        auto *midiOutput = this->audioCore.getDevice().getDefaultMidiOutput();
+
+        MidiMessage message;
+        for (auto *source : this->sources)
+        {
+            // without the output device, the queues are just drained
+            while (source->popMidiOutputMessage(message))
+            {
+                if (midiOutput != nullptr)
+                {
+                    midiOutput->sendMessageNow(message);
+                }
+            }
+        }
+    }
+
+    void audioDeviceAboutToStart(AudioIODevice *) override {}
+    void audioDeviceStopped() override {}
+
+private:
+
+    AudioCore &audioCore;
+
+    Array<Instrument::AudioCallback *> sources;
+    CriticalSection sourcesLock;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiOutputForwarder)
+};
+
+//===----------------------------------------------------------------------===//
+// AudioCore
+//===----------------------------------------------------------------------===//
+
 AudioCore::AudioCore()
 {
+    this->midiOutputForwarder = make<MidiOutputForwarder>(*this);
+    this->deviceManager.addAudioCallback(this->midiOutputForwarder.get());
+
     this->audioMonitor = make<AudioMonitor>();
     this->deviceManager.addAudioCallback(this->audioMonitor.get());
     AudioCore::initAudioFormats(this->formatManager);
@@ -41,8 +132,20 @@ AudioCore::AudioCore()
 
 AudioCore::~AudioCore()
 {
+    DBG(this->getDspLoadReport());
+
+    this->deviceManager.removeAudioCallback(this->midiOutputForwarder.get());
+    this->midiOutputForwarder = nullptr;
+
     this->deviceManager.removeAudioCallback(this->audioMonitor.get());
     this->audioMonitor = nullptr;
+
+    if (this->parallelAudioCallback != nullptr)
+    {
+        this->deviceManager.removeAudioCallback(this->parallelAudioCallback.get());
+        this->parallelAudioCallback = nullptr;
+    }
+
     this->deviceManager.closeAudioDevice();
 }
 
@@ -61,6 +164,46 @@ AudioMonitor *AudioCore::getMonitor() const noexcept
     return this->audioMonitor.get();
 }
 
+//===----------------------------------------------------------------------===//
+// DSP load
+//===----------------------------------------------------------------------===//
+
+String AudioCore::getDspLoadReport() const
+{
+    String report;
+    report << "instrument,average %,max %,p99 %,blocks,overruns" << newLine;
+
+    for (auto *instrument : this->instruments)
+    {
+        const auto stats = instrument->getProcessorPlayer().getLoadStats().getSnapshot();
+
+        // the instrument name may contain commas
+        report << instrument->getName().quoted() << ","
+            << String(stats.average, 2) << ","
+            << String(stats.max, 2) << ","
+            << String(stats.p99, 2) << ","
+            << String(stats.numBlocks) << ","
+            << String(stats.numOverruns) << newLine;
+    }
+
+    // the device xruns go under the overruns column, the other fields are empty
+    report << "xruns,,,,," << String(this->audioMonitor->getNumXruns()) << newLine;
+    return report;
+}
+
+bool AudioCore::saveDspLoadReport(const File &file) const
+{
+    return file.replaceWithText(this->getDspLoadReport());
+}
+
+void AudioCore::resetDspLoadStats()
+{
+    for (auto *instrument : this->instruments)
+    {
+        instrument->getProcessorPlayer().getLoadStats().reset();
+    }
+}
+
 //===----------------------------------------------------------------------===//
 // Instruments
 //===----------------------------------------------------------------------===//
@@ -184,12 +327,31 @@ void AudioCore::removeInstrumentFromMidiDevice(Instrument *instrument)
 
 void AudioCore::addInstrumentToAudioDevice(Instrument *instrument)
 {
-    this->deviceManager.addAudioCallback(&instrument->getProcessorPlayer());
+    instrument->getProcessorPlayer().setIdleHangover(this->idleInstrumentsHangoverMs);
+    this->midiOutputForwarder->addSource(&instrument->getProcessorPlayer());
+
+    if (this->parallelAudioCallback != nullptr)
+    {
+        this->parallelAudioCallback->addCallback(&instrument->getProcessorPlayer());
+    }
+    else
+    {
+        this->deviceManager.addAudioCallback(&instrument->getProcessorPlayer());
+    }
 }
 
 void AudioCore::removeInstrumentFromAudioDevice(Instrument *instrument)
 {
-    this->deviceManager.removeAudioCallback(&instrument->getProcessorPlayer());
+    this->midiOutputForwarder->removeSource(&instrument->getProcessorPlayer());
+
+    if (this->parallelAudioCallback != nullptr)
+    {
+        this->parallelAudioCallback->removeCallback(&instrument->getProcessorPlayer());
+    }
+    else
+    {
+        this->deviceManager.removeAudioCallback(&instrument->getProcessorPlayer());
+    }
 }
 
 void AudioCore::resetActiveMidiPlayer()
@@ -263,6 +425,63 @@ void AudioCore::reconnectAllAudioCallbacks()
     }
 }
 
+bool AudioCore::isProcessingInParallel() const noexcept
+{
+    return this->parallelAudioCallback != nullptr;
+}
+
+void AudioCore::setProcessingInParallel(bool isOn)
+{
+    if (this->isProcessingInParallel() == isOn)
+    {
+        return;
+    }
+
+    // when muted, the instruments will be added back by reconnectAllAudioCallbacks
+    const bool shouldReconnect = !this->isMuted.get();
+    if (shouldReconnect)
+    {
+        for (auto *instrument : this->instruments)
+        {
+            this->removeInstrumentFromAudioDevice(instrument);
+        }
+    }
+
+    if (isOn)
+    {
+        this->parallelAudioCallback = make<ParallelAudioCallback>();
+        this->deviceManager.addAudioCallback(this->parallelAudioCallback.get());
+    }
+    else
+    {
+        this->deviceManager.removeAudioCallback(this->parallelAudioCallback.get());
+        this->parallelAudioCallback = nullptr;
+    }
+
+    if (shouldReconnect)
+    {
+        for (auto *instrument : this->instruments)
+        {
+            this->addInstrumentToAudioDevice(instrument);
+        }
+    }
+}
+
+int AudioCore::getIdleInstrumentsHangover() const noexcept
+{
+    return this->idleInstrumentsHangoverMs;
+}
+
+void AudioCore::setIdleInstrumentsHangover(int milliseconds)
+{
+    this->idleInstrumentsHangoverMs = jmax(0, milliseconds);
+
+    for (auto *instrument : this->instruments)
+    {
+        instrument->getProcessorPlayer().setIdleHangover(this->idleInstrumentsHangoverMs);
+    }
+}
+
 //===----------------------------------------------------------------------===//
 // OrchestraPit
 //===----------------------------------------------------------------------===//
@@ -511,6 +730,16 @@ SerializedData AudioCore::serializeDeviceManager() const
     tree.setProperty(Audio::midiInputReadjusting,
         this->isReadjustingMidiInput.get());
 
+    if (this->isProcessingInParallel())
+    {
+        tree.setProperty(Audio::parallelProcessing, true);
+    }
+
+    if (this->idleInstrumentsHangoverMs > 0)
+    {
+        tree.setProperty(Audio::idleInstrumentsHangover, this->idleInstrumentsHangoverMs);
+    }
+
     if (auto *midiOutput = this->deviceManager.getDefaultMidiOutput())
     {
         tree.setProperty(Audio::midiOutputName, midiOutput->getName());
@@ -588,6 +817,9 @@ void AudioCore::deserializeDeviceManager(const SerializedData &tree)
 
     this->isReadjustingMidiInput = root.getProperty(Audio::midiInputReadjusting,
         this->isReadjustingMidiInput.get());
+
+    this->setProcessingInParallel(root.getProperty(Audio::parallelProcessing, false));
+    this->setIdleInstrumentsHangover(root.getProperty(Audio::idleInstrumentsHangover, 0));
     
     // first, try to match by device id; if failed, search by name
     bool hasFoundMidiInById = false;
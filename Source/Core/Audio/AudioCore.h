@@ -18,6 +18,7 @@
 #pragma once
 
 class AudioMonitor;
+class ParallelAudioCallback;
 
 #include "Instrument.h"
 #include "OrchestraPit.h"
@@ -43,6 +44,17 @@ public:
     void disconnectAllAudioCallbacks();
     void reconnectAllAudioCallbacks();
 
+    // when enabled, the instruments are processed by a pool of worker threads
+    // under one device callback, instead of being called one by one:
+    bool isProcessingInParallel() const noexcept;
+    void setProcessingInParallel(bool isOn);
+
+    // how long the instruments stay awake after the last MIDI event and
+    // the last non-silent block, see Instrument::AudioCallback::setIdleHangover;
+    // zero, the default, means the instruments are never put to sleep
+    int getIdleInstrumentsHangover() const noexcept;
+    void setIdleInstrumentsHangover(int milliseconds);
+
     //===------------------------------------------------------------------===//
     // OrchestraPit
     //===------------------------------------------------------------------===//
@@ -80,6 +92,16 @@ public:
     AudioPluginFormatManager &getFormatManager() noexcept;
     AudioMonitor *getMonitor() const noexcept;
 
+    //===------------------------------------------------------------------===//
+    // DSP load
+    //===------------------------------------------------------------------===//
+
+    // the per-instrument processing time stats and the xrun count as CSV,
+    // for offline analysis; the percents are of the buffer duration
+    String getDspLoadReport() const;
+    bool saveDspLoadReport(const File &file) const;
+    void resetDspLoadStats();
+
     //===------------------------------------------------------------------===//
     // MIDI input/output
     //===------------------------------------------------------------------===//
@@ -121,6 +143,13 @@ private:
     WeakReference<Instrument> midiOutputInstrument;
 
     UniquePointer<AudioMonitor> audioMonitor;
+    UniquePointer<ParallelAudioCallback> parallelAudioCallback;
+    int idleInstrumentsHangoverMs = 0;
+
+    // sends the MIDI produced by the instruments to the MIDI output device,
+    // so that the instruments only have to push it into their queues:
+    class MidiOutputForwarder;
+    UniquePointer<MidiOutputForwarder> midiOutputForwarder;
 
     AudioPluginFormatManager formatManager;
     AudioDeviceManager deviceManager;
@@ -59,48 +59,236 @@ private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OversaturationWarningAsyncCallback)
 };
 
+//===----------------------------------------------------------------------===//
+// SpectrumFft
+//===----------------------------------------------------------------------===//
+
+// A plain iterative radix-2 FFT of the windowed real input,
+// with the twiddles and the window precomputed; not thread-safe,
+// since it's only supposed to be used by getSpectrum()
+class AudioMonitor::SpectrumFft final
+{
+public:
+
+    SpectrumFft()
+    {
+        this->window.malloc(size);
+        for (int i = 0; i < size; ++i)
+        {
+            // the Hann window
+            this->window[i] = 0.5f - 0.5f *
+                cosf(MathConstants<float>::twoPi * float(i) / float(size - 1));
+        }
+
+        this->cosines.malloc(size / 2);
+        this->sines.malloc(size / 2);
+        for (int i = 0; i < size / 2; ++i)
+        {
+            const auto angle = -MathConstants<double>::twoPi * double(i) / double(size);
+            this->cosines[i] = float(cos(angle));
+            this->sines[i] = float(sin(angle));
+        }
+
+        this->real.malloc(size);
+        this->imaginary.malloc(size);
+    }
+
+    // the input is expected to have size samples,
+    // and the output gets size / 2 magnitudes in decibels
+    void perform(const float *input, float *magnitudesInDecibels) noexcept
+    {
+        for (int i = 0; i < size; ++i)
+        {
+            const auto j = SpectrumFft::reverseBits(i);
+            this->real[j] = input[i] * this->window[i];
+            this->imaginary[j] = 0.f;
+        }
+
+        for (int halfSize = 1, twiddleStep = size / 2;
+            halfSize < size; halfSize *= 2, twiddleStep /= 2)
+        {
+            for (int start = 0; start < size; start += halfSize * 2)
+            {
+                for (int k = 0; k < halfSize; ++k)
+                {
+                    const auto c = this->cosines[k * twiddleStep];
+                    const auto s = this->sines[k * twiddleStep];
+                    const auto a = start + k;
+                    const auto b = a + halfSize;
+                    const auto re = this->real[b] * c - this->imaginary[b] * s;
+                    const auto im = this->real[b] * s + this->imaginary[b] * c;
+                    this->real[b] = this->real[a] - re;
+                    this->imaginary[b] = this->imaginary[a] - im;
+                    this->real[a] += re;
+                    this->imaginary[a] += im;
+                }
+            }
+        }
+
+        // the Hann window halves the amplitude, and a full-scale sine
+        // spreads its energy between the positive and the negative bins
+        constexpr auto normalization = 4.f / float(size);
+        for (int i = 0; i < size / 2; ++i)
+        {
+            const auto magnitude = normalization *
+                sqrtf(this->real[i] * this->real[i] + this->imaginary[i] * this->imaginary[i]);
+            magnitudesInDecibels[i] = Decibels::gainToDecibels(magnitude);
+        }
+    }
+
+private:
+
+    static constexpr auto order = AudioMonitor::spectrumFftOrder;
+    static constexpr auto size = AudioMonitor::spectrumFftSize;
+
+    static inline int reverseBits(int value) noexcept
+    {
+        int result = 0;
+        for (int i = 0; i < order; ++i)
+        {
+            result = (result << 1) | (value & 1);
+            value >>= 1;
+        }
+
+        return result;
+    }
+
+    HeapBlock<float> window;
+    HeapBlock<float> cosines;
+    HeapBlock<float> sines;
+    HeapBlock<float> real;
+    HeapBlock<float> imaginary;
+
+    JUCE_DECLARE_NON_COPYABLE(SpectrumFft)
+};
+
+//===----------------------------------------------------------------------===//
+// AudioMonitor
+//===----------------------------------------------------------------------===//
+
 AudioMonitor::AudioMonitor()
 {
     this->asyncClippingWarning = make<ClippingWarningAsyncCallback>(*this);
     this->asyncOversaturationWarning = make<OversaturationWarningAsyncCallback>(*this);
+
+    this->spectrumRing.calloc(AudioMonitor::spectrumRingSize);
+
+    // the polyphase interpolation filter for the true peak detection:
+    // a Blackman-windowed sinc with the cutoff at the original Nyquist,
+    // with each phase normalized to the unity gain
+    constexpr auto numTaps = truePeakOversampling * truePeakTapsPerPhase;
+    for (int phase = 0; phase < truePeakOversampling; ++phase)
+    {
+        float sum = 0.f;
+        for (int tap = 0; tap < truePeakTapsPerPhase; ++tap)
+        {
+            const auto n = double(phase + tap * truePeakOversampling);
+            const auto x = (n - double(numTaps - 1) / 2.0) / double(truePeakOversampling);
+            const auto sinc = (x == 0.0) ? 1.0 :
+                sin(MathConstants<double>::pi * x) / (MathConstants<double>::pi * x);
+            const auto window = 0.42 -
+                0.5 * cos(MathConstants<double>::twoPi * n / double(numTaps - 1)) +
+                0.08 * cos(2.0 * MathConstants<double>::twoPi * n / double(numTaps - 1));
+
+            this->truePeakCoefficients[phase][tap] = float(sinc * window);
+            sum += this->truePeakCoefficients[phase][tap];
+        }
+
+        for (auto &coefficient : this->truePeakCoefficients[phase])
+        {
+            coefficient /= sum;
+        }
+    }
 }
 
+AudioMonitor::~AudioMonitor() = default;
+
 //===----------------------------------------------------------------------===//
 // AudioIODeviceCallback
 //===----------------------------------------------------------------------===//
 
-static inline float sqrtBithack(float value) noexcept
+static inline float getSumOfSquares(const float *data, int numSamples) noexcept
 {
-    auto x = bitCast<uint32_t, float>(value);
-    x = ((1 << 29) - (1 << 22)) + (x >> 1);
-    return bitCast<float, uint32_t>(x);
+    int i = 0;
+    float sum = 0.f;
+
+#if JUCE_USE_SSE_INTRINSICS
+
+    auto accumulator = _mm_setzero_ps();
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        const auto x = _mm_loadu_ps(data + i);
+        accumulator = _mm_add_ps(accumulator, _mm_mul_ps(x, x));
+    }
+
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, accumulator);
+    sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+
+#elif JUCE_USE_ARM_NEON
+
+    auto accumulator = vdupq_n_f32(0.f);
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        const auto x = vld1q_f32(data + i);
+        accumulator = vmlaq_f32(accumulator, x, x);
+    }
+
+    sum = (vgetq_lane_f32(accumulator, 0) + vgetq_lane_f32(accumulator, 1)) +
+        (vgetq_lane_f32(accumulator, 2) + vgetq_lane_f32(accumulator, 3));
+
+#endif
+
+    for (; i < numSamples; ++i)
+    {
+        sum += data[i] * data[i];
+    }
+
+    return sum;
 }
 
 void AudioMonitor::audioDeviceAboutToStart(AudioIODevice *device)
 {
     this->sampleRate = device->getCurrentSampleRate();
+    this->currentDevice = device;
+    this->lastDeviceXrunCount = jmax(0, device->getXRunCount());
+    this->lastCallbackTicks = 0;
+}
+
+void AudioMonitor::audioDeviceStopped()
+{
+    this->currentDevice = nullptr;
 }
 
 void AudioMonitor::audioDeviceIOCallback(const float **inputChannelData, int numInputChannels,
     float **outputChannelData, int numOutputChannels, int numSamples)
 {
+    this->updateXruns(numSamples);
+
     const int minNumChannels = jmin(AudioMonitor::numChannels, numOutputChannels);
-    
+    if (numSamples <= 0)
+    {
+        return;
+    }
+
+    const bool shouldDetectTruePeak = this->isTruePeakEnabled.get();
+
+    HistoryFrame historyFrame = {};
+    historyFrame.numSamples = numSamples;
+
     for (int channel = 0; channel < minNumChannels; ++channel)
     {
-        float pcmSquaresSum = 0.f;
-        float pcmPeak = 0.f;
-        for (int samplePosition = 0; samplePosition < numSamples; ++samplePosition)
-        {
-            const float &pcmData = outputChannelData[channel][samplePosition];
-            pcmSquaresSum += (pcmData * pcmData);
-            pcmPeak = jmax(pcmPeak, pcmData);
-        }
-        
-        const float rootMeanSquare = sqrtBithack(pcmSquaresSum / numSamples);
+        const auto *pcmData = outputChannelData[channel];
+        const auto pcmRange = FloatVectorOperations::findMinAndMax(pcmData, numSamples);
+        const float pcmPeak = jmax(-pcmRange.getStart(), pcmRange.getEnd());
+
+        const float rootMeanSquare = sqrtf(getSumOfSquares(pcmData, numSamples) / float(numSamples));
         this->rms[channel] = rootMeanSquare;
         this->peak[channel] = pcmPeak;
-        
+        const float truePeak = shouldDetectTruePeak ?
+            jmax(pcmPeak, this->updateTruePeak(channel, pcmData, numSamples)) : pcmPeak;
+        historyFrame.channels[channel] = { pcmRange.getStart(), pcmRange.getEnd(), rootMeanSquare, truePeak };
+
         if (pcmPeak > AudioMonitor::clipThreshold)
         {
             this->asyncClippingWarning->triggerAsyncUpdate();
@@ -113,12 +301,60 @@ void AudioMonitor::audioDeviceIOCallback(const float **inputChannelData, int num
         }
     }
 
+    this->writeHistory(historyFrame);
+
+    this->writeSpectrumRing(const_cast<const float **>(outputChannelData),
+        minNumChannels, numSamples);
+
     for (int i = 0; i < numOutputChannels; ++i)
     {
         FloatVectorOperations::clear(outputChannelData[i], numSamples);
     }
 }
 
+//===----------------------------------------------------------------------===//
+// Xruns
+//===----------------------------------------------------------------------===//
+
+int64 AudioMonitor::getNumXruns() const noexcept
+{
+    return this->numXruns.get();
+}
+
+void AudioMonitor::updateXruns(int numSamples) noexcept
+{
+    const auto currentTicks = Time::getHighResolutionTicks();
+    const auto previousTicks = this->lastCallbackTicks;
+    this->lastCallbackTicks = currentTicks;
+
+    const auto deviceXrunCount = this->currentDevice != nullptr ?
+        this->currentDevice->getXRunCount() : -1;
+
+    if (deviceXrunCount >= 0)
+    {
+        if (deviceXrunCount > this->lastDeviceXrunCount)
+        {
+            this->numXruns = this->numXruns.get() + (deviceXrunCount - this->lastDeviceXrunCount);
+        }
+
+        this->lastDeviceXrunCount = deviceXrunCount;
+        return;
+    }
+
+    // the device doesn't report xruns, so let's guess: the callbacks
+    // are expected to come once per block, so a much longer gap
+    // means that some block hasn't been delivered in time
+    if (previousTicks > 0)
+    {
+        const auto blockDuration = double(numSamples) / this->sampleRate.get();
+        const auto gapDuration = Time::highResolutionTicksToSeconds(currentTicks - previousTicks);
+        if (gapDuration > blockDuration * 1.5)
+        {
+            this->numXruns = this->numXruns.get() + 1;
+        }
+    }
+}
+
 //===----------------------------------------------------------------------===//
 // Clipping data
 //===----------------------------------------------------------------------===//
@@ -151,3 +387,271 @@ float AudioMonitor::getRootMeanSquare(int channel) const
 {
     return this->rms[channel].get();
 }
+
+void AudioMonitor::setTruePeakEnabled(bool isEnabled) noexcept
+{
+    this->isTruePeakEnabled = isEnabled;
+}
+
+float AudioMonitor::updateTruePeak(int channel, const float *data, int numSamples) noexcept
+{
+    auto *history = this->truePeakHistory[channel];
+    auto position = this->truePeakHistoryPosition[channel];
+
+    float result = 0.f;
+    for (int i = 0; i < numSamples; ++i)
+    {
+        // the newest sample goes first, followed by the older ones
+        position = (position == 0 ? truePeakTapsPerPhase : position) - 1;
+        history[position] = data[i];
+        history[position + truePeakTapsPerPhase] = data[i];
+
+        const auto *taps = history + position;
+        for (const auto &coefficients : this->truePeakCoefficients)
+        {
+            float sample = 0.f;
+            for (int tap = 0; tap < truePeakTapsPerPhase; ++tap)
+            {
+                sample += coefficients[tap] * taps[tap];
+            }
+
+            result = jmax(result, fabsf(sample));
+        }
+    }
+
+    this->truePeakHistoryPosition[channel] = position;
+    return result;
+}
+
+//===----------------------------------------------------------------------===//
+// History
+//===----------------------------------------------------------------------===//
+
+void AudioMonitor::writeHistory(const HistoryFrame &frame) noexcept
+{
+    const auto end = this->historyEnd.get();
+    this->history[end & AudioMonitor::historyMask] = frame;
+    this->historyEnd = end + 1;
+}
+
+int AudioMonitor::readHistory(int64 &readPosition,
+    HistoryFrame *destination, int maxNumFrames) const noexcept
+{
+    // like in getSpectrum, the audio thread is very unlikely to overwrite
+    // the frames being copied here, and even if it does, it's just a glitch
+    const auto end = this->historyEnd.get();
+    const auto oldestReadable = end - (AudioMonitor::historySize - AudioMonitor::historyReadMargin);
+    const auto start = jlimit(jmax(int64(0), oldestReadable), end, readPosition);
+    const auto numFrames = int(jmin(int64(maxNumFrames), end - start));
+
+    for (int i = 0; i < numFrames; ++i)
+    {
+        destination[i] = this->history[(start + i) & AudioMonitor::historyMask];
+    }
+
+    readPosition = start + numFrames;
+    return numFrames;
+}
+
+int64 AudioMonitor::getHistoryEnd() const noexcept
+{
+    return this->historyEnd.get();
+}
+
+//===----------------------------------------------------------------------===//
+// Spectrum
+//===----------------------------------------------------------------------===//
+
+void AudioMonitor::writeSpectrumRing(const float **channelData,
+    int numChannels, int numSamples) noexcept
+{
+    if (numChannels == 0)
+    {
+        return;
+    }
+
+    const auto gain = 1.f / float(numChannels);
+    auto position = this->spectrumRingPosition.get();
+
+    int samplesWritten = 0;
+    while (samplesWritten < numSamples)
+    {
+        const auto chunkSize = jmin(numSamples - samplesWritten,
+            AudioMonitor::spectrumRingSize - position);
+
+        auto *destination = this->spectrumRing.getData() + position;
+        FloatVectorOperations::copyWithMultiply(destination,
+            channelData[0] + samplesWritten, gain, chunkSize);
+
+        for (int channel = 1; channel < numChannels; ++channel)
+        {
+            FloatVectorOperations::addWithMultiply(destination,
+                channelData[channel] + samplesWritten, gain, chunkSize);
+        }
+
+        samplesWritten += chunkSize;
+        position = (position + chunkSize) % AudioMonitor::spectrumRingSize;
+    }
+
+    this->spectrumRingPosition = position;
+}
+
+void AudioMonitor::getSpectrum(float *magnitudesInDecibels)
+{
+    if (this->spectrumFft == nullptr)
+    {
+        this->spectrumFft = make<SpectrumFft>();
+    }
+
+    // the ring is a few times larger than the window, so the audio thread
+    // is very unlikely to overwrite the samples being copied here,
+    // and even if it does, it's just a glitch in the visualization
+    float input[AudioMonitor::spectrumFftSize];
+    const auto end = this->spectrumRingPosition.get();
+    const auto start = (end - AudioMonitor::spectrumFftSize +
+        AudioMonitor::spectrumRingSize) % AudioMonitor::spectrumRingSize;
+
+    const auto firstChunkSize = jmin(AudioMonitor::spectrumFftSize,
+        AudioMonitor::spectrumRingSize - start);
+
+    FloatVectorOperations::copy(input,
+        this->spectrumRing.getData() + start, firstChunkSize);
+
+    FloatVectorOperations::copy(input + firstChunkSize,
+        this->spectrumRing.getData(), AudioMonitor::spectrumFftSize - firstChunkSize);
+
+    this->spectrumFft->perform(input, magnitudesInDecibels);
+}
+
+//===----------------------------------------------------------------------===//
+// Tests
+//===----------------------------------------------------------------------===//
+
+#if JUCE_UNIT_TESTS
+
+class AudioMonitorTests final : public UnitTest
+{
+public:
+
+    AudioMonitorTests() :
+        UnitTest("Audio monitor tests", UnitTestCategories::helio) {}
+
+    void runTest() override
+    {
+        constexpr auto blockSize = 512;
+
+        beginTest("A full-scale sine in the middle of a bin");
+
+        {
+            AudioMonitor monitor;
+
+            constexpr auto bin = 100;
+            AudioBuffer<float> sine(AudioMonitor::numChannels, AudioMonitor::spectrumFftSize);
+            for (int i = 0; i < AudioMonitor::spectrumFftSize; ++i)
+            {
+                const auto sample = float(std::sin(MathConstants<double>::twoPi *
+                    double(bin * i) / double(AudioMonitor::spectrumFftSize)));
+
+                sine.setSample(0, i, sample);
+                sine.setSample(1, i, sample);
+            }
+
+            for (int i = 0; i < AudioMonitor::spectrumFftSize; i += blockSize)
+            {
+                this->render(monitor, sine, i, blockSize);
+            }
+
+            float spectrum[AudioMonitor::spectrumSize];
+            monitor.getSpectrum(spectrum);
+
+            const auto loudestBin = int(std::max_element(spectrum,
+                spectrum + AudioMonitor::spectrumSize) - spectrum);
+
+            expectEquals(loudestBin, bin);
+            expectWithinAbsoluteError(spectrum[bin], 0.f, 0.1f);
+            // the Hann window leaks into the adjacent bins only
+            expect(spectrum[bin + 3] < -40.f);
+        }
+
+        beginTest("An inter-sample peak is detected");
+
+        {
+            AudioMonitor monitor;
+            monitor.setTruePeakEnabled(true);
+
+            // a quarter of the sample rate, shifted by 45 degrees,
+            // so that the samples never hit the peaks of the sine
+            AudioBuffer<float> sine(AudioMonitor::numChannels, blockSize);
+            for (int i = 0; i < blockSize; ++i)
+            {
+                const auto sample = float(std::sin(MathConstants<double>::halfPi * double(i) +
+                    MathConstants<double>::pi / 4.0));
+
+                sine.setSample(0, i, sample);
+                sine.setSample(1, i, sample);
+            }
+
+            // the first block just fills the interpolation filter
+            this->render(monitor, sine, 0, blockSize);
+            this->render(monitor, sine, 0, blockSize);
+
+            const auto frame = this->readLastFrame(monitor);
+            const auto samplePeak = jmax(-frame.channels[0].min, frame.channels[0].max);
+            expectWithinAbsoluteError(samplePeak, MathConstants<float>::sqrt2 / 2.f, 0.001f);
+            expect(frame.channels[0].truePeak > samplePeak + 0.2f);
+            expectWithinAbsoluteError(frame.channels[0].truePeak, 1.f, 0.1f);
+        }
+
+        beginTest("The peak of a negative-only block");
+
+        {
+            AudioMonitor monitor;
+
+            AudioBuffer<float> negative(AudioMonitor::numChannels, blockSize);
+            negative.clear();
+            for (int i = 0; i < blockSize; ++i)
+            {
+                negative.setSample(0, i, -0.5f);
+                negative.setSample(1, i, -0.25f);
+            }
+
+            negative.setSample(0, blockSize / 2, -0.8f);
+
+            this->render(monitor, negative, 0, blockSize);
+
+            expectEquals(monitor.getPeak(0), 0.8f);
+            expectEquals(monitor.getPeak(1), 0.25f);
+
+            const auto frame = this->readLastFrame(monitor);
+            expectEquals(frame.channels[0].truePeak, 0.8f);
+            expectEquals(frame.channels[1].truePeak, 0.25f);
+        }
+    }
+
+private:
+
+    // the monitor clears the output after reading it, so it gets a copy
+    void render(AudioMonitor &monitor, const AudioBuffer<float> &source, int start, int numSamples)
+    {
+        AudioBuffer<float> output(source.getNumChannels(), numSamples);
+        for (int channel = 0; channel < source.getNumChannels(); ++channel)
+        {
+            output.copyFrom(channel, 0, source, channel, start, numSamples);
+        }
+
+        monitor.audioDeviceIOCallback(nullptr, 0, output.getArrayOfWritePointers(),
+            output.getNumChannels(), numSamples);
+    }
+
+    AudioMonitor::HistoryFrame readLastFrame(AudioMonitor &monitor)
+    {
+        AudioMonitor::HistoryFrame frame = {};
+        int64 readPosition = monitor.getHistoryEnd() - 1;
+        expectEquals(monitor.readHistory(readPosition, &frame, 1), 1);
+        return frame;
+    }
+};
+
+static AudioMonitorTests audioMonitorTests;
+
+#endif
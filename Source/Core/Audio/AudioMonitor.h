@@ -20,8 +20,11 @@
 class AudioMonitor final : public AudioIODeviceCallback
 {
 public:
-    
+
+    static constexpr auto numChannels = 2;
+
     AudioMonitor();
+    ~AudioMonitor() override;
 
     //===------------------------------------------------------------------===//
     // AudioIODeviceCallback
@@ -30,7 +33,7 @@ public:
     void audioDeviceAboutToStart(AudioIODevice *device) override;
     void audioDeviceIOCallback(const float **inputChannelData, int numInputChannels,
         float **outputChannelData, int numOutputChannels, int numSamples) override;
-    void audioDeviceStopped() override {}
+    void audioDeviceStopped() override;
     
     //===------------------------------------------------------------------===//
     // Clipping warnings
@@ -53,12 +56,69 @@ public:
     // Volume data
     //===------------------------------------------------------------------===//
     
+    // the absolute sample peak and the true RMS of the last block
     float getPeak(int channel) const;
     float getRootMeanSquare(int channel) const;
+
+    // the peak between the samples, estimated with 4x oversampling,
+    // which is not free, so it's disabled by default, and the history
+    // gets the sample peak instead; the waveform monitors enable it
+    void setTruePeakEnabled(bool isEnabled) noexcept;
+
+    //===------------------------------------------------------------------===//
+    // Spectrum
+    //===------------------------------------------------------------------===//
+
+    static constexpr auto spectrumFftOrder = 11;
+    static constexpr auto spectrumFftSize = 1 << spectrumFftOrder;
+    static constexpr auto spectrumSize = spectrumFftSize / 2;
+
+    // the audio thread only writes the output, mixed to mono, into a ring buffer,
+    // and the analysis runs on the calling thread, which is expected to be
+    // the message thread; fills spectrumSize magnitudes in decibels
+    // of the latest spectrumFftSize samples, evenly spaced up to Nyquist
+    void getSpectrum(float *magnitudesInDecibels);
+
+    //===------------------------------------------------------------------===//
+    // Xruns
+    //===------------------------------------------------------------------===//
+
+    // the total number of buffer under/overruns since the app start,
+    // as reported by the device, or, if the device can't tell,
+    // estimated by the gaps between the callbacks
+    int64 getNumXruns() const noexcept;
         
+    //===------------------------------------------------------------------===//
+    // History
+    //===------------------------------------------------------------------===//
+
+    struct HistoryFrame final
+    {
+        struct Channel final
+        {
+            float min;
+            float max;
+            float rms;
+            // the absolute peak, including the inter-sample one, if enabled
+            float truePeak;
+        };
+
+        Channel channels[numChannels];
+        int numSamples;
+    };
+
+    // each audio block adds a frame into the ring, which is never drained:
+    // any number of readers, e.g. the waveforms of all open projects, keep
+    // their own read positions, so each of them sees every block since its
+    // last read; the readers which fall behind the ring skip the oldest frames;
+    // returns the number of frames read and advances the read position
+    int readHistory(int64 &readPosition, HistoryFrame *destination, int maxNumFrames) const noexcept;
+
+    // the position after the latest frame, to start reading from
+    int64 getHistoryEnd() const noexcept;
+
 private:
 
-    static constexpr auto numChannels = 2;
     static constexpr auto defaultSampleRate = 44100;
     static constexpr auto clipThreshold = 0.995f;
     static constexpr auto oversaturationThreshold = 0.5f;
@@ -67,8 +127,43 @@ private:
     Atomic<float> peak[numChannels];
     Atomic<float> rms[numChannels];
 
+    static constexpr auto truePeakOversampling = 4;
+    static constexpr auto truePeakTapsPerPhase = 12;
+    float truePeakCoefficients[truePeakOversampling][truePeakTapsPerPhase] = {};
+    // the history of each channel is stored twice in a row,
+    // so that the last truePeakTapsPerPhase samples are always contiguous
+    float truePeakHistory[numChannels][truePeakTapsPerPhase * 2] = {};
+    int truePeakHistoryPosition[numChannels] = {};
+    float updateTruePeak(int channel, const float *data, int numSamples) noexcept;
+
+    static constexpr auto historySize = 1024;
+    static constexpr auto historyMask = int64(historySize - 1);
+    // the oldest frames may be being overwritten, so the readers don't read them
+    static constexpr auto historyReadMargin = 256;
+    HistoryFrame history[historySize];
+    // the total number of frames written, only incremented by the audio thread
+    Atomic<int64> historyEnd = 0;
+    void writeHistory(const HistoryFrame &frame) noexcept;
+
+    Atomic<bool> isTruePeakEnabled = false;
+
+    static constexpr auto spectrumRingSize = spectrumFftSize * 4;
+    HeapBlock<float> spectrumRing;
+    // always points to the next sample to be written, within the ring size
+    Atomic<int> spectrumRingPosition = 0;
+    void writeSpectrumRing(const float **channelData, int numChannels, int numSamples) noexcept;
+
+    class SpectrumFft;
+    UniquePointer<SpectrumFft> spectrumFft;
+
     Atomic<double> sampleRate = defaultSampleRate;
 
+    AudioIODevice *currentDevice = nullptr;
+    Atomic<int64> numXruns = 0;
+    int lastDeviceXrunCount = 0;
+    int64 lastCallbackTicks = 0;
+    void updateXruns(int numSamples) noexcept;
+
     ListenerList<ClippingListener> clippingListeners;
 
     UniquePointer<AsyncUpdater> asyncClippingWarning;
@@ -19,6 +19,143 @@
 #include "DefaultSynth.h"
 #include "KeyboardMapping.h"
 
+//===----------------------------------------------------------------------===//
+// Envelope
+//===----------------------------------------------------------------------===//
+
+void DefaultSynth::Envelope::setParameters(const ADSR::Parameters &newParameters) noexcept
+{
+    this->parameters = newParameters;
+    this->updateRates();
+}
+
+void DefaultSynth::Envelope::setSampleRate(double newSampleRate) noexcept
+{
+    this->sampleRate = newSampleRate;
+    this->updateRates();
+}
+
+void DefaultSynth::Envelope::updateRates() noexcept
+{
+    const auto getRate = [this](float distance, float timeInSeconds)
+    {
+        return timeInSeconds > 0.f ?
+            float(distance / (timeInSeconds * this->sampleRate)) : -1.f;
+    };
+
+    this->attackRate = getRate(1.f, this->parameters.attack);
+    this->decayRate = getRate(1.f - this->parameters.sustain, this->parameters.decay);
+    this->releaseRate = getRate(this->parameters.sustain, this->parameters.release);
+}
+
+void DefaultSynth::Envelope::noteOn() noexcept
+{
+    if (this->attackRate > 0.f)
+    {
+        this->state = State::Attack;
+    }
+    else if (this->decayRate > 0.f)
+    {
+        this->level = 1.f;
+        this->state = State::Decay;
+    }
+    else
+    {
+        this->level = this->parameters.sustain;
+        this->state = State::Sustain;
+    }
+}
+
+void DefaultSynth::Envelope::noteOff() noexcept
+{
+    if (this->state == State::Idle)
+    {
+        return;
+    }
+
+    if (this->parameters.release > 0.f && this->level > 0.f)
+    {
+        this->releaseRate = float(this->level / (this->parameters.release * this->sampleRate));
+        this->state = State::Release;
+    }
+    else
+    {
+        this->level = 0.f;
+        this->state = State::Idle;
+    }
+}
+
+int DefaultSynth::Envelope::render(float *destination, int numSamples) noexcept
+{
+    // moves the level linearly towards the target, like juce::ADSR does
+    // sample by sample, and returns the number of samples written
+    const auto ramp = [this](float *output, int maxSamples, float delta, float target, bool &reachedTarget)
+    {
+        const auto numSamplesToTarget = jmax(1, int(std::ceil((target - this->level) / delta)));
+        const auto numSamplesToRender = jmin(maxSamples, numSamplesToTarget);
+
+        for (int i = 0; i < numSamplesToRender; ++i)
+        {
+            output[i] = this->level + delta * float(i + 1);
+        }
+
+        reachedTarget = numSamplesToRender == numSamplesToTarget;
+        if (reachedTarget)
+        {
+            output[numSamplesToRender - 1] = target;
+        }
+
+        this->level = output[numSamplesToRender - 1];
+        return numSamplesToRender;
+    };
+
+    int position = 0;
+    bool reachedTarget = false;
+    while (position < numSamples)
+    {
+        auto *output = destination + position;
+        const auto samplesLeft = numSamples - position;
+
+        switch (this->state)
+        {
+        case State::Idle:
+            return position;
+
+        case State::Attack:
+            position += ramp(output, samplesLeft, this->attackRate, 1.f, reachedTarget);
+            if (reachedTarget)
+            {
+                this->state = this->decayRate > 0.f ? State::Decay : State::Sustain;
+            }
+            break;
+
+        case State::Decay:
+            position += ramp(output, samplesLeft, -this->decayRate, this->parameters.sustain, reachedTarget);
+            if (reachedTarget)
+            {
+                this->state = State::Sustain;
+            }
+            break;
+
+        case State::Sustain:
+            this->level = this->parameters.sustain;
+            FloatVectorOperations::fill(output, this->level, samplesLeft);
+            position = numSamples;
+            break;
+
+        case State::Release:
+            position += ramp(output, samplesLeft, -this->releaseRate, 0.f, reachedTarget);
+            if (reachedTarget)
+            {
+                this->state = State::Idle;
+            }
+            break;
+        }
+    }
+
+    return position;
+}
+
 //===----------------------------------------------------------------------===//
 // Voice
 //===----------------------------------------------------------------------===//
@@ -30,16 +167,7 @@ DefaultSynth::Voice::Voice()
     ap.decay = 2.0f;
     ap.sustain = 0.45f;
     ap.release = 0.4f;
-    this->adsr.setParameters(ap);
-
-    Reverb::Parameters rp;
-    rp.roomSize = 0.0f;
-    rp.damping = 0.0f;
-    rp.wetLevel = 0.23f;
-    rp.dryLevel = 0.73f;
-    rp.width = 0.1f;
-    rp.freezeMode = 0.4f;
-    this->reverb.setParameters(rp);
+    this->envelope.setParameters(ap);
 }
 
 bool DefaultSynth::Voice::canPlaySound(SynthesiserSound *)
@@ -51,8 +179,7 @@ void DefaultSynth::Voice::setCurrentPlaybackSampleRate(double sampleRate)
 {
     if (sampleRate > 0)
     {
-        this->adsr.setSampleRate(sampleRate);
-        this->reverb.setSampleRate(sampleRate);
+        this->envelope.setSampleRate(sampleRate);
         SynthesiserVoice::setCurrentPlaybackSampleRate(sampleRate);
     }
 }
@@ -69,16 +196,15 @@ void DefaultSynth::Voice::startNote(int midiNoteNumber, float velocity, Synthesi
         this->temperament->unmapMicrotonalNote(
             midiNoteNumber, this->getCurrentPlayingChannel());
 
-    this->currentAngle = 0.f;
+    this->currentPhase = 0.f;
     this->level = velocity * 0.2f; // hopefully not too loud
     
     const auto cyclesPerSecond = this->temperament->getNoteInHertz(actualNoteNumber);
     const auto cyclesPerSample = cyclesPerSecond / this->getSampleRate();
 
-    this->angleDelta = float(cyclesPerSample) * MathConstants<float>::twoPi;
+    this->phaseDelta = float(cyclesPerSample * DefaultSynth::sineTableSize);
 
-    this->reverb.reset();
-    this->adsr.noteOn();
+    this->envelope.noteOn();
 }
 
 void DefaultSynth::Voice::stopNote(float, bool allowTailOff)
@@ -87,50 +213,59 @@ void DefaultSynth::Voice::stopNote(float, bool allowTailOff)
     // the release duration is set to be small for this reason
     //if (allowTailOff)
     {
-        this->adsr.noteOff();
+        this->envelope.noteOff();
     }
     //else
     //{
-    //    this->adsr.reset();
-    //    this->reverb.reset();
+    //    this->envelope.reset();
     //    this->clearCurrentNote();
     //}
 }
 
 bool DefaultSynth::Voice::isVoiceActive() const
 {
-    return this->adsr.isActive();
+    return this->envelope.isActive();
 }
 
 void DefaultSynth::Voice::renderNextBlock(AudioBuffer<float> &outputBuffer, int startSample, int numSamples)
 {
-    if (this->adsr.isActive())
+    jassert(this->scratch.getNumSamples() > 0);
+
+    const auto *sineTable = DefaultSynth::getSineTable();
+    constexpr auto tableSize = float(DefaultSynth::sineTableSize);
+
+    auto *sine = this->scratch.getWritePointer(0);
+    auto *amplitude = this->scratch.getWritePointer(1);
+
+    // the voices are rendered into the mono bus, see DefaultSynth::renderVoices
+    auto *output = outputBuffer.getWritePointer(0, startSample);
+
+    while (numSamples > 0 && this->envelope.isActive())
     {
-        while (--numSamples >= 0)
-        {
-            const auto amplitude = this->adsr.getNextSample();
-
-#if JUCE_LINUX
-            // the standard: std::sinf is available since c++11
-            // gcc: well yes, but actually no
-            auto currentSample = std::sin(this->currentAngle) * this->level * amplitude;
-#else
-            auto currentSample = std::sinf(this->currentAngle) * this->level * amplitude;
-#endif
+        const auto chunkSize = jmin(numSamples, this->scratch.getNumSamples());
+        const auto numActiveSamples = this->envelope.render(amplitude, chunkSize);
 
-#if PLATFORM_DESKTOP
-            // even this seems to be too slow for realtime playback on many phones
-            this->reverb.processMono(&currentSample, 1);
-#endif
+        auto phase = this->currentPhase;
+        for (int i = 0; i < numActiveSamples; ++i)
+        {
+            const auto index = int(phase);
+            const auto alpha = phase - float(index);
+            sine[i] = sineTable[index] + alpha * (sineTable[index + 1] - sineTable[index]);
 
-            for (auto i = outputBuffer.getNumChannels(); i --> 0 ;)
+            phase += this->phaseDelta;
+            if (phase >= tableSize)
             {
-                outputBuffer.addSample(i, startSample, currentSample);
+                phase -= tableSize;
             }
-
-            this->currentAngle += this->angleDelta;
-            ++startSample;
         }
+
+        this->currentPhase = phase;
+
+        FloatVectorOperations::multiply(sine, amplitude, numActiveSamples);
+        FloatVectorOperations::addWithMultiply(output, sine, this->level, numActiveSamples);
+
+        output += chunkSize;
+        numSamples -= chunkSize;
     }
 }
 
@@ -139,6 +274,11 @@ void DefaultSynth::Voice::setTemperament(Temperament::Ptr temperament) noexcept
     this->temperament = temperament;
 }
 
+void DefaultSynth::Voice::setMaxBlockSize(int maxBlockSize)
+{
+    this->scratch.setSize(2, jmax(1, maxBlockSize), false, false, true);
+}
+
 //===----------------------------------------------------------------------===//
 // DefaultSynth
 //===----------------------------------------------------------------------===//
@@ -147,10 +287,93 @@ DefaultSynth::DefaultSynth()
 {
     for (int i = DefaultSynth::numVoices; i --> 0 ;)
     {
-        this->addVoice(new DefaultSynth::Voice());
+        auto *voice = new DefaultSynth::Voice();
+        voice->setMaxBlockSize(DefaultSynth::defaultMaxBlockSize);
+        this->addVoice(voice);
     }
 
     this->addSound(new DefaultSynth::Sound());
+
+    this->voicesBus.setSize(1, DefaultSynth::defaultMaxBlockSize);
+
+    Reverb::Parameters rp;
+    rp.roomSize = 0.0f;
+    rp.damping = 0.0f;
+    rp.wetLevel = 0.23f;
+    rp.dryLevel = 0.73f;
+    rp.width = 0.1f;
+    rp.freezeMode = 0.4f;
+    this->reverb.setParameters(rp);
+}
+
+void DefaultSynth::prepareToPlay(double sampleRate, int maxBlockSize)
+{
+    this->setCurrentPlaybackSampleRate(sampleRate);
+
+    const ScopedLock sl(this->lock);
+    this->voicesBus.setSize(1, maxBlockSize, false, false, true);
+
+    for (auto *voice : this->voices)
+    {
+        jassert(dynamic_cast<DefaultSynth::Voice *>(voice));
+        static_cast<DefaultSynth::Voice *>(voice)->setMaxBlockSize(maxBlockSize);
+    }
+}
+
+void DefaultSynth::setCurrentPlaybackSampleRate(double sampleRate)
+{
+    Synthesiser::setCurrentPlaybackSampleRate(sampleRate);
+
+    if (sampleRate > 0)
+    {
+        const ScopedLock sl(this->lock);
+        this->reverb.setSampleRate(sampleRate);
+        this->reverb.reset();
+    }
+}
+
+void DefaultSynth::renderVoices(AudioBuffer<float> &outputAudio, int startSample, int numSamples)
+{
+    if (this->voicesBus.getNumSamples() < numSamples)
+    {
+        jassertfalse; // prepareToPlay is expected to allocate enough
+        this->voicesBus.setSize(1, numSamples, false, false, true);
+    }
+
+    this->voicesBus.clear(0, numSamples);
+
+    for (auto *voice : this->voices)
+    {
+        voice->renderNextBlock(this->voicesBus, 0, numSamples);
+    }
+
+#if PLATFORM_DESKTOP
+    // this one is still too slow for realtime playback on many phones,
+    // even if it is processed once per block instead of once per voice
+    this->reverb.processMono(this->voicesBus.getWritePointer(0), numSamples);
+#endif
+
+    for (int i = outputAudio.getNumChannels(); i --> 0 ;)
+    {
+        outputAudio.addFrom(i, startSample, this->voicesBus, 0, 0, numSamples);
+    }
+}
+
+const float *DefaultSynth::getSineTable() noexcept
+{
+    static const auto sineTable = []()
+    {
+        std::array<float, DefaultSynth::sineTableSize + 1> table;
+        for (int i = 0; i <= DefaultSynth::sineTableSize; ++i)
+        {
+            table[i] = float(std::sin(MathConstants<double>::twoPi *
+                double(i) / double(DefaultSynth::sineTableSize)));
+        }
+
+        return table;
+    }();
+
+    return sineTable.data();
 }
 
 void DefaultSynth::setTemperament(Temperament::Ptr temperament)
@@ -171,3 +394,216 @@ void DefaultSynth::handleSustainPedal(int midiChannel, bool isDown) {}
 // seriously, just want to make sure that once I send a note-off event,
 // the BuiltInSynthVoice shuts up regardless of controller states
 void DefaultSynth::handleSostenutoPedal(int midiChannel, bool isDown) {}
+
+//===----------------------------------------------------------------------===//
+// Tests
+//===----------------------------------------------------------------------===//
+
+#if JUCE_UNIT_TESTS
+
+class DefaultSynthEnvelopeTests final : public UnitTest
+{
+public:
+
+    DefaultSynthEnvelopeTests() :
+        UnitTest("Default synth envelope tests", UnitTestCategories::helio) {}
+
+    void runTest() override
+    {
+        beginTest("Block-based envelope matches juce::ADSR");
+
+        constexpr auto sampleRate = 48000.0;
+        constexpr auto blockSize = 64;
+        constexpr auto numBlocks = 64;
+
+        // the note-off happens in the middle of a block, during the decay
+        constexpr auto noteOffPosition = blockSize * 23 + 28;
+
+        // the stage lengths are not whole numbers of samples,
+        // so that the float rounding can't move the stage transitions
+        ADSR::Parameters ap;
+        ap.attack = 0.0101f;
+        ap.decay = 0.0503f;
+        ap.sustain = 0.5f;
+        ap.release = 0.0307f;
+
+        ADSR reference;
+        reference.setSampleRate(sampleRate);
+        reference.setParameters(ap);
+        reference.noteOn();
+
+        DefaultSynth::Envelope envelope;
+        envelope.setSampleRate(sampleRate);
+        envelope.setParameters(ap);
+        envelope.noteOn();
+
+        float block[blockSize];
+        float maxDifference = 0.f;
+
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            const auto blockStart = b * blockSize;
+            const auto splitPosition = (noteOffPosition > blockStart &&
+                noteOffPosition < blockStart + blockSize) ?
+                noteOffPosition - blockStart : blockSize;
+
+            auto numRendered = envelope.render(block, splitPosition);
+            if (splitPosition < blockSize)
+            {
+                envelope.noteOff();
+                numRendered = splitPosition +
+                    envelope.render(block + splitPosition, blockSize - splitPosition);
+            }
+
+            // the envelope doesn't write anything after it has finished
+            for (int i = numRendered; i < blockSize; ++i)
+            {
+                block[i] = 0.f;
+            }
+
+            for (int i = 0; i < blockSize; ++i)
+            {
+                if (blockStart + i == noteOffPosition)
+                {
+                    reference.noteOff();
+                }
+
+                const auto expected = reference.getNextSample();
+                maxDifference = jmax(maxDifference, std::abs(block[i] - expected));
+            }
+        }
+
+        expect(maxDifference < 0.001f,
+            "Max difference is " + String(maxDifference));
+        expect(!envelope.isActive());
+        expect(!reference.isActive());
+    }
+};
+
+static DefaultSynthEnvelopeTests defaultSynthEnvelopeTests;
+
+// Compares the block-based voices rendering against the way it used to be done,
+// sample by sample with juce::ADSR, std::sin and AudioBuffer::addSample;
+// both paths are mixed into a mono bus with the same reverb as the synth has,
+// so that only the voices rendering differs
+
+class DefaultSynthBenchmark final : public UnitTest
+{
+public:
+
+    DefaultSynthBenchmark() :
+        UnitTest("Default synth voices rendering benchmark", UnitTestCategories::helio) {}
+
+    void runTest() override
+    {
+        constexpr auto sampleRate = 44100.0;
+        constexpr auto blockSize = 512;
+        constexpr auto numBlocks = 1000;
+        constexpr auto numNotes = 16;
+
+        AudioBuffer<float> output(2, blockSize);
+
+        beginTest("Block-based rendering");
+
+        DefaultSynth synth;
+        synth.setTemperament(Temperament::makeTwelveToneEqualTemperament());
+        synth.prepareToPlay(sampleRate, blockSize);
+
+        MidiBuffer noteOns;
+        for (int i = 0; i < numNotes; ++i)
+        {
+            noteOns.addEvent(MidiMessage::noteOn(1, 48 + i, 0.75f), 0);
+        }
+
+        MidiBuffer noMidi;
+        float blockBasedMagnitude = 0.f;
+
+        const auto t1 = Time::getMillisecondCounterHiRes();
+
+        for (int i = 0; i < numBlocks; ++i)
+        {
+            output.clear();
+            synth.renderNextBlock(output, i == 0 ? noteOns : noMidi, 0, blockSize);
+            blockBasedMagnitude = jmax(blockBasedMagnitude, output.getMagnitude(0, blockSize));
+        }
+
+        const auto t2 = Time::getMillisecondCounterHiRes();
+
+        expect(blockBasedMagnitude > 0.f);
+        this->logMessage("Block-based: " + String(t2 - t1) + "ms");
+
+        beginTest("Per-sample rendering");
+
+        ADSR::Parameters ap;
+        ap.attack = 0.002f;
+        ap.decay = 2.0f;
+        ap.sustain = 0.45f;
+        ap.release = 0.4f;
+
+        ADSR envelopes[numNotes];
+        float angles[numNotes] = {};
+        float angleDeltas[numNotes] = {};
+        for (int n = 0; n < numNotes; ++n)
+        {
+            envelopes[n].setSampleRate(sampleRate);
+            envelopes[n].setParameters(ap);
+            envelopes[n].noteOn();
+            angleDeltas[n] = float(MidiMessage::getMidiNoteInHertz(48 + n) /
+                sampleRate) * MathConstants<float>::twoPi;
+        }
+
+        AudioBuffer<float> voicesBus(1, blockSize);
+
+        // same as in the DefaultSynth constructor
+        Reverb::Parameters rp;
+        rp.roomSize = 0.0f;
+        rp.damping = 0.0f;
+        rp.wetLevel = 0.23f;
+        rp.dryLevel = 0.73f;
+        rp.width = 0.1f;
+        rp.freezeMode = 0.4f;
+
+        Reverb reverb;
+        reverb.setParameters(rp);
+        reverb.setSampleRate(sampleRate);
+
+        float perSampleMagnitude = 0.f;
+        const auto t3 = Time::getMillisecondCounterHiRes();
+
+        for (int i = 0; i < numBlocks; ++i)
+        {
+            output.clear();
+            voicesBus.clear();
+
+            for (int n = 0; n < numNotes; ++n)
+            {
+                for (int sample = 0; sample < blockSize; ++sample)
+                {
+                    const auto currentSample = std::sin(angles[n]) * 0.15f * envelopes[n].getNextSample();
+                    voicesBus.addSample(0, sample, currentSample);
+                    angles[n] += angleDeltas[n];
+                }
+            }
+
+#if PLATFORM_DESKTOP
+            reverb.processMono(voicesBus.getWritePointer(0), blockSize);
+#endif
+
+            for (int channel = output.getNumChannels(); channel --> 0 ;)
+            {
+                output.addFrom(channel, 0, voicesBus, 0, 0, blockSize);
+            }
+
+            perSampleMagnitude = jmax(perSampleMagnitude, output.getMagnitude(0, blockSize));
+        }
+
+        const auto t4 = Time::getMillisecondCounterHiRes();
+
+        expect(perSampleMagnitude > 0.f);
+        this->logMessage("Per-sample: " + String(t4 - t3) + "ms");
+    }
+};
+
+static DefaultSynthBenchmark defaultSynthBenchmark;
+
+#endif
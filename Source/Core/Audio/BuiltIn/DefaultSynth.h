@@ -27,6 +27,51 @@ public:
 
     void setTemperament(Temperament::Ptr temperament);
 
+    void prepareToPlay(double sampleRate, int maxBlockSize);
+    void setCurrentPlaybackSampleRate(double sampleRate) override;
+
+    // A linear ADSR, which behaves like juce::ADSR,
+    // but computes the envelope for the whole block at once
+
+    class Envelope final
+    {
+    public:
+
+        Envelope() = default;
+
+        void setParameters(const ADSR::Parameters &parameters) noexcept;
+        void setSampleRate(double sampleRate) noexcept;
+
+        void noteOn() noexcept;
+        void noteOff() noexcept;
+        bool isActive() const noexcept { return this->state != State::Idle; }
+
+        // writes the envelope values and returns the number of samples
+        // written before the envelope finished, or numSamples if it didn't
+        int render(float *destination, int numSamples) noexcept;
+
+    private:
+
+        enum class State
+        {
+            Idle,
+            Attack,
+            Decay,
+            Sustain,
+            Release
+        };
+
+        void updateRates() noexcept;
+
+        State state = State::Idle;
+        ADSR::Parameters parameters;
+        double sampleRate = 44100.0;
+        float level = 0.f;
+        float attackRate = 0.f;
+        float decayRate = 0.f;
+        float releaseRate = 0.f;
+    };
+
 protected:
 
     struct Sound final : public SynthesiserSound
@@ -54,25 +99,45 @@ protected:
 
         void setTemperament(Temperament::Ptr temperament) noexcept;
 
+        // the scratch buffers for the sine and the envelope,
+        // the larger blocks are rendered in chunks of this size
+        void setMaxBlockSize(int maxBlockSize);
+
     private:
 
-        float currentAngle = 0.f;
-        float angleDelta = 0.f;
+        // the phase is measured in the sine table samples
+        float currentPhase = 0.f;
+        float phaseDelta = 0.f;
         float level = 0.f;
 
         Temperament::Ptr temperament;
 
-        ADSR adsr;
-        Reverb reverb;
+        Envelope envelope;
+
+        AudioBuffer<float> scratch;
     };
 
+    // one period of sine, plus one extra point for the interpolation
+    static constexpr auto sineTableSize = 2048;
+
+    // until prepareToPlay is called
+    static constexpr auto defaultMaxBlockSize = 512;
+    static const float *getSineTable() noexcept;
+
+    // all voices are mono, so they are mixed into the one-channel bus,
+    // and the reverb is applied once per block to the sum of the voices
+    void renderVoices(AudioBuffer<float> &outputAudio, int startSample, int numSamples) override;
+
+    AudioBuffer<float> voicesBus;
+    Reverb reverb;
+
     void handleSustainPedal(int midiChannel, bool isDown) override;
     void handleSostenutoPedal(int midiChannel, bool isDown) override;
 
 #if PLATFORM_DESKTOP
-    static constexpr auto numVoices = 16;
+    static constexpr auto numVoices = 32;
 #elif PLATFORM_MOBILE
-    static constexpr auto numVoices = 8;
+    static constexpr auto numVoices = 16;
 #endif
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DefaultSynth)
@@ -55,7 +55,7 @@ void DefaultSynthAudioPlugin::processBlock(AudioSampleBuffer &buffer, MidiBuffer
 
 void DefaultSynthAudioPlugin::prepareToPlay(double sampleRate, int estimatedSamplesPerBlock)
 {
-    this->synth.setCurrentPlaybackSampleRate(sampleRate);
+    this->synth.prepareToPlay(sampleRate, estimatedSamplesPerBlock);
 }
 
 void DefaultSynthAudioPlugin::reset()
@@ -28,18 +28,12 @@
 MetronomeSynth::TickSample::TickSample(int rootKey, const char *sourceData, int sourceDataSize) :
     sourceData(sourceData),
     sourceDataSize(sourceDataSize),
-    midiNoteForNormalPitch(rootKey)
-{
-    this->midiNotes.setBit(rootKey);
-}
+    midiNoteForNormalPitch(rootKey) {}
 
 MetronomeSynth::TickSample::TickSample(int rootKey,
     const String &customSample) :
     customSamplePath(customSample),
-    midiNoteForNormalPitch(rootKey)
-{
-    this->midiNotes.setBit(rootKey);
-}
+    midiNoteForNormalPitch(rootKey) {}
 
 AudioFormatReader *MetronomeSynth::TickSample::createReader()
 {
@@ -79,6 +73,167 @@ AudioFormatReader *MetronomeSynth::TickSample::createReader()
     return nullptr;
 }
 
+//===----------------------------------------------------------------------===//
+// ClickSound
+//===----------------------------------------------------------------------===//
+
+// a few extra zero samples at the end, so that the interpolator
+// doesn't read past the source data while resampling the last ones
+static constexpr auto clickPaddingSamples = 4;
+
+MetronomeSynth::ClickSound::ClickSound(int key,
+    AudioFormatReader &source, double maxLengthSeconds) :
+    key(key),
+    sourceSampleRate(source.sampleRate)
+{
+    if (this->sourceSampleRate <= 0.0 || source.lengthInSamples <= 0)
+    {
+        return;
+    }
+
+    const auto numChannels = jlimit(1, 2, int(source.numChannels));
+    const auto numSamples = int(jmin(source.lengthInSamples,
+        int64(maxLengthSeconds * this->sourceSampleRate)));
+
+    this->sourceData.setSize(numChannels, numSamples + clickPaddingSamples);
+    this->sourceData.clear();
+    source.read(&this->sourceData, 0, numSamples, 0, true, true);
+}
+
+bool MetronomeSynth::ClickSound::appliesToNote(int midiNoteNumber)
+{
+    return midiNoteNumber == this->key;
+}
+
+bool MetronomeSynth::ClickSound::appliesToChannel(int midiChannel)
+{
+    return true;
+}
+
+void MetronomeSynth::ClickSound::renderClick(double sampleRate)
+{
+    const auto numSourceSamples = this->sourceData.getNumSamples() - clickPaddingSamples;
+    if (sampleRate <= 0.0 || numSourceSamples <= 0)
+    {
+        this->click.setSize(0, 0);
+        return;
+    }
+
+    const auto speedRatio = this->sourceSampleRate / sampleRate;
+    const auto numSamples = int(double(numSourceSamples) / speedRatio);
+    this->click.setSize(this->sourceData.getNumChannels(), numSamples);
+
+    for (int channel = 0; channel < this->click.getNumChannels(); ++channel)
+    {
+        if (speedRatio == 1.0)
+        {
+            this->click.copyFrom(channel, 0, this->sourceData, channel, 0, numSamples);
+        }
+        else
+        {
+            LagrangeInterpolator interpolator;
+            interpolator.process(speedRatio, this->sourceData.getReadPointer(channel),
+                this->click.getWritePointer(channel), numSamples);
+        }
+    }
+}
+
+const AudioBuffer<float> &MetronomeSynth::ClickSound::getClick() const noexcept
+{
+    return this->click;
+}
+
+//===----------------------------------------------------------------------===//
+// ClickVoice
+//===----------------------------------------------------------------------===//
+
+bool MetronomeSynth::ClickVoice::canPlaySound(SynthesiserSound *sound)
+{
+    return dynamic_cast<const ClickSound *>(sound) != nullptr;
+}
+
+void MetronomeSynth::ClickVoice::startNote(int midiNoteNumber,
+    float velocity, SynthesiserSound *sound, int pitchWheel)
+{
+    if (auto *clickSound = dynamic_cast<ClickSound *>(sound))
+    {
+        this->click = &clickSound->getClick();
+        this->clickPosition = 0;
+        this->gain = velocity;
+        this->releaseLength = jmax(1, roundToInt(TickSample::releaseTime * this->getSampleRate()));
+        this->releaseSamplesLeft = 0;
+    }
+    else
+    {
+        jassertfalse;
+    }
+}
+
+void MetronomeSynth::ClickVoice::stopNote(float velocity, bool allowTailOff)
+{
+    if (allowTailOff && this->click != nullptr)
+    {
+        // the same note repeats: fade out the previous click
+        if (this->releaseSamplesLeft == 0)
+        {
+            this->releaseSamplesLeft = this->releaseLength;
+        }
+    }
+    else
+    {
+        this->click = nullptr;
+        this->releaseSamplesLeft = 0;
+        this->clearCurrentNote();
+    }
+}
+
+void MetronomeSynth::ClickVoice::renderNextBlock(AudioBuffer<float> &outputBuffer,
+    int startSample, int numSamples)
+{
+    if (this->click == nullptr)
+    {
+        return;
+    }
+
+    const bool isReleasing = this->releaseSamplesLeft > 0;
+
+    auto numSamplesToRender = jmin(numSamples,
+        this->click->getNumSamples() - this->clickPosition);
+
+    auto startGain = this->gain;
+    auto endGain = this->gain;
+
+    if (isReleasing)
+    {
+        numSamplesToRender = jmin(numSamplesToRender, this->releaseSamplesLeft);
+        const auto fullRelease = float(this->releaseLength);
+        startGain *= float(this->releaseSamplesLeft) / fullRelease;
+        endGain *= float(this->releaseSamplesLeft - numSamplesToRender) / fullRelease;
+    }
+
+    if (numSamplesToRender > 0)
+    {
+        const auto numClickChannels = this->click->getNumChannels();
+        for (int channel = 0; channel < outputBuffer.getNumChannels(); ++channel)
+        {
+            outputBuffer.addFromWithRamp(channel, startSample,
+                this->click->getReadPointer(channel % numClickChannels, this->clickPosition),
+                numSamplesToRender, startGain, endGain);
+        }
+
+        this->clickPosition += numSamplesToRender;
+        this->releaseSamplesLeft = jmax(0, this->releaseSamplesLeft - numSamplesToRender);
+    }
+
+    if (this->clickPosition >= this->click->getNumSamples() ||
+        (isReleasing && this->releaseSamplesLeft == 0))
+    {
+        this->click = nullptr;
+        this->releaseSamplesLeft = 0;
+        this->clearCurrentNote();
+    }
+}
+
 //===----------------------------------------------------------------------===//
 // MetronomeSynth
 //===----------------------------------------------------------------------===//
@@ -94,7 +249,23 @@ void MetronomeSynth::initVoices()
 
     for (int i = MetronomeSynth::numVoices; i --> 0 ;)
     {
-        this->addVoice(new SamplerVoice());
+        this->addVoice(new ClickVoice());
+    }
+}
+
+void MetronomeSynth::setCurrentPlaybackSampleRate(double sampleRate)
+{
+    if (this->getSampleRate() == sampleRate)
+    {
+        return;
+    }
+
+    Synthesiser::setCurrentPlaybackSampleRate(sampleRate);
+
+    const ScopedLock sl(this->lock);
+    for (auto *sound : this->sounds)
+    {
+        static_cast<ClickSound *>(sound)->renderClick(sampleRate);
     }
 }
 
@@ -145,10 +316,11 @@ void MetronomeSynth::initSampler(const SamplerParameters &params)
         UniquePointer<AudioFormatReader> sampleSoundReader(sample.createReader());
         if (sampleSoundReader != nullptr)
         {
-            this->addSound(new SamplerSound({}, *sampleSoundReader,
-                sample.midiNotes, sample.midiNoteForNormalPitch,
-                TickSample::attackTime, TickSample::releaseTime,
-                TickSample::maxPlaybackTime));
+            auto *sound = new ClickSound(sample.midiNoteForNormalPitch,
+                *sampleSoundReader, TickSample::maxPlaybackTime);
+
+            sound->renderClick(this->getSampleRate());
+            this->addSound(sound);
         }
     }
 }
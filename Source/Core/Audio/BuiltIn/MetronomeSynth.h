@@ -39,6 +39,9 @@ public:
     void initVoices();
     void initSampler(const SamplerParameters &params);
 
+    // re-renders the clicks for the new sample rate
+    void setCurrentPlaybackSampleRate(double sampleRate) override;
+
     static Note::Key getKeyForSyllable(MetronomeScheme::Syllable syllable);
 
 protected:
@@ -48,9 +51,64 @@ protected:
 
     static constexpr auto numVoices = 16;
 
+    // Unlike SamplerSound/SamplerVoice, which resample and apply the envelope
+    // per sample for each playing voice, the clicks are resampled once
+    // into small buffers at the playback sample rate, and the voices
+    // just mix them into the output, starting at the sample-accurate
+    // offset of the note-on within the block
+    class ClickSound final : public SynthesiserSound
+    {
+    public:
+
+        ClickSound(int key, AudioFormatReader &source, double maxLengthSeconds);
+
+        bool appliesToNote(int midiNoteNumber) override;
+        bool appliesToChannel(int midiChannel) override;
+
+        void renderClick(double sampleRate);
+        const AudioBuffer<float> &getClick() const noexcept;
+
+    private:
+
+        const int key;
+
+        AudioBuffer<float> sourceData;
+        double sourceSampleRate = 0.0;
+
+        AudioBuffer<float> click;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ClickSound)
+    };
+
+    class ClickVoice final : public SynthesiserVoice
+    {
+    public:
+
+        ClickVoice() = default;
+
+        bool canPlaySound(SynthesiserSound *sound) override;
+        void startNote(int midiNoteNumber, float velocity,
+            SynthesiserSound *sound, int pitchWheel) override;
+        void stopNote(float velocity, bool allowTailOff) override;
+        void pitchWheelMoved(int newValue) override {}
+        void controllerMoved(int controllerNumber, int newValue) override {}
+        void renderNextBlock(AudioBuffer<float> &outputBuffer,
+            int startSample, int numSamples) override;
+
+    private:
+
+        const AudioBuffer<float> *click = nullptr;
+        int clickPosition = 0;
+        float gain = 1.f;
+
+        int releaseLength = 0;
+        int releaseSamplesLeft = 0;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ClickVoice)
+    };
+
     struct TickSample final
     {
-        static constexpr auto attackTime = 0.0;
         static constexpr auto releaseTime = 0.5;
         static constexpr auto maxPlaybackTime = 4.5;
 
@@ -65,7 +123,6 @@ protected:
 
         const String customSamplePath;
 
-        BigInteger midiNotes;
         const int midiNoteForNormalPitch = 0;
 
         JUCE_LEAK_DETECTOR(TickSample)
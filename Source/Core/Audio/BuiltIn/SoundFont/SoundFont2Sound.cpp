@@ -22,6 +22,7 @@
 #include "Common.h"
 #include "SoundFont2Sound.h"
 #include "SoundFontSample.h"
+#include "SoundFontSampleCache.h"
 #include "SoundFontRegion.h"
 
 #include <memory>
@@ -882,7 +883,7 @@ SharedAudioSampleBuffer::Ptr SoundFont2Reader::readSamples()
     constexpr int bufferSize = 32768;
     HeapBlock<short> buffer(bufferSize);
     int samplesLeft = numSamples;
-    float *out = sampleBuffer->getWritePointer(0);
+    float *out = sampleBuffer->getWritableBuffer()->getWritePointer(0);
     while (samplesLeft > 0)
     {
         // Read <= 32768 bytes at a time from the buffer
@@ -1169,6 +1170,8 @@ void SoundFont2Sound::setSelectedPreset(int whichPreset)
     {
         this->regions.addArray(this->presets[whichPreset]->regions);
     }
+
+    this->rebuildRegionLookup();
 }
 
 int SoundFont2Sound::getSelectedPreset() const
@@ -1257,106 +1260,151 @@ void SoundFont3Sound::loadSamples(AudioFormatManager &formatManager)
     auto startTime = Time::getMillisecondCounter();
 #endif
 
-    SoundFont3Reader soundFontReader(*this, this->file);
-    const auto samplesBlock = soundFontReader.readSamplesSection();
-    if (samplesBlock.isEmpty())
-    {
-        jassertfalse;
-        return;
-    }
-
-    const auto *sampleBlockStart = static_cast<const char *>(samplesBlock.getData());
-
     // ranges in bytes in compressed stream
     // to ranges in 16-bit sample data points in uncompressed stream
     FlatHashMap<Range<int64>, Range<int64>, SampleRangeHash> decompressedRanges;
 
-    // we have to precompute the length of the uncompressed samples buffer
-    // to avoid resizing it later, which would cause painful reallocations
-    int numChannels = 1;
-    int64 numUncompressedSamples = 0;
+    SharedAudioSampleBuffer::Ptr sampleBuffer;
+
+    SoundFontSampleCache::Entry cachedSamples;
+    if (SoundFontSampleCache::load(this->file, cachedSamples))
     {
-        FlatHashSet<Range<int64>, SampleRangeHash> uniqueCompressedRanges;
+        sampleBuffer = cachedSamples.buffer;
 
-        for (auto *preset : this->presets)
+        MemoryInputStream metadata(cachedSamples.metadata, false);
+        const auto numRanges = metadata.readInt();
+        for (int i = 0; i < numRanges; ++i)
         {
-            for (auto *region : preset->regions)
-            {
-                uniqueCompressedRanges.insert({ region->offset, region->end });
-            }
+            const auto compressedStart = metadata.readInt64();
+            const auto compressedEnd = metadata.readInt64();
+            const auto decompressedStart = metadata.readInt64();
+            const auto decompressedEnd = metadata.readInt64();
+            decompressedRanges[{ compressedStart, compressedEnd }] = { decompressedStart, decompressedEnd };
+        }
+
+        DBG("SoundFont: mapped cached samples in " + String(Time::getMillisecondCounter() - startTime) + " ms");
+    }
+    else
+    {
+        SoundFont3Reader soundFontReader(*this, this->file);
+        const auto samplesBlock = soundFontReader.readSamplesSection();
+        if (samplesBlock.isEmpty())
+        {
+            jassertfalse;
+            return;
         }
 
-        for (const auto &range : uniqueCompressedRanges)
+        const auto *sampleBlockStart = static_cast<const char *>(samplesBlock.getData());
+
+        // we have to precompute the length of the uncompressed samples buffer
+        // to avoid resizing it later, which would cause painful reallocations
+        int numChannels = 1;
+        int64 numUncompressedSamples = 0;
         {
-            const auto *readStart = static_cast<const void *>(sampleBlockStart + range.getStart());
-            const auto readLength = range.getLength() > 0 ?
-                size_t(range.getLength()) :
-                size_t(samplesBlock.getSize() - range.getStart());
-
-            // even though this involves creating readers and parsing sample headers,
-            // it is still cheaper and faster than resizing the buffer later
-            if (const auto sampleReader = this->makeReaderFor(readStart, readLength))
+            FlatHashSet<Range<int64>, SampleRangeHash> uniqueCompressedRanges;
+
+            for (auto *preset : this->presets)
             {
-                numUncompressedSamples += sampleReader->lengthInSamples;
-                numChannels = jmax(numChannels, int(sampleReader->numChannels));
+                for (auto *region : preset->regions)
+                {
+                    uniqueCompressedRanges.insert({ region->offset, region->end });
+                }
+            }
+
+            for (const auto &range : uniqueCompressedRanges)
+            {
+                const auto *readStart = static_cast<const void *>(sampleBlockStart + range.getStart());
+                const auto readLength = range.getLength() > 0 ?
+                    size_t(range.getLength()) :
+                    size_t(samplesBlock.getSize() - range.getStart());
+
+                // even though this involves creating readers and parsing sample headers,
+                // it is still cheaper and faster than resizing the buffer later
+                if (const auto sampleReader = this->makeReaderFor(readStart, readLength))
+                {
+                    numUncompressedSamples += sampleReader->lengthInSamples;
+                    numChannels = jmax(numChannels, int(sampleReader->numChannels));
+                }
             }
         }
-    }
 
-    jassert(numUncompressedSamples < INT_MAX);
-    DBG("SoundFont: read samples length in " + String(Time::getMillisecondCounter() - startTime) + " ms");
+        jassert(numUncompressedSamples < INT_MAX);
+        DBG("SoundFont: read samples length in " + String(Time::getMillisecondCounter() - startTime) + " ms");
 
-    SharedAudioSampleBuffer::Ptr sampleBuffer(new SharedAudioSampleBuffer(numChannels, int(numUncompressedSamples)));
-    int64 currentSampleOffset = 0; // in the result buffer
+        sampleBuffer = new SharedAudioSampleBuffer(numChannels, int(numUncompressedSamples));
+        int64 currentSampleOffset = 0; // in the result buffer
 
-    for (auto *preset : this->presets)
-    {
-        // decompress samples and re-calculate regions' sample offsets
-        for (auto *region : preset->regions)
+        for (auto *preset : this->presets)
         {
-            const Range<int64> compressedByteRange(region->offset, region->end);
-            const auto foundDecompressedRange = decompressedRanges.find(compressedByteRange);
-            if (foundDecompressedRange != decompressedRanges.end())
+            // decompress samples, the regions' offsets are re-calculated below
+            for (auto *region : preset->regions)
             {
-                // the decompressed region is already present in the shared buffer
-                region->offset = foundDecompressedRange->second.getStart();
-                region->end = foundDecompressedRange->second.getEnd();
-                continue;
-            }
+                const Range<int64> compressedByteRange(region->offset, region->end);
+                if (decompressedRanges.contains(compressedByteRange))
+                {
+                    // the decompressed region is already present in the shared buffer
+                    continue;
+                }
 
-            //DBG("Reading sample at " + String(region->offset));
+                //DBG("Reading sample at " + String(region->offset));
 
-            jassert(region->end <= int64(samplesBlock.getSize()));
-            jassert(region->offset < int64(samplesBlock.getSize()));
+                jassert(region->end <= int64(samplesBlock.getSize()));
+                jassert(region->offset < int64(samplesBlock.getSize()));
 
-            const auto *readStart = static_cast<const void *>(sampleBlockStart + region->offset);
-            const auto readLength = region->end > region->offset ?
-                size_t(region->end - region->offset) :
-                size_t(samplesBlock.getSize() - region->offset);
+                const auto *readStart = static_cast<const void *>(sampleBlockStart + region->offset);
+                const auto readLength = region->end > region->offset ?
+                    size_t(region->end - region->offset) :
+                    size_t(samplesBlock.getSize() - region->offset);
 
-            const auto sampleReader = this->makeReaderFor(readStart, readLength);
-            if (sampleReader == nullptr)
-            {
-                //jassertfalse;
-                DBG("Failed to read sample");
-                continue;
-            }
+                const auto sampleReader = this->makeReaderFor(readStart, readLength);
+                if (sampleReader == nullptr)
+                {
+                    //jassertfalse;
+                    DBG("Failed to read sample");
+                    continue;
+                }
 
-            jassert(sampleBuffer->getNumChannels() >= int(sampleReader->numChannels) &&
-                sampleBuffer->getNumSamples() >= int(currentSampleOffset + sampleReader->lengthInSamples));
+                jassert(sampleBuffer->getNumChannels() >= int(sampleReader->numChannels) &&
+                    sampleBuffer->getNumSamples() >= int(currentSampleOffset + sampleReader->lengthInSamples));
 
-            sampleReader->read(sampleBuffer.get(),
-                int(currentSampleOffset), int(sampleReader->lengthInSamples), 0, true, true);
+                sampleReader->read(sampleBuffer->getWritableBuffer(),
+                    int(currentSampleOffset), int(sampleReader->lengthInSamples), 0, true, true);
 
-            const Range<int64> decompressedSampleRange(currentSampleOffset,
-                currentSampleOffset + sampleReader->lengthInSamples);
+                decompressedRanges[compressedByteRange] = { currentSampleOffset,
+                    currentSampleOffset + sampleReader->lengthInSamples };
 
-            decompressedRanges[compressedByteRange] = decompressedSampleRange;
+                currentSampleOffset += sampleReader->lengthInSamples;
+            }
+        }
 
-            region->offset = decompressedSampleRange.getStart();
-            region->end = decompressedSampleRange.getEnd();
+        DBG("SoundFont: decompressed samples in " + String(Time::getMillisecondCounter() - startTime) + " ms");
 
-            currentSampleOffset += sampleReader->lengthInSamples;
+        // the next time, the decompressed data will be just memory-mapped;
+        // the sample rates are kept in the regions, so they are not cached here
+        MemoryOutputStream metadata;
+        metadata.writeInt(int(decompressedRanges.size()));
+        for (const auto &it : decompressedRanges)
+        {
+            metadata.writeInt64(it.first.getStart());
+            metadata.writeInt64(it.first.getEnd());
+            metadata.writeInt64(it.second.getStart());
+            metadata.writeInt64(it.second.getEnd());
+        }
+
+        SoundFontSampleCache::store(this->file, sampleBuffer->getBuffer(), 0.0, metadata.getMemoryBlock());
+    }
+
+    // re-calculate regions' sample offsets
+    for (auto *preset : this->presets)
+    {
+        for (auto *region : preset->regions)
+        {
+            const auto foundDecompressedRange = decompressedRanges.find({ region->offset, region->end });
+            if (foundDecompressedRange != decompressedRanges.end())
+            {
+                region->offset = foundDecompressedRange->second.getStart();
+                region->end = foundDecompressedRange->second.getEnd();
+            }
         }
     }
 
@@ -1372,7 +1420,7 @@ void SoundFont3Sound::loadSamples(AudioFormatManager &formatManager)
     }
 
     DBG("SoundFont: loaded samples in " + String(Time::getMillisecondCounter() - startTime) + " ms");
-    DBG("SoundFont: allocated sample buffer of " + String(sampleBuffer->getNumSamples()) + " samples");
+    DBG("SoundFont: using sample buffer of " + String(sampleBuffer->getNumSamples()) + " samples");
 
     for (auto &sample : this->samplesByRate)
     {
@@ -21,14 +21,41 @@
 
 #pragma once
 
-class SharedAudioSampleBuffer final : public ReferenceCountedObject, public AudioSampleBuffer
+// The samples are only accessible for reading, except for the buffers
+// allocated in memory while loading: the memory-mapped cache files are
+// mapped read-only, and any write into them would crash the app
+class SharedAudioSampleBuffer final : public ReferenceCountedObject
 {
 public:
 
     using Ptr = ReferenceCountedObjectPtr<SharedAudioSampleBuffer>;
 
     explicit SharedAudioSampleBuffer(int numChannels, int numSamples) :
-        AudioSampleBuffer(numChannels, numSamples) {}
+        buffer(numChannels, numSamples) {}
+
+    // refers to the read-only memory-mapped data, see SoundFontSampleCache
+    SharedAudioSampleBuffer(UniquePointer<MemoryMappedFile> &&file,
+        float *const *channels, int numChannels, int numSamples) :
+        buffer(channels, numChannels, numSamples),
+        mappedFile(move(file)) {}
+
+    const AudioSampleBuffer &getBuffer() const noexcept { return this->buffer; }
+
+    // returns nullptr for the memory-mapped data
+    AudioSampleBuffer *getWritableBuffer() noexcept
+    {
+        return this->isMemoryMapped() ? nullptr : &this->buffer;
+    }
+
+    bool isMemoryMapped() const noexcept { return this->mappedFile != nullptr; }
+
+    int getNumChannels() const noexcept { return this->buffer.getNumChannels(); }
+    int getNumSamples() const noexcept { return this->buffer.getNumSamples(); }
+
+private:
+
+    AudioSampleBuffer buffer;
+    UniquePointer<MemoryMappedFile> mappedFile;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SharedAudioSampleBuffer)
 };
@@ -46,7 +73,10 @@ public:
     File getFile() const noexcept { return this->file; }
     String getShortName() const noexcept { return this->file.getFileName(); }
 
-    const AudioSampleBuffer *getBuffer() const noexcept { return this->buffer.get(); }
+    const AudioSampleBuffer *getBuffer() const noexcept
+    {
+        return this->buffer != nullptr ? &this->buffer->getBuffer() : nullptr;
+    }
     void setBuffer(SharedAudioSampleBuffer::Ptr newBuffer)
     {
         this->buffer = newBuffer;
@@ -58,14 +88,37 @@ public:
         {
             this->sampleLength = 0;
         }
+
+        this->numPreloadedSamples = this->sampleLength;
+    }
+
+    // restores the decoded data previously saved in SoundFontSampleCache,
+    // the buffer is expected to have a few extra samples at the end, see load()
+    void setDecodedData(SharedAudioSampleBuffer::Ptr decodedBuffer, double newSampleRate,
+        uint64 newSampleLength, uint64 newLoopStart, uint64 newLoopEnd)
+    {
+        this->buffer = decodedBuffer;
+        this->sampleRate = newSampleRate;
+        this->sampleLength = newSampleLength;
+        this->numPreloadedSamples = newSampleLength;
+        this->loopStart = newLoopStart;
+        this->loopEnd = newLoopEnd;
     }
 
     double getSampleRate() const noexcept { return this->sampleRate; }
     uint64 getSampleLength() const noexcept { return this->sampleLength; }
     uint64 getLoopStart() const noexcept { return this->loopStart; }
     uint64 getLoopEnd() const noexcept { return this->loopEnd; }
-    
-    bool load(AudioFormatManager &formatManager)
+
+    // in the streaming mode, the buffer only holds the beginning
+    // of the sample, and the rest is read from disk while playing
+    uint64 getNumPreloadedSamples() const noexcept { return this->numPreloadedSamples; }
+    bool isStreamed() const noexcept { return this->numPreloadedSamples < this->sampleLength; }
+
+    // maxPreloadTimeMs <= 0 means loading the whole sample into memory;
+    // samples with loops are always loaded fully, since the disk streamer
+    // only reads forward, and looping them would cause constant underruns
+    bool load(AudioFormatManager &formatManager, int maxPreloadTimeMs = 0)
     {
         UniquePointer<AudioFormatReader> reader(formatManager.createReaderFor(this->file));
         if (reader == nullptr)
@@ -76,13 +129,6 @@ public:
         this->sampleRate = reader->sampleRate;
         this->sampleLength = reader->lengthInSamples;
 
-        // Read some extra samples, which will be filled with zeros, so interpolation
-        // can be done without having to check for the edge all the time.
-        jassert(this->sampleLength < std::numeric_limits<int>::max());
-
-        this->buffer = new SharedAudioSampleBuffer(reader->numChannels, static_cast<int>(this->sampleLength + 4));
-        reader->read(this->buffer.get(), 0, static_cast<int>(this->sampleLength + 4), 0, true, true);
-
         const auto *metadata = &reader->metadataValues;
         const int numLoops = metadata->getValue("NumSampleLoops", "0").getIntValue();
         if (numLoops > 0)
@@ -91,9 +137,35 @@ public:
             this->loopEnd = metadata->getValue("Loop0End", "0").getLargeIntValue();
         }
 
+        this->numPreloadedSamples = this->sampleLength;
+        if (maxPreloadTimeMs > 0 && this->loopStart >= this->loopEnd)
+        {
+            const auto maxPreloadedSamples = uint64(this->sampleRate * maxPreloadTimeMs / 1000.0);
+            this->numPreloadedSamples = jmin(this->sampleLength, maxPreloadedSamples);
+        }
+
+        // Read some extra samples, which will be filled with zeros, so interpolation
+        // can be done without having to check for the edge all the time.
+        jassert(this->numPreloadedSamples < std::numeric_limits<int>::max());
+
+        const auto numSamplesToRead = static_cast<int>(this->numPreloadedSamples + 4);
+        this->buffer = new SharedAudioSampleBuffer(reader->numChannels, numSamplesToRead);
+        reader->read(this->buffer->getWritableBuffer(), 0, numSamplesToRead, 0, true, true);
+
         return true;
     }
 
+    // used by the disk streaming thread, each stream has its own reader
+    UniquePointer<AudioFormatReader> createStreamReader(AudioFormatManager &formatManager) const
+    {
+        return UniquePointer<AudioFormatReader>(formatManager.createReaderFor(this->file));
+    }
+
+    int getNumChannels() const noexcept
+    {
+        return this->buffer != nullptr ? this->buffer->getNumChannels() : 0;
+    }
+
 private:
 
     File file;
@@ -106,6 +178,8 @@ private:
     uint64 loopStart = 0;
     uint64 loopEnd = 0;
 
+    uint64 numPreloadedSamples = 0;
+
     JUCE_DECLARE_WEAK_REFERENCEABLE(SoundFontSample)
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SoundFontSample)
 };
@@ -0,0 +1,342 @@
+/*
+    This file is part of Helio music sequencer.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "SoundFontSampleCache.h"
+
+// The cache file layout is: the header (see below), the metadata block,
+// zero padding up to the data alignment, then the planar float32 samples,
+// channel after channel; the samples are stored in the native byte order,
+// and the header values are little-endian, as written by OutputStream.
+
+static constexpr uint32 sampleCacheMagic = constexprHash("SoundFontSampleCache");
+static constexpr int sampleCacheVersion = 1;
+static constexpr int64 sampleCacheDataAlignment = 64;
+
+static inline int64 alignSampleCacheDataOffset(int64 offset) noexcept
+{
+    return (offset + sampleCacheDataAlignment - 1) & ~(sampleCacheDataAlignment - 1);
+}
+
+bool SoundFontSampleCache::isWorthCaching(const File &source)
+{
+    // uncompressed formats are read about as fast as the cache itself
+    return source.hasFileExtension("sf3;sf4;ogg;flac");
+}
+
+bool SoundFontSampleCache::load(const File &source, Entry &result)
+{
+    const auto cacheFile = SoundFontSampleCache::getCacheFileFor(source);
+    if (!cacheFile.existsAsFile())
+    {
+        return false;
+    }
+
+    auto mappedFile = make<MemoryMappedFile>(cacheFile, MemoryMappedFile::readOnly);
+    if (mappedFile->getData() == nullptr)
+    {
+        return false;
+    }
+
+    const auto fileSize = int64(mappedFile->getSize());
+    MemoryInputStream header(mappedFile->getData(), mappedFile->getSize(), false);
+
+    if (uint32(header.readInt()) != sampleCacheMagic ||
+        header.readInt() != sampleCacheVersion ||
+        header.readInt64() != SoundFontSampleCache::getSourceHash(source))
+    {
+        DBG("SoundFont: sample cache is outdated for " + source.getFileName());
+        return false;
+    }
+
+    const auto sampleRate = header.readDouble();
+    const auto numChannels = header.readInt();
+    const auto numSamples = header.readInt();
+    const auto metadataSize = header.readInt();
+    if (numChannels <= 0 || numSamples <= 0 || metadataSize < 0)
+    {
+        jassertfalse;
+        return false;
+    }
+
+    MemoryBlock metadata;
+    if (metadataSize > 0 &&
+        header.readIntoMemoryBlock(metadata, metadataSize) != size_t(metadataSize))
+    {
+        jassertfalse;
+        return false;
+    }
+
+    const auto dataOffset = alignSampleCacheDataOffset(header.getPosition());
+    const auto dataSize = int64(numChannels) * int64(numSamples) * int64(sizeof(float));
+    if (dataOffset + dataSize > fileSize)
+    {
+        jassertfalse;
+        return false;
+    }
+
+    auto *data = reinterpret_cast<float *>(static_cast<char *>(mappedFile->getData()) + dataOffset);
+
+    HeapBlock<float *> channels(numChannels);
+    for (int i = 0; i < numChannels; ++i)
+    {
+        channels[i] = data + int64(i) * int64(numSamples);
+    }
+
+    result.buffer = new SharedAudioSampleBuffer(move(mappedFile),
+        channels.getData(), numChannels, numSamples);
+
+    result.sampleRate = sampleRate;
+    result.metadata = move(metadata);
+
+    // the eviction relies on the last access time,
+    // which is not always updated by the file system itself
+    cacheFile.setLastAccessTime(Time::getCurrentTime());
+
+    return true;
+}
+
+bool SoundFontSampleCache::store(const File &source,
+    const AudioSampleBuffer &buffer, double sampleRate, const MemoryBlock &metadata)
+{
+    const auto cacheFile = SoundFontSampleCache::getCacheFileFor(source);
+    if (cacheFile.getParentDirectory().createDirectory().failed())
+    {
+        return false;
+    }
+
+    // write into a temporary file first, so that the cache
+    // never contains partially written entries
+    TemporaryFile tempFile(cacheFile);
+
+    {
+        FileOutputStream out(tempFile.getFile());
+        if (out.failedToOpen())
+        {
+            return false;
+        }
+
+        const auto numChannels = buffer.getNumChannels();
+        const auto numSamples = buffer.getNumSamples();
+
+        out.writeInt(int(sampleCacheMagic));
+        out.writeInt(sampleCacheVersion);
+        out.writeInt64(SoundFontSampleCache::getSourceHash(source));
+        out.writeDouble(sampleRate);
+        out.writeInt(numChannels);
+        out.writeInt(numSamples);
+        out.writeInt(int(metadata.getSize()));
+        out.write(metadata.getData(), metadata.getSize());
+
+        const auto dataOffset = alignSampleCacheDataOffset(out.getPosition());
+        out.writeRepeatedByte(0, size_t(dataOffset - out.getPosition()));
+
+        for (int i = 0; i < numChannels; ++i)
+        {
+            out.write(buffer.getReadPointer(i), size_t(numSamples) * sizeof(float));
+        }
+
+        out.flush();
+        if (out.getStatus().failed())
+        {
+            return false;
+        }
+    }
+
+    if (!tempFile.overwriteTargetFileWithTemporary())
+    {
+        return false;
+    }
+
+    cacheFile.setLastAccessTime(Time::getCurrentTime());
+    SoundFontSampleCache::removeLeastRecentlyUsed(cacheFile);
+
+    return true;
+}
+
+File SoundFontSampleCache::cacheFolderOverride;
+
+void SoundFontSampleCache::setCacheFolderOverride(const File &folder)
+{
+    SoundFontSampleCache::cacheFolderOverride = folder;
+}
+
+File SoundFontSampleCache::getCacheFolder()
+{
+    if (SoundFontSampleCache::cacheFolderOverride != File())
+    {
+        return SoundFontSampleCache::cacheFolderOverride;
+    }
+
+    const auto appDataFolder = File::getSpecialLocation(File::userApplicationDataDirectory);
+
+#if PLATFORM_DESKTOP
+    return appDataFolder.getChildFile("Helio").getChildFile("SampleCache");
+#elif PLATFORM_MOBILE
+    return appDataFolder.getChildFile("SampleCache");
+#endif
+}
+
+File SoundFontSampleCache::getCacheFileFor(const File &source)
+{
+    const auto fileName = String::toHexString(source.getFullPathName().hashCode64());
+    return SoundFontSampleCache::getCacheFolder().getChildFile(fileName + fileExtension);
+}
+
+int64 SoundFontSampleCache::getSourceHash(const File &source)
+{
+    // hashing the contents of multi-gigabyte files would take
+    // about as much time as decoding them, so only check the identity
+    String identity;
+    identity << source.getFullPathName() << ":"
+        << source.getSize() << ":"
+        << source.getLastModificationTime().toMilliseconds();
+
+    return identity.hashCode64();
+}
+
+void SoundFontSampleCache::removeLeastRecentlyUsed(const File &fileToKeep)
+{
+    struct CachedFile final
+    {
+        File file;
+        int64 size;
+        Time lastAccessTime;
+    };
+
+    std::vector<CachedFile> cachedFiles;
+    int64 totalSize = 0;
+
+    for (const auto &file : SoundFontSampleCache::getCacheFolder()
+        .findChildFiles(File::findFiles, false, "*" + String(fileExtension)))
+    {
+        const auto size = file.getSize();
+        totalSize += size;
+        cachedFiles.push_back({ file, size, file.getLastAccessTime() });
+    }
+
+    if (totalSize <= SoundFontSampleCache::maxCacheSize)
+    {
+        return;
+    }
+
+    std::sort(cachedFiles.begin(), cachedFiles.end(),
+        [](const CachedFile &a, const CachedFile &b)
+        {
+            return a.lastAccessTime < b.lastAccessTime;
+        });
+
+    for (const auto &cachedFile : cachedFiles)
+    {
+        if (totalSize <= SoundFontSampleCache::maxCacheSize)
+        {
+            break;
+        }
+
+        // the files still mapped by other instruments can't be deleted
+        // on some platforms, so they are just skipped until the next time
+        if (cachedFile.file != fileToKeep && cachedFile.file.deleteFile())
+        {
+            DBG("SoundFont: removed cached samples " + cachedFile.file.getFileName());
+            totalSize -= cachedFile.size;
+        }
+    }
+}
+
+//===----------------------------------------------------------------------===//
+// Tests
+//===----------------------------------------------------------------------===//
+
+#if JUCE_UNIT_TESTS
+
+class SoundFontSampleCacheTests final : public UnitTest
+{
+public:
+
+    SoundFontSampleCacheTests() :
+        UnitTest("SoundFont sample cache tests", UnitTestCategories::helio) {}
+
+    void runTest() override
+    {
+        constexpr auto numChannels = 2;
+        constexpr auto numSamples = 1000;
+        constexpr auto sampleRate = 48000.0;
+
+        const auto cacheFolder = File::createTempFile("SampleCache");
+        SoundFontSampleCache::setCacheFolderOverride(cacheFolder);
+
+        // the source only needs to exist, its contents are never read
+        TemporaryFile sourceFile(".flac");
+        sourceFile.getFile().replaceWithText("source");
+        const auto cacheFile = SoundFontSampleCache::getCacheFileFor(sourceFile.getFile());
+        expect(cacheFile.isAChildOf(cacheFolder));
+
+        AudioSampleBuffer samples(numChannels, numSamples);
+        for (int c = 0; c < numChannels; ++c)
+        {
+            for (int i = 0; i < numSamples; ++i)
+            {
+                samples.setSample(c, i, float(c + 1) * std::sin(float(i) * 0.01f));
+            }
+        }
+
+        MemoryBlock metadata;
+        metadata.append("metadata", 8);
+
+        beginTest("Round-trip through the cache file");
+
+        expect(SoundFontSampleCache::store(sourceFile.getFile(), samples, sampleRate, metadata));
+
+        {
+            SoundFontSampleCache::Entry entry;
+            expect(SoundFontSampleCache::load(sourceFile.getFile(), entry));
+            expect(entry.buffer != nullptr);
+            expectEquals(entry.sampleRate, sampleRate);
+            expect(entry.metadata == metadata);
+
+            const auto &loaded = entry.buffer->getBuffer();
+            expectEquals(loaded.getNumChannels(), numChannels);
+            expectEquals(loaded.getNumSamples(), numSamples);
+
+            for (int c = 0; c < numChannels; ++c)
+            {
+                expect(std::memcmp(loaded.getReadPointer(c), samples.getReadPointer(c),
+                    size_t(numSamples) * sizeof(float)) == 0);
+            }
+
+            beginTest("Mapped samples are read-only");
+
+            expect(entry.buffer->isMemoryMapped());
+            expect(entry.buffer->getWritableBuffer() == nullptr);
+        }
+
+        beginTest("Outdated cache entries are not loaded");
+
+        sourceFile.getFile().appendText("modified");
+        sourceFile.getFile().setLastModificationTime(Time::getCurrentTime() + RelativeTime::seconds(10));
+
+        SoundFontSampleCache::Entry outdatedEntry;
+        expect(!SoundFontSampleCache::load(sourceFile.getFile(), outdatedEntry));
+
+        cacheFolder.deleteRecursively();
+        SoundFontSampleCache::setCacheFolderOverride({});
+    }
+};
+
+static SoundFontSampleCacheTests soundFontSampleCacheTests;
+
+#endif
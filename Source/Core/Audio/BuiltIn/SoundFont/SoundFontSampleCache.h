@@ -0,0 +1,73 @@
+/*
+    This file is part of Helio music sequencer.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "SoundFontSample.h"
+
+// Decoding OGG/FLAC samples of sf3 banks and sfz instruments takes a while,
+// so the decoded data is saved on disk as raw PCM, one cache file per source file,
+// and memory-mapped on subsequent loads; each cache file has a header with
+// the hash of the source file's path, size and modification time, so that
+// the outdated entries are detected and rewritten; the least recently used
+// entries are removed when the cache grows beyond the size limit.
+
+class SoundFontSampleCache final
+{
+public:
+
+    struct Entry final
+    {
+        // refers to the read-only memory-mapped file
+        SharedAudioSampleBuffer::Ptr buffer;
+        double sampleRate = 0.0;
+
+        // anything the loader wants to keep along with the samples,
+        // e.g. sample offsets of regions
+        MemoryBlock metadata;
+    };
+
+    static bool isWorthCaching(const File &source);
+
+    static bool load(const File &source, Entry &result);
+    static bool store(const File &source, const AudioSampleBuffer &buffer,
+        double sampleRate, const MemoryBlock &metadata);
+
+    static File getCacheFolder();
+    static File getCacheFileFor(const File &source);
+
+    // used by the tests, so that they never touch (and evict) the user's cache;
+    // pass an empty File to use the default folder again
+    static void setCacheFolderOverride(const File &folder);
+
+private:
+
+    static File cacheFolderOverride;
+
+    static int64 getSourceHash(const File &source);
+    static void removeLeastRecentlyUsed(const File &fileToKeep);
+
+    static constexpr auto fileExtension = ".pcm";
+
+#if PLATFORM_DESKTOP
+    static constexpr int64 maxCacheSize = int64(4) * 1024 * 1024 * 1024;
+#elif PLATFORM_MOBILE
+    static constexpr int64 maxCacheSize = int64(512) * 1024 * 1024;
+#endif
+
+    JUCE_DECLARE_NON_COPYABLE(SoundFontSampleCache)
+};
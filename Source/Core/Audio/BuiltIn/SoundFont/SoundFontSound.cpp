@@ -23,6 +23,7 @@
 #include "SoundFontSound.h"
 #include "SoundFontRegion.h"
 #include "SoundFontSample.h"
+#include "SoundFontSampleCache.h"
 
 class SoundFontReader final
 {
@@ -727,27 +728,94 @@ void SoundFontSound::loadRegions()
 {
     SoundFontReader reader(this);
     reader.read(this->file);
+    this->rebuildRegionLookup();
 }
 
 void SoundFontSound::loadSamples(AudioFormatManager &formatManager)
 {
+    // the disk streamer only reads forward, so the samples
+    // looped by any of the regions have to be loaded fully
+    FlatHashSet<const SoundFontSample *> loopedSamples;
+    if (this->streamingPreloadTimeMs > 0)
+    {
+        for (const auto *region : this->preset->regions)
+        {
+            const bool hasLoop = region->loopMode != SoundFontRegion::LoopMode::noLoop &&
+                region->loopMode != SoundFontRegion::LoopMode::oneShot &&
+                region->loopStart < region->loopEnd;
+
+            if (hasLoop && region->sample != nullptr)
+            {
+                loopedSamples.insert(region->sample.get());
+            }
+        }
+    }
+
     for (auto &it : this->samples)
     {
-        const bool ok = it.second->load(formatManager);
+        auto &sample = *it.second;
+        const auto preloadTimeMs = loopedSamples.contains(&sample) ?
+            0 : this->streamingPreloadTimeMs;
+
+        // streamed samples are read from the source files anyway
+        const bool canUseCache = preloadTimeMs == 0 &&
+            SoundFontSampleCache::isWorthCaching(sample.getFile());
+
+        if (canUseCache && this->loadCachedSample(sample))
+        {
+            continue;
+        }
+
+        const bool ok = sample.load(formatManager, preloadTimeMs);
         if (!ok)
         {
-            this->addError("Couldn't load sample \"" + it.second->getShortName() + "\"");
+            this->addError("Couldn't load sample \"" + sample.getShortName() + "\"");
+        }
+        else if (canUseCache)
+        {
+            MemoryOutputStream metadata;
+            metadata.writeInt64(int64(sample.getSampleLength()));
+            metadata.writeInt64(int64(sample.getLoopStart()));
+            metadata.writeInt64(int64(sample.getLoopEnd()));
+
+            SoundFontSampleCache::store(sample.getFile(), *sample.getBuffer(),
+                sample.getSampleRate(), metadata.getMemoryBlock());
         }
     }
 }
 
+bool SoundFontSound::loadCachedSample(SoundFontSample &sample)
+{
+    SoundFontSampleCache::Entry entry;
+    if (!SoundFontSampleCache::load(sample.getFile(), entry))
+    {
+        return false;
+    }
+
+    MemoryInputStream metadata(entry.metadata, false);
+    const auto sampleLength = metadata.readInt64();
+    const auto loopStart = metadata.readInt64();
+    const auto loopEnd = metadata.readInt64();
+
+    if (sampleLength <= 0 || sampleLength > entry.buffer->getNumSamples())
+    {
+        jassertfalse;
+        return false;
+    }
+
+    sample.setDecodedData(entry.buffer, entry.sampleRate,
+        uint64(sampleLength), uint64(loopStart), uint64(loopEnd));
+
+    return true;
+}
+
 SoundFontRegion *SoundFontSound::getRegionFor(int note,
     int velocity, SoundFontRegion::Trigger trigger) const
 {
     jassert(this->temperament != nullptr);
     const auto periodSize = this->temperament->getPeriodSize();
 
-    for (auto *region : this->regions)
+    for (auto *region : this->getRegionCandidatesFor(note, velocity))
     {
         if (region->matches(note, velocity, trigger, periodSize))
         {
@@ -758,6 +826,87 @@ SoundFontRegion *SoundFontSound::getRegionFor(int note,
     return nullptr;
 }
 
+SoundFontSound::RegionCandidates SoundFontSound::getRegionCandidatesFor(int note, int velocity) const noexcept
+{
+    jassert(this->temperament != nullptr);
+    const auto periodSize = this->temperament->getPeriodSize();
+
+    int mappedNote = note;
+    if (periodSize != Globals::twelveTonePeriodSize)
+    {
+        mappedNote = int(double(note * Globals::twelveTonePeriodSize) / double(periodSize));
+    }
+
+    if (this->regionLayerLookup.isEmpty() ||
+        !isPositiveAndBelow(mappedNote, Globals::twelveToneKeyboardSize) ||
+        !isPositiveAndBelow(velocity, SoundFontSound::numVelocities))
+    {
+        // not in the table, so just check all regions like before
+        return { this->regions.begin(), this->regions.end() };
+    }
+
+    const auto layerIndex = this->regionLayerLookup
+        .getUnchecked(mappedNote * SoundFontSound::numVelocities + velocity);
+
+    const auto &layer = this->regionLayers.getReference(int(layerIndex));
+    return { this->layeredRegions.begin() + layer.getStart(),
+        this->layeredRegions.begin() + layer.getEnd() };
+}
+
+void SoundFontSound::rebuildRegionLookup()
+{
+    static constexpr auto numKeys = Globals::twelveToneKeyboardSize;
+
+    this->layeredRegions.clearQuick();
+    this->regionLayers.clearQuick();
+    this->regionLayerLookup.clearQuick();
+    this->regionLayerLookup.insertMultiple(0, 0, numKeys * numVelocities);
+
+    Array<SoundFontRegion *> keyRegions;
+    for (int key = 0; key < numKeys; ++key)
+    {
+        keyRegions.clearQuick();
+        bool layerStarts[numVelocities + 1] = {};
+        for (auto *region : this->regions)
+        {
+            if (key >= region->lokey && key <= region->hikey)
+            {
+                keyRegions.add(region);
+                layerStarts[jlimit(0, numVelocities, region->lovel)] = true;
+                layerStarts[jlimit(0, numVelocities, region->hivel + 1)] = true;
+            }
+        }
+
+        for (int layerStart = 0; layerStart < numVelocities;)
+        {
+            int layerEnd = layerStart + 1;
+            while (layerEnd < numVelocities && !layerStarts[layerEnd])
+            {
+                ++layerEnd;
+            }
+
+            const auto firstRegion = this->layeredRegions.size();
+            for (auto *region : keyRegions)
+            {
+                if (layerStart >= region->lovel && layerStart <= region->hivel)
+                {
+                    this->layeredRegions.add(region);
+                }
+            }
+
+            const auto layerIndex = uint16(this->regionLayers.size());
+            this->regionLayers.add({ firstRegion, this->layeredRegions.size() });
+
+            for (int velocity = layerStart; velocity < layerEnd; ++velocity)
+            {
+                this->regionLayerLookup.setUnchecked(key * numVelocities + velocity, layerIndex);
+            }
+
+            layerStart = layerEnd;
+        }
+    }
+}
+
 int SoundFontSound::getNumRegions() const { return this->regions.size(); }
 
 SoundFontRegion *SoundFontSound::regionAt(int index) { return this->regions[index]; }
@@ -44,6 +44,19 @@ public:
     SoundFontRegion *getRegionFor(int note, int velocity,
         SoundFontRegion::Trigger trigger = SoundFontRegion::Trigger::attack) const;
 
+    // the regions which may match the note and velocity, in their original order,
+    // taken from the lookup table; the caller still checks them with matches()
+    struct RegionCandidates final
+    {
+        SoundFontRegion *const *begin() const noexcept { return this->first; }
+        SoundFontRegion *const *end() const noexcept { return this->last; }
+
+        SoundFontRegion *const *first = nullptr;
+        SoundFontRegion *const *last = nullptr;
+    };
+
+    RegionCandidates getRegionCandidatesFor(int note, int velocity) const noexcept;
+
     int getNumRegions() const;
     SoundFontRegion *regionAt(int index);
 
@@ -60,6 +73,12 @@ public:
         this->temperament = temperament;
     }
 
+    // should be set before loadSamples, zero disables streaming
+    void setStreamingPreloadTime(int timeMs) noexcept
+    {
+        this->streamingPreloadTimeMs = timeMs;
+    }
+
     void addError(const String &message);
     void addUnsupportedOpcode(const String &opcode);
 
@@ -89,11 +108,17 @@ protected:
 
     Array<SoundFontRegion *> regions;
 
+    // should be called whenever the regions array changes
+    void rebuildRegionLookup();
+
+    int streamingPreloadTimeMs = 0;
+
 private:
 
     friend class SoundFontReader;
     void addRegion(UniquePointer<SoundFontRegion> &&region);
     WeakReference<SoundFontSample> addSample(String path, String defaultPath = String());
+    bool loadCachedSample(SoundFontSample &sample);
 
     UniquePointer<Preset> preset; // a single virtual "preset" to own the regions
 
@@ -105,5 +130,16 @@ private:
 
     Temperament::Ptr temperament;
 
+    // the regions grouped by velocity layers of each 12-tone key: the velocity range
+    // of each key is split at all the boundaries of the regions playing that key,
+    // so that each region matches either all velocities of a layer or none;
+    // the table doesn't depend on the temperament, since the notes are mapped
+    // to the 12-tone keys the same way as in SoundFontRegion::matches()
+    Array<SoundFontRegion *> layeredRegions;
+    Array<Range<int>> regionLayers; // the ranges in layeredRegions
+    Array<uint16> regionLayerLookup; // key * numVelocities + velocity -> layer index
+
+    static constexpr auto numVelocities = 128;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SoundFontSound)
 };
@@ -278,6 +278,466 @@ void SoundFontEnvelope::startRelease()
     }
 }
 
+//===----------------------------------------------------------------------===//
+// SoundFontDiskStreamer
+//===----------------------------------------------------------------------===//
+
+// In the streaming mode, only the beginning of each long sample is kept
+// in memory (see SoundFontSample::load), and the rest of it is read
+// by this background thread into per-voice ring buffers, ahead of playback;
+// the rings are only allocated while their voices are playing streamed samples,
+// so that the idle voices don't take any memory;
+// the voice and the disk thread only talk via atomics, so neither of them
+// blocks the other (except for the offline rendering, see waitUntilAvailable)
+
+class SoundFontDiskStreamer final : private Thread
+{
+public:
+
+    class Stream final
+    {
+    public:
+
+        explicit Stream(SoundFontDiskStreamer &streamer) :
+            streamer(streamer) {}
+
+        // all the methods below are called by the voice:
+
+        void start(const SoundFontSample *sample, int64 startPosition) noexcept
+        {
+            this->readPosition = startPosition;
+            this->requestedPosition = startPosition;
+            this->requestedSample = sample;
+            ++this->requestId;
+        }
+
+        void stop() noexcept
+        {
+            this->requestedSample = nullptr;
+            ++this->requestId;
+        }
+
+        // the sample data is valid up to this position (exclusive),
+        // or zero, if the disk thread hasn't picked up the request yet
+        int64 getAvailableEnd() const noexcept
+        {
+            if (this->servedRequestId.get() != this->requestId.get())
+            {
+                return 0;
+            }
+
+            return this->writePosition.get();
+        }
+
+        inline float getSample(int channel, int64 position) const noexcept
+        {
+            return this->ring.getReadPointer(channel)[position & Stream::ringMask];
+        }
+
+        // lets the disk thread overwrite the data before this position
+        void setReadPosition(int64 position) noexcept
+        {
+            this->readPosition = position;
+        }
+
+        void waitUntilAvailable(int64 position) const
+        {
+            if (!this->streamer.nonRealtime.get())
+            {
+                return;
+            }
+
+            for (int i = 0; i < Stream::maxOfflineWaitTimeMs; ++i)
+            {
+                if (this->getAvailableEnd() > position)
+                {
+                    return;
+                }
+
+                Thread::sleep(1);
+            }
+        }
+
+        void addUnderrun() noexcept
+        {
+            ++this->streamer.numUnderruns;
+        }
+
+    private:
+
+        friend class SoundFontDiskStreamer;
+
+        SoundFontDiskStreamer &streamer;
+
+        static constexpr auto ringSize = 1 << 15;
+        static constexpr auto ringMask = int64(ringSize - 1);
+        static constexpr auto maxOfflineWaitTimeMs = 1000;
+
+        // allocated and released by the disk thread when serving the requests,
+        // so the voice only reads it while its request is served
+        AudioBuffer<float> ring;
+
+        // written by the voice
+        Atomic<const SoundFontSample *> requestedSample = nullptr;
+        Atomic<int64> requestedPosition = 0;
+        Atomic<int64> readPosition = 0;
+        Atomic<uint32> requestId = 0;
+
+        // written by the disk thread
+        Atomic<uint32> servedRequestId = 0;
+        Atomic<int64> writePosition = 0;
+
+        // only accessed by the disk thread
+        const SoundFontSample *currentSample = nullptr;
+        UniquePointer<AudioFormatReader> reader;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Stream)
+    };
+
+    SoundFontDiskStreamer() : Thread("SoundFontDiskStreamer")
+    {
+        this->formatManager.registerBasicFormats();
+    }
+
+    ~SoundFontDiskStreamer() override
+    {
+        this->stopThread(1000);
+    }
+
+    Stream *addStream()
+    {
+        const ScopedLock lock(this->streamsLock);
+        auto *stream = this->streams.add(make<Stream>(*this));
+
+        if (!this->isThreadRunning())
+        {
+            this->startThread(8);
+        }
+
+        return stream;
+    }
+
+    // must be called after the voices using the streams are deleted,
+    // and before the samples are deleted, since the disk thread uses them
+    void removeStreams(const Array<Stream *> &streamsToRemove)
+    {
+        OwnedArray<Stream> removedStreams;
+
+        {
+            const ScopedLock lock(this->streamsLock);
+            for (auto *stream : streamsToRemove)
+            {
+                this->streams.removeObject(stream, false);
+                removedStreams.add(stream);
+            }
+        }
+
+        // the disk thread may still be reading into the removed streams,
+        // so wait until it's done with the current pass; this only happens
+        // when the instrument is reloaded, and the new streams are never blocked
+        const ScopedLock passLock(this->fillPassLock);
+    }
+
+    void setNonRealtime(bool isNonRealtime) noexcept
+    {
+        this->nonRealtime = isNonRealtime;
+    }
+
+    uint64 getNumUnderruns() const noexcept
+    {
+        return this->numUnderruns.get();
+    }
+
+private:
+
+    void run() override
+    {
+        Array<Stream *> streamsToFill;
+
+        while (!this->threadShouldExit())
+        {
+            bool hasMoreData = false;
+
+            {
+                const ScopedLock passLock(this->fillPassLock);
+
+                // the disk reads are done without holding the list's lock,
+                // so that adding the streams never waits for the disk
+                {
+                    const ScopedLock lock(this->streamsLock);
+                    streamsToFill.clearQuick();
+                    streamsToFill.addArray(this->streams.begin(), this->streams.size());
+                }
+
+                for (auto *stream : streamsToFill)
+                {
+                    hasMoreData = this->fillStream(*stream) || hasMoreData;
+                }
+            }
+
+            if (!hasMoreData)
+            {
+                this->wait(SoundFontDiskStreamer::idleTimeoutMs);
+            }
+        }
+    }
+
+    // returns true if the stream could use more data right away
+    bool fillStream(Stream &stream)
+    {
+        const auto requestId = stream.requestId.get();
+        if (requestId != stream.servedRequestId.get())
+        {
+            const auto *sample = stream.requestedSample.get();
+            if (sample != stream.currentSample)
+            {
+                stream.reader = sample != nullptr ?
+                    sample->createStreamReader(this->formatManager) : nullptr;
+                stream.currentSample = sample;
+            }
+
+            if (sample == nullptr)
+            {
+                stream.ring = {};
+            }
+            else if (stream.ring.getNumChannels() == 0)
+            {
+                stream.ring.setSize(2, Stream::ringSize);
+            }
+
+            // the preloaded part is read by the voice directly from the sample buffer
+            const auto startPosition = sample != nullptr ?
+                jmax(stream.requestedPosition.get(), int64(sample->getNumPreloadedSamples())) : 0;
+
+            stream.writePosition = startPosition;
+            stream.servedRequestId = requestId;
+        }
+
+        if (stream.reader == nullptr)
+        {
+            return false;
+        }
+
+        const auto writePosition = stream.writePosition.get();
+        const auto freeSpace = stream.readPosition.get() + Stream::ringSize - writePosition;
+        const auto samplesLeft = int64(stream.currentSample->getSampleLength()) - writePosition;
+        const auto numSamplesToRead = int(jmin(int64(SoundFontDiskStreamer::readChunkSize), freeSpace, samplesLeft));
+        if (numSamplesToRead <= 0)
+        {
+            return false;
+        }
+
+        const auto ringOffset = int(writePosition & Stream::ringMask);
+        const auto numSamplesBeforeWrap = jmin(numSamplesToRead, Stream::ringSize - ringOffset);
+        stream.reader->read(&stream.ring, ringOffset,
+            numSamplesBeforeWrap, writePosition, true, true);
+
+        if (numSamplesBeforeWrap < numSamplesToRead)
+        {
+            stream.reader->read(&stream.ring, 0,
+                numSamplesToRead - numSamplesBeforeWrap,
+                writePosition + numSamplesBeforeWrap, true, true);
+        }
+
+        stream.writePosition = writePosition + numSamplesToRead;
+        return numSamplesToRead == SoundFontDiskStreamer::readChunkSize;
+    }
+
+    AudioFormatManager formatManager;
+
+    CriticalSection streamsLock;
+    OwnedArray<Stream> streams;
+
+    // held by the disk thread while it's reading into the streams
+    CriticalSection fillPassLock;
+
+    Atomic<bool> nonRealtime = false;
+    Atomic<uint64> numUnderruns = 0;
+
+    static constexpr auto readChunkSize = 4096;
+    static constexpr auto idleTimeoutMs = 2;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SoundFontDiskStreamer)
+};
+
+//===----------------------------------------------------------------------===//
+// SoundFontVoiceIndex
+//===----------------------------------------------------------------------===//
+
+// Keeps the voices in the active and free lists, so that rendering and
+// voice allocation only cost O(active voices), and also indexes the active
+// voices by note and by the group which turns them off, so that noteOn
+// doesn't have to check all the voices; only accessed under the synth's lock,
+// the storage is allocated in advance, when the voices or the regions change
+
+class SoundFontVoice;
+
+class SoundFontVoiceIndex final
+{
+public:
+
+    SoundFontVoiceIndex() = default;
+
+    void reset(int numVoices)
+    {
+        for (auto &voices : this->voicesByNote)
+        {
+            voices.clearQuick();
+            voices.ensureStorageAllocated(numVoices);
+        }
+
+        this->voicesByOffGroup.clear();
+        this->numVoices = numVoices;
+
+        for (auto &numNoteDownVoices : this->numNoteDownVoicesByChannel)
+        {
+            numNoteDownVoices = 0;
+        }
+
+        this->activeVoices.clearQuick();
+        this->activeVoices.ensureStorageAllocated(numVoices);
+        this->freeVoices.clearQuick();
+        this->freeVoices.ensureStorageAllocated(numVoices);
+        this->numActiveVoices = 0;
+    }
+
+    void addFreeVoice(SoundFontVoice *voice)
+    {
+        this->freeVoices.add(voice);
+    }
+
+    // the existing groups are kept, since the voices in them may still be playing
+    void addGroup(int64 group)
+    {
+        if (group != 0 && !this->voicesByOffGroup.contains(group))
+        {
+            this->voicesByOffGroup[group].ensureStorageAllocated(this->numVoices);
+        }
+    }
+
+    void add(SoundFontVoice *voice, int note, int channel, int64 offBy, bool isNoteDown)
+    {
+        SoundFontVoiceIndex::removeUnordered(this->freeVoices, voice);
+        this->activeVoices.add(voice);
+        this->numActiveVoices = this->activeVoices.size();
+
+        if (!SoundFontVoiceIndex::canIndex(note, channel))
+        {
+            return;
+        }
+
+        this->voicesByNote[note].add(voice);
+
+        if (offBy != 0)
+        {
+            this->voicesByOffGroup[offBy].add(voice);
+        }
+
+        if (isNoteDown)
+        {
+            this->numNoteDownVoicesByChannel[channel]++;
+        }
+    }
+
+    void remove(SoundFontVoice *voice, int note, int channel, int64 offBy, bool isNoteDown)
+    {
+        SoundFontVoiceIndex::removeUnordered(this->activeVoices, voice);
+        this->freeVoices.add(voice);
+        this->numActiveVoices = this->activeVoices.size();
+
+        if (!SoundFontVoiceIndex::canIndex(note, channel))
+        {
+            return;
+        }
+
+        SoundFontVoiceIndex::removeUnordered(this->voicesByNote[note], voice);
+
+        if (offBy != 0)
+        {
+            SoundFontVoiceIndex::removeUnordered(this->voicesByOffGroup[offBy], voice);
+        }
+
+        if (isNoteDown)
+        {
+            this->numNoteDownVoicesByChannel[channel]--;
+            jassert(this->numNoteDownVoicesByChannel[channel] >= 0);
+        }
+    }
+
+    static bool canIndex(int note, int channel) noexcept
+    {
+        return isPositiveAndBelow(note, Globals::twelveToneKeyboardSize) &&
+            isPositiveAndBelow(channel, SoundFontVoiceIndex::numChannels);
+    }
+
+    // the voices remove themselves from these lists when they stop,
+    // which only moves the last voice to their place, so it is safe
+    // to stop them while iterating the lists backwards
+
+    const Array<SoundFontVoice *> &getActiveVoices() const noexcept
+    {
+        return this->activeVoices;
+    }
+
+    const Array<SoundFontVoice *> &getVoicesPlayingNote(int note) const noexcept
+    {
+        return this->voicesByNote[note];
+    }
+
+    const Array<SoundFontVoice *> *getVoicesTurnedOffBy(int64 group) const
+    {
+        const auto found = this->voicesByOffGroup.find(group);
+        return found != this->voicesByOffGroup.end() ? &found->second : nullptr;
+    }
+
+    SoundFontVoice *getFreeVoice() const noexcept
+    {
+        return this->freeVoices.getLast();
+    }
+
+    int getNumNoteDownVoices(int channel) const noexcept
+    {
+        return this->numNoteDownVoicesByChannel[channel];
+    }
+
+    // may be called from any thread
+    int getNumActiveVoices() const noexcept
+    {
+        return this->numActiveVoices.get();
+    }
+
+private:
+
+    static void removeUnordered(Array<SoundFontVoice *> &voices, SoundFontVoice *voice)
+    {
+        for (int i = voices.size(); i --> 0 ;)
+        {
+            if (voices.getUnchecked(i) == voice)
+            {
+                voices.setUnchecked(i, voices.getLast());
+                voices.removeLast();
+                return;
+            }
+        }
+
+        jassertfalse;
+    }
+
+    // midi channels are 1-based
+    static constexpr auto numChannels = 17;
+
+    Array<SoundFontVoice *> activeVoices;
+    Array<SoundFontVoice *> freeVoices;
+    Atomic<int> numActiveVoices = 0;
+
+    Array<SoundFontVoice *> voicesByNote[Globals::twelveToneKeyboardSize];
+    FlatHashMap<int64, Array<SoundFontVoice *>> voicesByOffGroup;
+    int numNoteDownVoicesByChannel[SoundFontVoiceIndex::numChannels] = {};
+    int numVoices = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SoundFontVoiceIndex)
+};
+
 //===----------------------------------------------------------------------===//
 // SoundFontVoice
 //===----------------------------------------------------------------------===//
@@ -296,6 +756,21 @@ public:
         this->temperament = temperament;
     }
 
+    void setStream(SoundFontDiskStreamer::Stream *newStream) noexcept
+    {
+        this->stream = newStream;
+    }
+
+    SoundFontDiskStreamer::Stream *getStream() const noexcept
+    {
+        return this->stream;
+    }
+
+    void setIndex(SoundFontVoiceIndex *newIndex) noexcept
+    {
+        this->index = newIndex;
+    }
+
     bool canPlaySound(SynthesiserSound *sound) override;
     void startNote(int midiNoteNumber, float velocity,
         SynthesiserSound *sound, int currentPitchWheelPosition) override;
@@ -309,6 +784,10 @@ public:
     bool isPlayingNoteDown();
     bool isPlayingOneShot();
 
+    // used for voice stealing
+    bool isReleasing() const noexcept;
+    float getCurrentLevel() const noexcept;
+
     int getGroup();
     uint64 getOffBy();
 
@@ -321,6 +800,13 @@ private:
 
     Temperament::Ptr temperament;
 
+    // only used in the streaming mode
+    SoundFontDiskStreamer::Stream *stream = nullptr;
+    bool isStreaming = false;
+
+    SoundFontVoiceIndex *index = nullptr;
+    bool isIndexed = false;
+
     int trigger = 0;
     int currentMidiNote = 0;
     int currentPitchWheel = 0;
@@ -451,6 +937,31 @@ void SoundFontVoice::startNote(int midiNoteNumber, float floatVelocity,
     }
 
     this->numLoops = 0;
+
+    // Streaming.
+    this->isStreaming = this->region->sample->isStreamed();
+    if (this->isStreaming)
+    {
+        if (this->stream != nullptr)
+        {
+            this->stream->start(this->region->sample.get(), this->region->offset);
+        }
+        else
+        {
+            jassertfalse; // only the preloaded part will be played
+            this->isStreaming = false;
+            this->sampleEnd = jmin(this->sampleEnd,
+                int64(this->region->sample->getNumPreloadedSamples()));
+        }
+    }
+
+    // Index.
+    if (this->index != nullptr)
+    {
+        this->index->add(this, midiNoteNumber, this->getCurrentPlayingChannel(),
+            this->region->offBy, this->isPlayingNoteDown());
+        this->isIndexed = true;
+    }
 }
 
 void SoundFontVoice::stopNote(float /*velocity*/, bool allowTailOff)
@@ -533,10 +1044,40 @@ void SoundFontVoice::renderNextBlock(AudioSampleBuffer &outputBuffer, int startS
     const float loopEnd = float(this->loopEnd);
     const float sampleEnd = float(this->sampleEnd);
 
+    // For streamed samples, the buffer only contains the preloaded part
+    // (plus a couple of extra samples for interpolation), and the rest
+    // is taken from the ring buffer as far as the disk thread has read it.
+    const auto isStreaming = this->isStreaming;
+    int64 streamEnd = 0;
+    bool hasUnderrun = false;
+    if (isStreaming)
+    {
+        const auto lastNeededPosition = jmin(int64(this->sampleEnd) - 1,
+            int64(sourceSamplePosition + numSamples * this->pitchRatio) + 1);
+
+        this->stream->waitUntilAvailable(lastNeededPosition);
+        streamEnd = this->stream->getAvailableEnd();
+    }
+
+    const auto getStreamedSample = [&](int channel, const float *preloaded, int64 position)
+    {
+        if (position < bufferNumSamples)
+        {
+            return preloaded[position];
+        }
+
+        if (position < streamEnd)
+        {
+            return this->stream->getSample(channel, position);
+        }
+
+        hasUnderrun = true;
+        return 0.f;
+    };
+
     while (--numSamples >= 0)
     {
         const int pos = int(sourceSamplePosition);
-        jassert(pos >= 0 && pos < bufferNumSamples);
         const float alpha = float(sourceSamplePosition - pos);
         const float invAlpha = 1.0f - alpha;
         int nextPos = pos + 1;
@@ -545,11 +1086,26 @@ void SoundFontVoice::renderNextBlock(AudioSampleBuffer &outputBuffer, int startS
             nextPos = int(loopStart);
         }
 
-        // Simple linear interpolation with buffer overrun check
-        const float nextL = nextPos < bufferNumSamples ? inL[nextPos] : inL[pos];
-        const float nextR = inR ? (nextPos < bufferNumSamples ? inR[nextPos] : inR[pos]) : nextL;
-        float l = (inL[pos] * invAlpha + nextL * alpha);
-        float r = inR ? (inR[pos] * invAlpha + nextR * alpha) : l;
+        float l = 0.f;
+        float r = 0.f;
+
+        if (!isStreaming)
+        {
+            jassert(pos >= 0 && pos < bufferNumSamples);
+
+            // Simple linear interpolation with buffer overrun check
+            const float nextL = nextPos < bufferNumSamples ? inL[nextPos] : inL[pos];
+            const float nextR = inR ? (nextPos < bufferNumSamples ? inR[nextPos] : inR[pos]) : nextL;
+            l = (inL[pos] * invAlpha + nextL * alpha);
+            r = inR ? (inR[pos] * invAlpha + nextR * alpha) : l;
+        }
+        else
+        {
+            l = getStreamedSample(0, inL, pos) * invAlpha +
+                getStreamedSample(0, inL, nextPos) * alpha;
+            r = inR ? (getStreamedSample(1, inR, pos) * invAlpha +
+                getStreamedSample(1, inR, nextPos) * alpha) : l;
+        }
 
         const float gainLeft = this->noteGainLeft * ampegGain;
         const float gainRight = this->noteGainRight * ampegGain;
@@ -601,6 +1157,16 @@ void SoundFontVoice::renderNextBlock(AudioSampleBuffer &outputBuffer, int startS
         }
     }
 
+    if (hasUnderrun)
+    {
+        this->stream->addUnderrun();
+    }
+
+    if (this->isStreaming)
+    {
+        this->stream->setReadPosition(int64(sourceSamplePosition));
+    }
+
     this->sourceSamplePosition = sourceSamplePosition;
     this->envelope.setLevel(ampegGain);
     this->envelope.setSamplesUntilNextSegment(samplesUntilNextAmpSegment);
@@ -616,6 +1182,16 @@ bool SoundFontVoice::isPlayingOneShot()
     return this->region && this->region->loopMode == SoundFontRegion::LoopMode::oneShot;
 }
 
+bool SoundFontVoice::isReleasing() const noexcept
+{
+    return this->envelope.isReleasing();
+}
+
+float SoundFontVoice::getCurrentLevel() const noexcept
+{
+    return this->envelope.getLevel() * jmax(this->noteGainLeft, this->noteGainRight);
+}
+
 int SoundFontVoice::getGroup()
 {
     return this->region ? this->region->group : 0;
@@ -672,6 +1248,19 @@ void SoundFontVoice::calcPitchRatio()
 
 void SoundFontVoice::killNote()
 {
+    if (this->isStreaming)
+    {
+        this->stream->stop();
+        this->isStreaming = false;
+    }
+
+    if (this->isIndexed)
+    {
+        this->index->remove(this, this->getCurrentlyPlayingNote(),
+            this->getCurrentPlayingChannel(), this->region->offBy, this->isPlayingNoteDown());
+        this->isIndexed = false;
+    }
+
     this->region = nullptr;
     this->clearCurrentNote();
 }
@@ -680,6 +1269,17 @@ void SoundFontVoice::killNote()
 // SoundFontSynth
 //===----------------------------------------------------------------------===//
 
+SoundFontSynth::SoundFontSynth() :
+    diskStreamer(make<SoundFontDiskStreamer>()),
+    voiceIndex(make<SoundFontVoiceIndex>()) {}
+
+SoundFontSynth::~SoundFontSynth()
+{
+    // the voices and sounds are deleted by the base class,
+    // but the disk thread must stop before that happens
+    this->diskStreamer = nullptr;
+}
+
 void SoundFontSynth::initSynth(const Parameters &parameters)
 {
     File file(parameters.filePath);
@@ -693,58 +1293,116 @@ void SoundFontSynth::initSynth(const Parameters &parameters)
         }
     }
 
-    const ScopedLock locker(this->lock);
-
-    this->allNotesOff(0, false);
-
-    this->clearVoices();
-    for (int i = SoundFontSynth::numVoices; i --> 0 ;)
-    {
-        auto voice = make<SoundFontVoice>();
-        voice->setTemperament(this->temperament);
-        this->addVoice(voice.release());
-    }
-
-    this->clearSounds();
+    // everything heavy is done before taking the lock, which is also taken
+    // by the audio thread for each block, so that loading a new instrument
+    // doesn't make the old one stutter, and only the voices and the sound
+    // are swapped under the lock
 
     AudioFormatManager audioFormatManager;
     audioFormatManager.registerBasicFormats();
 
+    SoundFontSound::Ptr newSound;
     const auto fullPath = file.getFullPathName();
     if (fullPath.endsWithIgnoreCase("sf2"))
     {
-        auto sound = make<SoundFont2Sound>(file);
-        sound->loadRegions();
-        sound->loadSamples(audioFormatManager);
-        sound->setTemperament(this->temperament);
-        this->sounds.add(sound.release());
+        newSound = new SoundFont2Sound(file);
+        newSound->loadRegions();
+        newSound->loadSamples(audioFormatManager);
     }
     else if (fullPath.endsWithIgnoreCase("sf3") || fullPath.endsWithIgnoreCase("sf4"))
     {
-        auto sound = make<SoundFont3Sound>(file);
-        sound->loadRegions();
-        sound->loadSamples(audioFormatManager);
-        sound->setTemperament(this->temperament);
-        this->sounds.add(sound.release());
+        newSound = new SoundFont3Sound(file);
+        newSound->loadRegions();
+        newSound->loadSamples(audioFormatManager);
     }
-    else if (fullPath.endsWithIgnoreCase("sbk"))
+    else if (fullPath.endsWithIgnoreCase("sfz") || fullPath.endsWithIgnoreCase("sbk"))
     {
-        auto sound = make<SoundFontSound>(file);
-        sound->loadRegions();
-        sound->loadSamples(audioFormatManager);
-        sound->setTemperament(this->temperament);
-        this->sounds.add(sound.release());
+        // only sfz instruments support streaming, since sf2/sf3 keep
+        // all their samples in one buffer, read from the soundfont file itself
+        newSound = new SoundFontSound(file);
+        newSound->loadRegions();
+        newSound->setStreamingPreloadTime(parameters.streamingPreloadTimeMs);
+        newSound->loadSamples(audioFormatManager);
     }
 
-    // new file has been loaded so we need to set the program anyway
-    jassert(parameters.programIndex < this->getNumPrograms());
-    this->setCurrentProgram(parameters.programIndex);
+    const bool streamingMode = parameters.streamingPreloadTimeMs > 0;
+
+    const auto numVoices = jlimit(1, SoundFontSynth::maxNumVoices, parameters.numVoices);
+
+    OwnedArray<SynthesiserVoice> newVoices;
+    for (int i = numVoices; i --> 0 ;)
+    {
+        auto voice = make<SoundFontVoice>();
+        voice->setTemperament(this->temperament);
+        voice->setIndex(this->voiceIndex.get());
+        voice->setCurrentPlaybackSampleRate(this->getSampleRate());
+        if (streamingMode)
+        {
+            // the new streams stay idle until the new voices start playing
+            voice->setStream(this->diskStreamer->addStream());
+        }
+
+        newVoices.add(move(voice));
+    }
+
+    // the old voices and the old sound are deleted after the lock is released
+    OwnedArray<SynthesiserVoice> oldVoices;
+    SynthesiserSound::Ptr oldSound;
+
+    {
+        const ScopedLock locker(this->lock);
+
+        this->allNotesOff(0, false);
+        this->voiceIndex->reset(numVoices);
+
+        this->voices.swapWith(oldVoices);
+        this->voices.swapWith(newVoices);
+
+        for (auto *voice : this->voices)
+        {
+            this->voiceIndex->addFreeVoice(static_cast<SoundFontVoice *>(voice));
+        }
+
+        if (this->getNumSounds() > 0)
+        {
+            oldSound = this->getSound(0);
+        }
+
+        this->clearSounds();
+
+        if (newSound != nullptr)
+        {
+            newSound->setTemperament(this->temperament);
+            this->sounds.add(newSound.get());
+        }
+
+        // new file has been loaded so we need to set the program anyway
+        jassert(parameters.programIndex < this->getNumPrograms());
+        this->setCurrentProgram(parameters.programIndex);
+    }
+
+    // the old streams refer to the old samples, so they must be removed first
+    Array<SoundFontDiskStreamer::Stream *> oldStreams;
+    for (auto *v : oldVoices)
+    {
+        jassert(dynamic_cast<SoundFontVoice *>(v));
+        auto *voice = static_cast<SoundFontVoice *>(v);
+        if (auto *stream = voice->getStream())
+        {
+            oldStreams.add(stream);
+        }
+    }
+
+    oldVoices.clear();
+    this->diskStreamer->removeStreams(oldStreams);
+    oldSound = nullptr;
 }
 
+// noteOn and noteOff are only called by the base class from renderNextBlock,
+// between the sample-accurate sub-blocks, which already holds the lock
+
 void SoundFontSynth::noteOn(int midiChannel, int midiNoteNumber, float velocity)
 {
-    const ScopedLock locker(this->lock);
-
     if (this->temperament == nullptr)
     {
         jassertfalse;
@@ -770,11 +1428,9 @@ void SoundFontSynth::noteOn(int midiChannel, int midiNoteNumber, float velocity)
 
     if (group != 0)
     {
-        for (auto *v : this->voices)
+        if (const auto *voicesInGroup = this->voiceIndex->getVoicesTurnedOffBy(group))
         {
-            jassert(dynamic_cast<SoundFontVoice *>(v));
-            auto *voice = static_cast<SoundFontVoice *>(v);
-            if (voice->getOffBy() == group)
+            for (auto *voice : *voicesInGroup)
             {
                 voice->stopNoteForGroup();
             }
@@ -784,25 +1440,23 @@ void SoundFontSynth::noteOn(int midiChannel, int midiNoteNumber, float velocity)
     // Are any notes playing?  (Needed for first/legato trigger handling.)
     // Also stop any voices still playing this note.
     bool anyNotesPlaying = false;
-    for (auto *v : this->voices)
+    if (SoundFontVoiceIndex::canIndex(midiNoteNumber, midiChannel))
     {
-        jassert(dynamic_cast<SoundFontVoice *>(v));
-        auto *voice = static_cast<SoundFontVoice *>(v);
-
-        if (voice->isPlayingChannel(midiChannel) && voice->isPlayingNoteDown())
+        int numVoicesPlayingThisNote = 0;
+        for (auto *voice : this->voiceIndex->getVoicesPlayingNote(midiNoteNumber))
         {
-            if (voice->getCurrentlyPlayingNote() == midiNoteNumber)
+            if (voice->isPlayingChannel(midiChannel) && voice->isPlayingNoteDown())
             {
+                numVoicesPlayingThisNote++;
                 if (!voice->isPlayingOneShot())
                 {
                     voice->stopNoteQuick();
                 }
             }
-            else
-            {
-                anyNotesPlaying = true;
-            }
         }
+
+        anyNotesPlaying =
+            this->voiceIndex->getNumNoteDownVoices(midiChannel) > numVoicesPlayingThisNote;
     }
 
     // Play *all* matching regions.
@@ -812,13 +1466,12 @@ void SoundFontSynth::noteOn(int midiChannel, int midiNoteNumber, float velocity)
         const auto trigger = anyNotesPlaying ?
             SoundFontRegion::Trigger::legato : SoundFontRegion::Trigger::first;
 
-        for (int i = 0; i < sound->getNumRegions(); ++i)
+        for (auto *region : sound->getRegionCandidatesFor(actualNoteNumber, midiVelocity))
         {
-            auto *region = sound->regionAt(i);
             if (region->matches(actualNoteNumber, midiVelocity, trigger, periodSize))
             {
                 if (auto *voice = dynamic_cast<SoundFontVoice *>(this->findFreeVoice(sound,
-                    midiNoteNumber, midiChannel, this->isNoteStealingEnabled())))
+                    midiChannel, midiNoteNumber, this->isNoteStealingEnabled())))
                 {
                     // This check duplicates what the Synthesiser's startVoice method does,
                     // but we have to do it here, before assigning the region reference to the voice,
@@ -843,9 +1496,27 @@ void SoundFontSynth::noteOn(int midiChannel, int midiNoteNumber, float velocity)
 
 void SoundFontSynth::noteOff(int midiChannel, int midiNoteNumber, float velocity, bool allowTailOff)
 {
-    const ScopedLock locker(this->lock);
-
-    Synthesiser::noteOff(midiChannel, midiNoteNumber, velocity, allowTailOff);
+    if (SoundFontVoiceIndex::canIndex(midiNoteNumber, midiChannel))
+    {
+        // does the same as Synthesiser::noteOff, but only checks the voices playing this note
+        const auto &voicesPlayingNote = this->voiceIndex->getVoicesPlayingNote(midiNoteNumber);
+        for (int i = voicesPlayingNote.size(); i --> 0 ;)
+        {
+            auto *voice = voicesPlayingNote.getUnchecked(i);
+            if (voice->isPlayingChannel(midiChannel))
+            {
+                voice->setKeyDown(false);
+                if (!(voice->isSustainPedalDown() || voice->isSostenutoPedalDown()))
+                {
+                    this->stopVoice(voice, velocity, allowTailOff);
+                }
+            }
+        }
+    }
+    else
+    {
+        Synthesiser::noteOff(midiChannel, midiNoteNumber, velocity, allowTailOff);
+    }
 
     // Start release region.
     if (auto *sound = this->getSoundFontSound())
@@ -862,7 +1533,7 @@ void SoundFontSynth::noteOff(int midiChannel, int midiNoteNumber, float velocity
         if (auto *region = sound->getRegionFor(actualNoteNumber,
             this->noteVelocities[actualNoteNumber], SoundFontRegion::Trigger::release))
         {
-            if (auto *voice = dynamic_cast<SoundFontVoice *>(this->findFreeVoice(sound, midiNoteNumber, midiChannel, false)))
+            if (auto *voice = dynamic_cast<SoundFontVoice *>(this->findFreeVoice(sound, midiChannel, midiNoteNumber, false)))
             {
                 if (voice->getCurrentlyPlayingSound() != nullptr)
                 {
@@ -879,6 +1550,68 @@ void SoundFontSynth::noteOff(int midiChannel, int midiNoteNumber, float velocity
     }
 }
 
+//===----------------------------------------------------------------------===//
+// Voices
+//===----------------------------------------------------------------------===//
+
+SynthesiserVoice *SoundFontSynth::findFreeVoice(SynthesiserSound *soundToPlay,
+    int midiChannel, int midiNoteNumber, bool stealIfNoneAvailable) const
+{
+    if (auto *voice = this->voiceIndex->getFreeVoice())
+    {
+        return voice;
+    }
+
+    if (stealIfNoneAvailable)
+    {
+        return this->findVoiceToSteal(soundToPlay, midiChannel, midiNoteNumber);
+    }
+
+    return nullptr;
+}
+
+SynthesiserVoice *SoundFontSynth::findVoiceToSteal(SynthesiserSound *,
+    int /*midiChannel*/, int /*midiNoteNumber*/) const
+{
+    // the quietest of the voices which are already fading out,
+    // or the quietest of all voices, if none of them are
+    SoundFontVoice *result = nullptr;
+    bool resultIsReleasing = false;
+    float resultLevel = 0.f;
+
+    for (auto *voice : this->voiceIndex->getActiveVoices())
+    {
+        const auto isReleasing = voice->isReleasing();
+        const auto level = voice->getCurrentLevel();
+
+        if (result == nullptr ||
+            (isReleasing && !resultIsReleasing) ||
+            (isReleasing == resultIsReleasing && level < resultLevel))
+        {
+            result = voice;
+            resultIsReleasing = isReleasing;
+            resultLevel = level;
+        }
+    }
+
+    return result;
+}
+
+void SoundFontSynth::renderVoices(AudioBuffer<float> &outputAudio, int startSample, int numSamples)
+{
+    // the voices which finish playing remove themselves from the list
+    const auto &activeVoices = this->voiceIndex->getActiveVoices();
+    for (int i = activeVoices.size(); i --> 0 ;)
+    {
+        activeVoices.getUnchecked(i)->renderNextBlock(outputAudio, startSample, numSamples);
+    }
+}
+
+int SoundFontSynth::getNumActiveVoices() const noexcept
+{
+    return this->voiceIndex->getNumActiveVoices();
+}
+
 //===----------------------------------------------------------------------===//
 // Presets
 //===----------------------------------------------------------------------===//
@@ -907,7 +1640,14 @@ void SoundFontSynth::setCurrentProgram(int index)
 {
     if (auto *sound = this->getSoundFontSound())
     {
-        return sound->setSelectedPreset(index < this->getNumPrograms() ? index : 0);
+        const ScopedLock locker(this->lock);
+
+        sound->setSelectedPreset(index < this->getNumPrograms() ? index : 0);
+
+        for (int i = 0; i < sound->getNumRegions(); ++i)
+        {
+            this->voiceIndex->addGroup(sound->regionAt(i)->offBy);
+        }
     }
 }
 
@@ -933,6 +1673,10 @@ void SoundFontSynth::setTemperament(Temperament::Ptr temperament)
         return;
     }
 
+    // called on the message thread, while the audio thread
+    // may be rendering the voices and walking the voice index
+    const ScopedLock locker(this->lock);
+
     this->temperament = temperament;
 
     for (auto *v : this->voices)
@@ -949,6 +1693,16 @@ void SoundFontSynth::setTemperament(Temperament::Ptr temperament)
     }
 }
 
+void SoundFontSynth::setNonRealtime(bool isNonRealtime) noexcept
+{
+    this->diskStreamer->setNonRealtime(isNonRealtime);
+}
+
+uint64 SoundFontSynth::getNumStreamingUnderruns() const noexcept
+{
+    return this->diskStreamer->getNumUnderruns();
+}
+
 SoundFontSound *SoundFontSynth::getSoundFontSound() const noexcept
 {
     if (this->getNumSounds() == 0)
@@ -978,6 +1732,20 @@ SoundFontSynth::Parameters SoundFontSynth::Parameters::withProgramIndex(int newP
     return other;
 }
 
+SoundFontSynth::Parameters SoundFontSynth::Parameters::withStreamingPreloadTime(int newPreloadTimeMs) const noexcept
+{
+    Parameters other(*this);
+    other.streamingPreloadTimeMs = newPreloadTimeMs;
+    return other;
+}
+
+SoundFontSynth::Parameters SoundFontSynth::Parameters::withNumVoices(int newNumVoices) const noexcept
+{
+    Parameters other(*this);
+    other.numVoices = newNumVoices;
+    return other;
+}
+
 SerializedData SoundFontSynth::Parameters::serialize() const
 {
     using namespace Serialization::Audio;
@@ -986,6 +1754,16 @@ SerializedData SoundFontSynth::Parameters::serialize() const
     data.setProperty(SoundFont::filePath, this->filePath);
     data.setProperty(SoundFont::programIndex, this->programIndex);
 
+    if (this->streamingPreloadTimeMs > 0)
+    {
+        data.setProperty(SoundFont::streamingPreloadTime, this->streamingPreloadTimeMs);
+    }
+
+    if (this->numVoices != SoundFontSynth::defaultNumVoices)
+    {
+        data.setProperty(SoundFont::numVoices, this->numVoices);
+    }
+
     return data;
 }
 
@@ -1004,10 +1782,110 @@ void SoundFontSynth::Parameters::deserialize(const SerializedData &data)
 
     this->filePath = root.getProperty(SoundFont::filePath);
     this->programIndex = root.getProperty(SoundFont::programIndex);
+    this->streamingPreloadTimeMs = root.getProperty(SoundFont::streamingPreloadTime, 0);
+    this->numVoices = root.getProperty(SoundFont::numVoices, SoundFontSynth::defaultNumVoices);
 }
 
 void SoundFontSynth::Parameters::reset()
 {
     this->filePath.clear();
     this->programIndex = 0;
+    this->streamingPreloadTimeMs = 0;
+    this->numVoices = SoundFontSynth::defaultNumVoices;
 }
+
+//===----------------------------------------------------------------------===//
+// Tests
+//===----------------------------------------------------------------------===//
+
+#if JUCE_UNIT_TESTS
+
+// Renders a generated looped sine instrument with the increasing number
+// of voices playing, to see how the rendering time grows with the polyphony
+
+class SoundFontSynthPolyphonyBenchmark final : public UnitTest
+{
+public:
+
+    SoundFontSynthPolyphonyBenchmark() :
+        UnitTest("SoundFont synth polyphony benchmark", UnitTestCategories::helio) {}
+
+    void runTest() override
+    {
+        constexpr auto sampleRate = 44100.0;
+        constexpr auto blockSize = 512;
+        constexpr auto numBlocks = 200;
+        constexpr auto sampleLength = 44100;
+
+        TemporaryFile sampleFile(".wav");
+        TemporaryFile instrumentFile(".sfz");
+
+        {
+            AudioSampleBuffer sine(1, sampleLength);
+            for (int i = 0; i < sampleLength; ++i)
+            {
+                sine.setSample(0, i, 0.5f * std::sin(MathConstants<float>::twoPi * 440.f * float(i) / float(sampleRate)));
+            }
+
+            WavAudioFormat wavFormat;
+            UniquePointer<AudioFormatWriter> writer(wavFormat.createWriterFor(
+                new FileOutputStream(sampleFile.getFile()), sampleRate, 1, 16, {}, 0));
+
+            writer->writeFromAudioSampleBuffer(sine, 0, sampleLength);
+        }
+
+        instrumentFile.getFile().replaceWithText("<region> sample=" +
+            sampleFile.getFile().getFileName() + " loop_mode=loop_continuous" +
+            " loop_start=0 loop_end=" + String(sampleLength - 1) + "\n");
+
+        SoundFontSynth synth;
+        synth.setTemperament(Temperament::makeTwelveToneEqualTemperament());
+        synth.setCurrentPlaybackSampleRate(sampleRate);
+        synth.initSynth(SoundFontSynth::Parameters()
+            .withSoundFontFile(instrumentFile.getFile().getFullPathName())
+            .withNumVoices(SoundFontSynth::defaultNumVoices));
+
+        AudioSampleBuffer output(2, blockSize);
+
+        for (const auto numVoices : { 16, 64, 256 })
+        {
+            beginTest("Rendering " + String(numVoices) + " voices");
+
+            synth.allNotesOff(0, false);
+
+            MidiBuffer noteOns;
+            for (int i = 0; i < numVoices; ++i)
+            {
+                const auto channel = 1 + i / Globals::twelveToneKeyboardSize;
+                const auto key = i % Globals::twelveToneKeyboardSize;
+                noteOns.addEvent(MidiMessage::noteOn(channel, key, 0.75f), 0);
+            }
+
+            output.clear();
+            synth.renderNextBlock(output, noteOns, 0, blockSize);
+            expectEquals(synth.getNumActiveVoices(), numVoices);
+
+            MidiBuffer noMidi;
+            const auto startTime = Time::getMillisecondCounterHiRes();
+
+            for (int i = 0; i < numBlocks; ++i)
+            {
+                output.clear();
+                synth.renderNextBlock(output, noMidi, 0, blockSize);
+            }
+
+            const auto renderTimeMs = Time::getMillisecondCounterHiRes() - startTime;
+            const auto audioTimeMs = 1000.0 * double(numBlocks * blockSize) / sampleRate;
+
+            expectEquals(synth.getNumActiveVoices(), numVoices);
+
+            this->logMessage(String(numVoices) + " voices: " +
+                String(renderTimeMs, 2) + "ms to render " + String(audioTimeMs, 2) + "ms, " +
+                String(100.0 * renderTimeMs / audioTimeMs, 2) + "% of real time");
+        }
+    }
+};
+
+static SoundFontSynthPolyphonyBenchmark soundFontSynthPolyphonyBenchmark;
+
+#endif
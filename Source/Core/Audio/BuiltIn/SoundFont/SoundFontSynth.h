@@ -22,6 +22,8 @@
 #pragma once
 
 class SoundFontSound;
+class SoundFontDiskStreamer;
+class SoundFontVoiceIndex;
 
 #include "Temperament.h"
 
@@ -29,7 +31,8 @@ class SoundFontSynth final : public Synthesiser
 {
 public:
 
-    SoundFontSynth() = default;
+    SoundFontSynth();
+    ~SoundFontSynth() override;
 
     void setTemperament(Temperament::Ptr temperament);
 
@@ -42,13 +45,26 @@ public:
     // Synth parameters
     //===------------------------------------------------------------------===//
 
+    static constexpr auto defaultNumVoices = 256;
+    static constexpr auto maxNumVoices = 1024;
+
     struct Parameters final : Serializable
     {
         String filePath;
         int programIndex = 0;
 
+        // if positive, only this many milliseconds of each sample
+        // are kept in memory, and the rest is streamed from disk
+        // (only makes sense for huge sfz instruments)
+        int streamingPreloadTimeMs = 0;
+
+        // the polyphony, all the voices are allocated in advance
+        int numVoices = SoundFontSynth::defaultNumVoices;
+
         Parameters withSoundFontFile(const String &newFilePath) const noexcept;
         Parameters withProgramIndex(int newProgramIndex) const noexcept;
+        Parameters withStreamingPreloadTime(int newPreloadTimeMs) const noexcept;
+        Parameters withNumVoices(int newNumVoices) const noexcept;
 
         SerializedData serialize() const override;
         void deserialize(const SerializedData &data) override;
@@ -57,6 +73,36 @@ public:
 
     void initSynth(const Parameters &parameters);
 
+    //===------------------------------------------------------------------===//
+    // Voices
+    //===------------------------------------------------------------------===//
+
+    // only the active voices are rendered, the free ones are used first,
+    // and if there are none, the quietest voice is stolen,
+    // preferring the ones which are already in the release phase
+    SynthesiserVoice *findFreeVoice(SynthesiserSound *soundToPlay, int midiChannel,
+        int midiNoteNumber, bool stealIfNoneAvailable) const override;
+    SynthesiserVoice *findVoiceToSteal(SynthesiserSound *soundToPlay,
+        int midiChannel, int midiNoteNumber) const override;
+
+    // may be called from any thread, e.g. to compare the cpu usage
+    // of the audio device against the number of voices playing
+    int getNumActiveVoices() const noexcept;
+
+    //===------------------------------------------------------------------===//
+    // Disk streaming
+    //===------------------------------------------------------------------===//
+
+    // in the offline mode, voices wait for the disk thread instead of
+    // skipping the data which hasn't been streamed yet
+    void setNonRealtime(bool isNonRealtime) noexcept;
+
+    // the number of underruns since the moment the synth was created,
+    // i.e. the voices' render blocks in which some of the samples were
+    // played as silence because the disk thread was late; this is not
+    // the number of samples, one block counts once however many it missed
+    uint64 getNumStreamingUnderruns() const noexcept;
+
     //===------------------------------------------------------------------===//
     // Presets
     //===------------------------------------------------------------------===//
@@ -67,14 +113,19 @@ public:
     const String getProgramName(int index) const;
     void changeProgramName(int index, const String &newName);
 
-private:
+protected:
 
-    // todo: make it configurable from the UI
-    static constexpr auto numVoices = 256;
+    void renderVoices(AudioBuffer<float> &outputAudio, int startSample, int numSamples) override;
+
+private:
 
     int noteVelocities[Globals::maxKeyboardSize] = {};
 
     Temperament::Ptr temperament;
 
+    UniquePointer<SoundFontDiskStreamer> diskStreamer;
+
+    UniquePointer<SoundFontVoiceIndex> voiceIndex;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SoundFontSynth)
 };
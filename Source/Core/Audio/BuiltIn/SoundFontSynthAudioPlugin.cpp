@@ -143,7 +143,7 @@ public:
         if (commandId == CommandIDs::Browse)
         {
             this->fileChooser = make<FileChooser>(TRANS(I18n::Dialog::documentLoad),
-                this->lastUsedDirectory, ("*.sf2;*.sf3;*.sf4;*.sbk;*.SF2;*.SF3;*.SF4;*.SBK"), true);
+                this->lastUsedDirectory, ("*.sf2;*.sf3;*.sf4;*.sfz;*.sbk;*.SF2;*.SF3;*.SF4;*.SFZ;*.SBK"), true);
 
             DocumentHelpers::showFileChooser(this->fileChooser,
                 Globals::UI::FileChooser::forFileToOpen,
@@ -241,6 +241,12 @@ void SoundFontSynthAudioPlugin::reset()
     this->synth.allNotesOff(0, true);
 }
 
+void SoundFontSynthAudioPlugin::setNonRealtime(bool isNonRealtime) noexcept
+{
+    AudioProcessor::setNonRealtime(isNonRealtime);
+    this->synth.setNonRealtime(isNonRealtime);
+}
+
 void SoundFontSynthAudioPlugin::releaseResources() {}
 double SoundFontSynthAudioPlugin::getTailLengthSeconds() const { return 3.0; } // hopefully enough?
 
@@ -317,7 +323,9 @@ void SoundFontSynthAudioPlugin::setStateInformation(const void *data, int sizeIn
 
 void SoundFontSynthAudioPlugin::applySynthParameters(const SoundFontSynth::Parameters &newParameters)
 {
-    if (this->synthParameters.filePath != newParameters.filePath)
+    if (this->synthParameters.filePath != newParameters.filePath ||
+        this->synthParameters.streamingPreloadTimeMs != newParameters.streamingPreloadTimeMs ||
+        this->synthParameters.numVoices != newParameters.numVoices)
     {
         this->synth.initSynth(newParameters);
     }
@@ -335,3 +343,13 @@ const SoundFontSynth::Parameters &SoundFontSynthAudioPlugin::getSynthParameters(
 {
     return this->synthParameters;
 }
+
+uint64 SoundFontSynthAudioPlugin::getNumStreamingUnderruns() const noexcept
+{
+    return this->synth.getNumStreamingUnderruns();
+}
+
+int SoundFontSynthAudioPlugin::getNumActiveVoices() const noexcept
+{
+    return this->synth.getNumActiveVoices();
+}
@@ -51,6 +51,7 @@ public:
     //===------------------------------------------------------------------===//
 
     void releaseResources() override;
+    void setNonRealtime(bool isNonRealtime) noexcept override;
     double getTailLengthSeconds() const override;
     bool acceptsMidi() const override;
     bool producesMidi() const override;
@@ -83,6 +84,11 @@ public:
     void applySynthParameters(const SoundFontSynth::Parameters &params);
     const SoundFontSynth::Parameters &getSynthParameters() const noexcept;
 
+    // the number of voice render blocks which missed some streamed data,
+    // see SoundFontSynth::getNumStreamingUnderruns
+    uint64 getNumStreamingUnderruns() const noexcept;
+    int getNumActiveVoices() const noexcept;
+
 private:
 
     SoundFontSynth synth;
@@ -25,8 +25,6 @@
 #include "MetronomeSynthAudioPlugin.h"
 #include "BuiltInSynthsPluginFormat.h"
 #include "KeyboardMapping.h"
-#include "Workspace.h"
-#include "AudioCore.h"
 
 Instrument::Instrument(AudioPluginFormatManager &formatManager, const String &name) :
     formatManager(formatManager),
@@ -35,12 +33,14 @@ Instrument::Instrument(AudioPluginFormatManager &formatManager, const String &na
 {
     this->keyboardMapping = make<KeyboardMapping>();
     this->processorGraph = make<AudioProcessorGraph>();
+    this->processorGraph->addChangeListener(this);
     this->audioCallback.setProcessor(this->processorGraph.get());
 }
 
 Instrument::~Instrument()
 {
     this->audioCallback.setProcessor(nullptr);
+    this->processorGraph->removeChangeListener(this);
     
     PluginWindow::closeAllCurrentlyOpenWindows();
 
@@ -898,6 +898,29 @@ void Instrument::configureNode(AudioProcessorGraph::Node::Ptr node,
     node->properties.set(Serialization::UI::positionY, y);
 }
 
+// the graph sends the change messages whenever its nodes or connections change,
+// so this is the only place where its audio inputs need to be checked
+void Instrument::changeListenerCallback(ChangeBroadcaster *source)
+{
+    jassert(source == this->processorGraph.get());
+
+    bool isReadingAudioInputs = false;
+    for (const auto &c : this->getConnections())
+    {
+        const auto sourceNode = this->getNodeForId(c.source.nodeID);
+        const auto *ioProcessor = sourceNode != nullptr ?
+            dynamic_cast<IOProcessor *>(sourceNode->getProcessor()) : nullptr;
+
+        if (ioProcessor != nullptr && ioProcessor->getType() == IOProcessor::audioInputNode)
+        {
+            isReadingAudioInputs = true;
+            break;
+        }
+    }
+
+    this->audioCallback.setReadingAudioInputs(isReadingAudioInputs);
+}
+
 void Instrument::AudioCallback::setProcessor(AudioProcessor *const newOne)
 {
     if (this->processor != newOne)
@@ -916,6 +939,8 @@ void Instrument::AudioCallback::setProcessor(AudioProcessor *const newOne)
             oldOne = this->isPrepared ? this->processor : nullptr;
             this->processor = newOne;
             this->isPrepared = true;
+            this->numIdleSamples = 0;
+            this->isIdle = false;
         }
 
         if (oldOne != nullptr)
@@ -935,7 +960,15 @@ void Instrument::AudioCallback::audioDeviceIOCallback(const float** const inputC
     this->messageCollector.removeNextBlockOfMessages(this->incomingMidi, numSamples);
     int totalNumChans = 0;
 
-    if (numInputChannels > numOutputChannels)
+    if (numInputChannels == 0)
+    {
+        // the most common case: no audio inputs, so the output channels can be
+        // passed as is, without any copying; they still contain whatever was
+        // there before, e.g. the previous callback's output, so they are cleared
+        // below, unless the graph has no inputs to read that garbage from
+        this->buffer.setDataToReferTo(outputChannelData, numOutputChannels, numSamples);
+    }
+    else if (numInputChannels > numOutputChannels)
     {
         this->tempBuffer.setSize(numInputChannels - numOutputChannels, numSamples, false, false, true);
 
@@ -970,7 +1003,10 @@ void Instrument::AudioCallback::audioDeviceIOCallback(const float** const inputC
         }
     }
 
-    AudioBuffer<float> buffer(this->channels, totalNumChans, numSamples);
+    if (numInputChannels > 0)
+    {
+        this->buffer.setDataToReferTo(this->channels, totalNumChans, numSamples);
+    }
 
     {
         const ScopedLock sl(this->lock);
@@ -979,21 +1015,49 @@ void Instrument::AudioCallback::audioDeviceIOCallback(const float** const inputC
         {
             const ScopedLock sl2(this->processor->getCallbackLock());
 
-            if (!this->processor->isSuspended())
+            // whether the graph reads any audio, regardless of the device's inputs,
+            // e.g. effects wired to the audio input node, which are never idle
+            const bool hasAudioInputs = this->isReadingAudioInputs.get();
+
+            if (this->isIdle.get() && !hasAudioInputs && this->incomingMidi.isEmpty())
+            {
+                // sleeping until there's something to play,
+                // the output is just cleared below
+                this->updateCpuLoad(0.0, numSamples);
+            }
+            else if (!this->processor->isSuspended())
             {
-                this->processor->processBlock(buffer, this->incomingMidi);
+                const bool hasMidiInput = !this->incomingMidi.isEmpty();
 
-                // if the MIDI message buffer is not empty here,
-                // the processor wants to send events to MIDI output:
-                for (const auto metadata : this->incomingMidi)
+                if (numInputChannels == 0 && hasAudioInputs)
                 {
-                    const auto message = metadata.getMessage();
+                    this->buffer.clear();
+                }
+
+                const auto startTicks = Time::getHighResolutionTicks();
+                this->processor->processBlock(this->buffer, this->incomingMidi);
+                this->updateCpuLoad(Time::highResolutionTicksToSeconds(
+                    Time::getHighResolutionTicks() - startTicks), numSamples);
 
-                    // we'll filter out meta events, because some instruments
-                    // may misinterpret them as random notes/controllers:
-                    if (!message.isMetaEvent())
+                // if the MIDI message buffer is not empty here,
+                // the processor wants to send events to MIDI output,
+                // e.g. it's an arpeggiator, so it's not idle either:
+                const bool hasMidiOutput = !this->incomingMidi.isEmpty();
+                this->updateIdleState(hasMidiInput || hasMidiOutput,
+                    hasAudioInputs, numSamples);
+
+                if (hasMidiOutput && this->isForwardingMidiOutput.get())
+                {
+                    for (const auto metadata : this->incomingMidi)
                     {
-                        App::Workspace().getAudioCore().sendMessageToMidiOutputNow(message);
+                        const auto message = metadata.getMessage();
+
+                        // we'll filter out meta events, because some instruments
+                        // may misinterpret them as random notes/controllers:
+                        if (!message.isMetaEvent())
+                        {
+                            this->pushMidiOutputMessage(message);
+                        }
                     }
                 }
 
@@ -1008,6 +1072,200 @@ void Instrument::AudioCallback::audioDeviceIOCallback(const float** const inputC
     }
 }
 
+void Instrument::AudioCallback::setIdleHangover(int milliseconds) noexcept
+{
+    this->idleHangoverMs = jmax(0, milliseconds);
+}
+
+void Instrument::AudioCallback::updateIdleState(bool hasMidiActivity,
+    bool hasAudioInputs, int numSamples) noexcept
+{
+    const auto hangoverMs = this->idleHangoverMs.get();
+
+    // the graphs with audio inputs are effects, which are never idle
+    if (hangoverMs == 0 || hasMidiActivity || hasAudioInputs ||
+        this->buffer.getMagnitude(0, numSamples) > silenceThreshold)
+    {
+        this->numIdleSamples = 0;
+        this->isIdle = false;
+        return;
+    }
+
+    this->numIdleSamples += numSamples;
+    this->isIdle = this->numIdleSamples >= int64(this->sampleRate * hangoverMs / 1000.0);
+}
+
+void Instrument::AudioCallback::setReadingAudioInputs(bool isReading) noexcept
+{
+    this->isReadingAudioInputs = isReading;
+}
+
+void Instrument::AudioCallback::setForwardingMidiOutput(bool shouldForward) noexcept
+{
+    this->isForwardingMidiOutput = shouldForward;
+}
+
+void Instrument::AudioCallback::pushMidiOutputMessage(const MidiMessage &message) noexcept
+{
+    const auto messageSize = message.getRawDataSize();
+    const auto totalSize = midiOutputHeaderSize + messageSize;
+    if (messageSize > 0xffff || this->midiOutputFifo.getFreeSpace() < totalSize)
+    {
+        return; // the forwarder can't keep up, nothing to do but to drop it
+    }
+
+    int start1, size1, start2, size2;
+    this->midiOutputFifo.prepareToWrite(totalSize, start1, size1, start2, size2);
+    jassert(size1 + size2 == totalSize);
+
+    int position = 0;
+    const auto writeByte = [&](uint8 byte)
+    {
+        const auto index = (position < size1) ? (start1 + position) : (start2 + position - size1);
+        this->midiOutputBuffer[index] = byte;
+        ++position;
+    };
+
+    writeByte(uint8(messageSize & 0xff));
+    writeByte(uint8(messageSize >> 8));
+
+    const auto *rawData = message.getRawData();
+    for (int i = 0; i < messageSize; ++i)
+    {
+        writeByte(rawData[i]);
+    }
+
+    this->midiOutputFifo.finishedWrite(totalSize);
+}
+
+bool Instrument::AudioCallback::popMidiOutputMessage(MidiMessage &result)
+{
+    const auto numReady = this->midiOutputFifo.getNumReady();
+    if (numReady < midiOutputHeaderSize)
+    {
+        return false;
+    }
+
+    int start1, size1, start2, size2;
+    this->midiOutputFifo.prepareToRead(numReady, start1, size1, start2, size2);
+
+    int position = 0;
+    const auto readByte = [&]()
+    {
+        const auto index = (position < size1) ? (start1 + position) : (start2 + position - size1);
+        ++position;
+        return this->midiOutputBuffer[index];
+    };
+
+    const auto sizeLow = int(readByte());
+    const auto sizeHigh = int(readByte());
+    const auto messageSize = sizeLow | (sizeHigh << 8);
+    jassert(numReady >= midiOutputHeaderSize + messageSize);
+    jassert(messageSize <= midiOutputBufferSize - midiOutputHeaderSize);
+
+    // this is called on the audio thread, so no allocations here, except for
+    // the ones MidiMessage does itself for sysex longer than its inline storage
+    for (int i = 0; i < messageSize; ++i)
+    {
+        this->midiOutputScratch[i] = readByte();
+    }
+
+    result = MidiMessage(this->midiOutputScratch, messageSize);
+    this->midiOutputFifo.finishedRead(midiOutputHeaderSize + messageSize);
+    return true;
+}
+
+void Instrument::AudioCallback::updateCpuLoad(double processingTimeSeconds, int numSamples) noexcept
+{
+    if (numSamples <= 0 || this->sampleRate <= 0.0)
+    {
+        return;
+    }
+
+    const auto blockDurationSeconds = double(numSamples) / this->sampleRate;
+    const auto currentLoad = float(processingTimeSeconds / blockDurationSeconds);
+
+    // simple exponential smoothing, enough for the load indicators
+    constexpr auto smoothing = 0.9f;
+    this->cpuLoad = this->cpuLoad.get() * smoothing + currentLoad * (1.f - smoothing);
+
+    this->loadStats.addBlock(currentLoad * 100.f);
+}
+
+void Instrument::AudioCallback::LoadStats::addBlock(float loadPercent) noexcept
+{
+    if (this->resetRequested.get())
+    {
+        this->resetRequested = false;
+
+        for (auto &bin : this->histogram)
+        {
+            bin = 0;
+        }
+
+        this->numBlocks = 0;
+        this->numOverruns = 0;
+        this->loadSum = 0.0;
+        this->maxLoad = 0.f;
+    }
+
+    const auto binIndex = jlimit(0, numBins - 1, int(loadPercent));
+    this->histogram[binIndex] = this->histogram[binIndex].get() + 1;
+
+    // only the audio thread writes, so there's no need for the atomic RMW here
+    this->numBlocks = this->numBlocks.get() + 1;
+    this->loadSum = this->loadSum.get() + loadPercent;
+    this->maxLoad = jmax(this->maxLoad.get(), loadPercent);
+
+    if (loadPercent >= 100.f)
+    {
+        this->numOverruns = this->numOverruns.get() + 1;
+    }
+}
+
+Instrument::AudioCallback::LoadStats::Snapshot
+Instrument::AudioCallback::LoadStats::getSnapshot() const noexcept
+{
+    Snapshot result;
+
+    // the audio thread may be adding a block right now,
+    // which is fine, since the snapshot is only an estimate
+    uint32 histogramCopy[numBins];
+    int64 numBlocksInHistogram = 0;
+    for (int i = 0; i < numBins; ++i)
+    {
+        histogramCopy[i] = this->histogram[i].get();
+        numBlocksInHistogram += histogramCopy[i];
+    }
+
+    result.numBlocks = this->numBlocks.get();
+    result.numOverruns = this->numOverruns.get();
+    result.max = this->maxLoad.get();
+
+    if (result.numBlocks == 0 || numBlocksInHistogram == 0)
+    {
+        return result;
+    }
+
+    result.average = float(this->loadSum.get() / double(result.numBlocks));
+
+    const auto p99Threshold = int64(std::ceil(double(numBlocksInHistogram) * 0.99));
+
+    int64 numBlocksBelow = 0;
+    for (int i = 0; i < numBins; ++i)
+    {
+        numBlocksBelow += histogramCopy[i];
+        if (numBlocksBelow >= p99Threshold)
+        {
+            // the upper bound of the bin, but not more than the real max
+            result.p99 = jmin(float(i + 1), result.max);
+            break;
+        }
+    }
+
+    return result;
+}
+
 void Instrument::AudioCallback::audioDeviceAboutToStart(AudioIODevice *const device)
 {
     const auto newSampleRate = device->getCurrentSampleRate();
@@ -1050,6 +1308,7 @@ void Instrument::AudioCallback::audioDeviceStopped()
     this->sampleRate = 0.0;
     this->blockSize = 0;
     this->isPrepared = false;
+    this->cpuLoad = 0.f;
     this->tempBuffer.setSize(1, 1);
 }
 
@@ -21,7 +21,8 @@ class KeyboardMapping;
 
 class Instrument final :
     public Serializable,
-    public ChangeBroadcaster // notifies InstrumentEditor
+    public ChangeBroadcaster, // notifies InstrumentEditor
+    private ChangeListener // listens to the graph's topology changes
 {
 public:
 
@@ -65,8 +66,104 @@ public:
         void audioDeviceStopped() override;
         void handleIncomingMidiMessage(MidiInput *, const MidiMessage &) override;
 
+        // the time spent in processBlock relative to the block duration,
+        // smoothed over a few blocks; may exceed 1 when the processor
+        // can't keep up with the device
+        float getCpuLoad() const noexcept { return this->cpuLoad.get(); }
+
+        // Collects the processBlock timings since the last reset:
+        // written by the audio thread only, readable from any thread;
+        // the percentiles come from a histogram with 1% resolution
+        class LoadStats final
+        {
+        public:
+
+            LoadStats() = default;
+
+            struct Snapshot final
+            {
+                // all in percents of the block duration
+                float average = 0.f;
+                float max = 0.f;
+                float p99 = 0.f;
+
+                int64 numBlocks = 0;
+                // the blocks which took longer than their duration
+                int64 numOverruns = 0;
+            };
+
+            Snapshot getSnapshot() const noexcept;
+
+            // the actual reset happens on the audio thread on the next block
+            void reset() noexcept { this->resetRequested = true; }
+
+            void addBlock(float loadPercent) noexcept;
+
+        private:
+
+            static constexpr auto numBins = 256; // the last one is for >= 255%
+
+            Atomic<uint32> histogram[numBins];
+            Atomic<int64> numBlocks = 0;
+            Atomic<int64> numOverruns = 0;
+            Atomic<double> loadSum = 0.0;
+            Atomic<float> maxLoad = 0.f;
+
+            Atomic<bool> resetRequested = false;
+
+            JUCE_DECLARE_NON_COPYABLE(LoadStats)
+        };
+
+        const LoadStats &getLoadStats() const noexcept { return this->loadStats; }
+        LoadStats &getLoadStats() noexcept { return this->loadStats; }
+
+        // the MIDI produced by the processor is queued by whichever thread
+        // renders it, and sent to the MIDI output device by the audio thread,
+        // see AudioCore::MidiOutputForwarder; when not forwarding, it's dropped
+        void setForwardingMidiOutput(bool shouldForward) noexcept;
+        bool popMidiOutputMessage(MidiMessage &result);
+
+        // when there's no MIDI input and the output stays silent for longer
+        // than the hangover, the processor is put to sleep, i.e. not called
+        // at all until the next MIDI event; the hangover should cover the gaps
+        // in the tails of reverbs and delays; zero means never sleep
+        void setIdleHangover(int milliseconds) noexcept;
+        bool isSleeping() const noexcept { return this->isIdle.get(); }
+
+        // whether anything in the graph is connected to its audio input node,
+        // updated on the message thread, see Instrument::changeListenerCallback;
+        // such graphs, e.g. effects, are never put to sleep
+        void setReadingAudioInputs(bool isReading) noexcept;
+
     private:
 
+        void updateIdleState(bool hasMidiActivity, bool hasAudioInputs, int numSamples) noexcept;
+
+        Atomic<int> idleHangoverMs = 0;
+        Atomic<bool> isIdle = false;
+        Atomic<bool> isReadingAudioInputs = false;
+        int64 numIdleSamples = 0;
+
+        // about -90 dB, which is below the 16-bit noise floor
+        static constexpr auto silenceThreshold = 0.00003f;
+
+        void pushMidiOutputMessage(const MidiMessage &message) noexcept;
+
+        // the single-producer, single-consumer queue of raw messages,
+        // each prefixed with its 2-byte size, since sysex may be long
+        static constexpr auto midiOutputBufferSize = 4096;
+        static constexpr auto midiOutputHeaderSize = 2;
+        AbstractFifo midiOutputFifo { midiOutputBufferSize };
+        uint8 midiOutputBuffer[midiOutputBufferSize];
+        // the popped message is assembled here, since it may wrap around
+        // the end of the queue; nothing larger than the queue can be pushed
+        uint8 midiOutputScratch[midiOutputBufferSize];
+        Atomic<bool> isForwardingMidiOutput = false;
+
+        void updateCpuLoad(double processingTimeSeconds, int numSamples) noexcept;
+        Atomic<float> cpuLoad = 0.f;
+        LoadStats loadStats;
+
         AudioProcessor *processor = nullptr;
         CriticalSection lock;
         double sampleRate = 0;
@@ -77,6 +174,7 @@ public:
         int numOutputChans = 0;
         HeapBlock<float *> channels;
         AudioBuffer<float> tempBuffer;
+        AudioBuffer<float> buffer;
 
         MidiBuffer incomingMidi;
         MidiMessageCollector messageCollector;
@@ -99,6 +197,22 @@ public:
         return this->keyboardMapping.get();
     }
 
+    // the graph computes its own latency from the latencies reported
+    // by the plugins, and compensates it between its parallel paths,
+    // but the instruments are not aware of each other's latency;
+    // see PlayerThread and RendererThread for the compensation
+    int getLatencySamples() const noexcept
+    {
+        return this->processorGraph->getLatencySamples();
+    }
+
+    double getLatencyMs() const noexcept
+    {
+        const auto sampleRate = this->processorGraph->getSampleRate();
+        return sampleRate > 0.0 ?
+            double(this->getLatencySamples()) * 1000.0 / sampleRate : 0.0;
+    }
+
     //===------------------------------------------------------------------===//
     // Nodes
     //===------------------------------------------------------------------===//
@@ -173,6 +287,8 @@ private:
     AudioProcessorGraph::Node::Ptr addNode(UniquePointer<AudioPluginInstance> instance, const SerializedData &data);
     void configureNode(AudioProcessorGraph::Node::Ptr, const PluginDescription &, double x, double y);
 
+    void changeListenerCallback(ChangeBroadcaster *source) override;
+
     friend class Transport;
     friend class AudioCore;
     
@@ -0,0 +1,257 @@
+/*
+    This file is part of Helio music sequencer.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "ParallelAudioCallback.h"
+
+//===----------------------------------------------------------------------===//
+// Worker
+//===----------------------------------------------------------------------===//
+
+ParallelAudioCallback::Worker::Worker(ParallelAudioCallback &owner) :
+    Thread("AudioWorker"),
+    owner(owner) {}
+
+ParallelAudioCallback::Worker::~Worker()
+{
+    this->signalThreadShouldExit();
+    this->blockStarted.signal();
+    this->stopThread(1000);
+}
+
+void ParallelAudioCallback::Worker::startBlock()
+{
+    this->blockStarted.signal();
+}
+
+void ParallelAudioCallback::Worker::run()
+{
+    while (!this->threadShouldExit())
+    {
+        this->blockStarted.wait(-1);
+
+        if (!this->threadShouldExit())
+        {
+            this->owner.runJobs();
+        }
+    }
+}
+
+//===----------------------------------------------------------------------===//
+// ParallelAudioCallback
+//===----------------------------------------------------------------------===//
+
+ParallelAudioCallback::ParallelAudioCallback()
+{
+    // the audio thread takes the jobs too, so one core is left for it
+    const auto numWorkers = jlimit(0, ParallelAudioCallback::maxNumWorkers,
+        SystemStats::getNumCpus() - 1);
+
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        auto *worker = this->workers.add(new Worker(*this));
+        worker->startThread(10);
+    }
+}
+
+ParallelAudioCallback::~ParallelAudioCallback()
+{
+    this->workers.clear();
+}
+
+int ParallelAudioCallback::getNumWorkers() const noexcept
+{
+    return this->workers.size();
+}
+
+void ParallelAudioCallback::addCallback(Instrument::AudioCallback *callback)
+{
+    jassert(callback != nullptr);
+
+    // same as AudioDeviceManager::addAudioCallback does
+    if (this->currentDevice != nullptr)
+    {
+        callback->audioDeviceAboutToStart(this->currentDevice);
+    }
+
+    auto job = make<Job>(callback);
+
+    if (this->currentDevice != nullptr)
+    {
+        job->output.setSize(this->currentDevice->getActiveOutputChannels().countNumberOfSetBits(),
+            this->currentDevice->getCurrentBufferSizeSamples());
+    }
+
+    const ScopedLock sl(this->jobsLock);
+    this->jobs.add(job.release());
+}
+
+void ParallelAudioCallback::removeCallback(Instrument::AudioCallback *callback)
+{
+    UniquePointer<Job> removedJob;
+
+    {
+        const ScopedLock sl(this->jobsLock);
+        for (int i = 0; i < this->jobs.size(); ++i)
+        {
+            if (this->jobs.getUnchecked(i)->callback == callback)
+            {
+                removedJob.reset(this->jobs.removeAndReturn(i));
+                break;
+            }
+        }
+    }
+
+    if (removedJob != nullptr && this->currentDevice != nullptr)
+    {
+        callback->audioDeviceStopped();
+    }
+}
+
+//===----------------------------------------------------------------------===//
+// AudioIODeviceCallback
+//===----------------------------------------------------------------------===//
+
+void ParallelAudioCallback::audioDeviceAboutToStart(AudioIODevice *device)
+{
+    const auto numChannels = device->getActiveOutputChannels().countNumberOfSetBits();
+    const auto blockSize = device->getCurrentBufferSizeSamples();
+
+    const ScopedLock sl(this->jobsLock);
+
+    this->currentDevice = device;
+
+    for (auto *job : this->jobs)
+    {
+        job->output.setSize(numChannels, blockSize);
+        job->callback->audioDeviceAboutToStart(device);
+    }
+}
+
+void ParallelAudioCallback::audioDeviceStopped()
+{
+    const ScopedLock sl(this->jobsLock);
+
+    this->currentDevice = nullptr;
+
+    for (auto *job : this->jobs)
+    {
+        job->callback->audioDeviceStopped();
+    }
+}
+
+void ParallelAudioCallback::audioDeviceIOCallback(const float **inputChannelData,
+    int numInputChannels, float **outputChannelData, int numOutputChannels, int numSamples)
+{
+    const ScopedLock sl(this->jobsLock);
+
+    if (this->jobs.isEmpty())
+    {
+        for (int i = 0; i < numOutputChannels; ++i)
+        {
+            FloatVectorOperations::clear(outputChannelData[i], numSamples);
+        }
+
+        return;
+    }
+
+    for (auto *job : this->jobs)
+    {
+        // only reallocates if the device sends a larger block than announced
+        job->output.setSize(numOutputChannels, numSamples, false, false, true);
+    }
+
+    this->inputChannelData = inputChannelData;
+    this->numInputChannels = numInputChannels;
+    this->numOutputChannels = numOutputChannels;
+    this->numSamples = numSamples;
+
+    this->numJobs = this->jobs.size();
+    this->numJobsDone = 0;
+    this->nextJobIndex = 0;
+    this->isBlockInProgress = true;
+
+    // no need to wake up more workers than there are jobs,
+    // since the audio thread takes one of them anyway
+    const auto numWorkersToWake = jmin(this->workers.size(), this->jobs.size() - 1);
+    for (int i = 0; i < numWorkersToWake; ++i)
+    {
+        this->workers.getUnchecked(i)->startBlock();
+    }
+
+    while (this->runNextJob()) {}
+
+    // the barrier: the jobs taken by the workers are still being processed,
+    // and they are expected to take about as long as the audio thread's ones,
+    // so spinning here is cheaper than waiting on an event
+    while (this->numJobsDone.get() < this->numJobs.get()) {}
+
+    // make sure no late worker is still looking at the jobs array,
+    // as it may be modified right after the lock is released
+    this->isBlockInProgress = false;
+    while (this->numBusyWorkers.get() > 0) {}
+
+    for (int channel = 0; channel < numOutputChannels; ++channel)
+    {
+        auto *destination = outputChannelData[channel];
+
+        FloatVectorOperations::copy(destination,
+            this->jobs.getUnchecked(0)->output.getReadPointer(channel), numSamples);
+
+        for (int i = 1; i < this->jobs.size(); ++i)
+        {
+            FloatVectorOperations::add(destination,
+                this->jobs.getUnchecked(i)->output.getReadPointer(channel), numSamples);
+        }
+    }
+}
+
+//===----------------------------------------------------------------------===//
+// Jobs
+//===----------------------------------------------------------------------===//
+
+bool ParallelAudioCallback::runNextJob() noexcept
+{
+    const auto jobIndex = (++this->nextJobIndex) - 1;
+    if (jobIndex >= this->numJobs.get())
+    {
+        return false;
+    }
+
+    auto *job = this->jobs.getUnchecked(jobIndex);
+
+    job->callback->audioDeviceIOCallback(this->inputChannelData, this->numInputChannels,
+        job->output.getArrayOfWritePointers(), this->numOutputChannels, this->numSamples);
+
+    ++this->numJobsDone;
+    return true;
+}
+
+void ParallelAudioCallback::runJobs() noexcept
+{
+    // the worker may wake up after the block is already done,
+    // or even after the device has stopped, so it checks the flag
+    // only after announcing itself as busy, see audioDeviceIOCallback
+    ++this->numBusyWorkers;
+
+    if (this->isBlockInProgress.get())
+    {
+        while (this->runNextJob()) {}
+    }
+
+    --this->numBusyWorkers;
+}
@@ -0,0 +1,109 @@
+/*
+    This file is part of Helio music sequencer.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Instrument.h"
+
+// Normally each instrument's callback is registered with the device manager,
+// which runs them one after another on the audio thread. Instead, this one is
+// registered as the single callback for all instruments: for each block,
+// it hands the instruments' callbacks out to the pool of worker threads,
+// each rendering into its own buffer, waits until they are all done,
+// and then mixes the buffers into the device output.
+
+class ParallelAudioCallback final : public AudioIODeviceCallback
+{
+public:
+
+    ParallelAudioCallback();
+    ~ParallelAudioCallback() override;
+
+    void addCallback(Instrument::AudioCallback *callback);
+    void removeCallback(Instrument::AudioCallback *callback);
+
+    int getNumWorkers() const noexcept;
+
+    //===------------------------------------------------------------------===//
+    // AudioIODeviceCallback
+    //===------------------------------------------------------------------===//
+
+    void audioDeviceAboutToStart(AudioIODevice *device) override;
+    void audioDeviceIOCallback(const float **inputChannelData, int numInputChannels,
+        float **outputChannelData, int numOutputChannels, int numSamples) override;
+    void audioDeviceStopped() override;
+
+private:
+
+    struct Job final
+    {
+        explicit Job(Instrument::AudioCallback *callback) :
+            callback(callback) {}
+
+        Instrument::AudioCallback *const callback;
+        AudioBuffer<float> output;
+    };
+
+    // called both by the audio thread and by the workers
+    // within a block, returns false when there are no jobs left
+    bool runNextJob() noexcept;
+    void runJobs() noexcept;
+
+    OwnedArray<Job> jobs;
+    CriticalSection jobsLock;
+
+    AudioIODevice *currentDevice = nullptr;
+
+    // the current block's parameters,
+    // written by the audio thread before waking up the workers
+    const float **inputChannelData = nullptr;
+    int numInputChannels = 0;
+    int numOutputChannels = 0;
+    int numSamples = 0;
+
+    Atomic<int> numJobs = 0;
+    Atomic<int> nextJobIndex = 0;
+    Atomic<int> numJobsDone = 0;
+
+    Atomic<bool> isBlockInProgress = false;
+    Atomic<int> numBusyWorkers = 0;
+
+    class Worker final : public Thread
+    {
+    public:
+
+        explicit Worker(ParallelAudioCallback &owner);
+        ~Worker() override;
+
+        void startBlock();
+
+    private:
+
+        void run() override;
+
+        ParallelAudioCallback &owner;
+        WaitableEvent blockStarted;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Worker)
+    };
+
+    OwnedArray<Worker> workers;
+
+    static constexpr auto maxNumWorkers = 8;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ParallelAudioCallback)
+};
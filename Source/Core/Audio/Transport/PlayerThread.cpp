@@ -18,6 +18,7 @@
 #include "Common.h"
 
 #include "PlayerThread.h"
+#include "MetronomeSynth.h"
 
 PlayerThread::PlayerThread(Transport &transport) :
     Thread("PlayerThread"),
@@ -73,6 +74,13 @@ void PlayerThread::run()
 
     this->sequences.seekToTime(this->context->startBeat);
 
+    MetronomeTicker metronome(this->context->metronomeRanges);
+    metronome.seekToBeat(this->context->startBeat);
+
+    LatencyCompensator latencyCompensator(this->sequences, uniqueInstruments,
+        metronome, this->context->metronomeListener, this->context->metronomeLatencyMs);
+    latencyCompensator.reset(this->context->startBeat);
+
     Atomic<float> previousEventBeat = this->context->startBeat;
     broadcastSeekAndTempo(previousEventBeat.get());
 
@@ -163,9 +171,12 @@ void PlayerThread::run()
     while (1)
     {
         CachedMidiMessage wrapper;
+        bool isMetronomeTick = false;
 
-        // Handle playback from the last event to the end of the track:
-        if (!this->sequences.getNextMessage(wrapper))
+        const bool hasNextEvent = latencyCompensator.getNextEvent(wrapper, isMetronomeTick,
+            this->currentTempo.get() / this->speedMultiplier.get());
+
+        if (!hasNextEvent) // Handle playback from the last event to the end of the track:
         {
             const auto previousEventTime = Time::getMillisecondCounter();
             const auto beatDelta = this->context->endBeat - previousEventBeat.get();
@@ -202,6 +213,8 @@ void PlayerThread::run()
             if (isLooped)
             {
                 this->sequences.seekToTime(this->context->rewindBeat);
+                latencyCompensator.reset(this->context->rewindBeat);
+                metronome.seekToBeat(this->context->rewindBeat);
                 previousEventBeat = this->context->rewindBeat;
                 broadcastSeekAndTempo(previousEventBeat.get());
                 continue;
@@ -284,12 +297,28 @@ void PlayerThread::run()
         if (shouldRewind)
         {
             this->sequences.seekToTime(this->context->rewindBeat);
+            latencyCompensator.reset(this->context->rewindBeat);
+            metronome.seekToBeat(this->context->rewindBeat);
             previousEventBeat = this->context->rewindBeat;
             broadcastSeekAndTempo(previousEventBeat.get());
         }
         else
         {
             previousEventBeat = nextEventBeat;
+
+            if (isMetronomeTick)
+            {
+                // the flag can be toggled during playback; no need to keep track
+                // of holding notes here, since no note-offs are sent for the metronome:
+                // the synth restarts the voice when the same note repeats
+                if (this->transport.isMetronomeEnabled())
+                {
+                    wrapper.message.setTimeStamp(Time::getMillisecondCounterHiRes() * 0.001);
+                    wrapper.listener->addMessageToQueue(wrapper.message);
+                }
+
+                continue;
+            }
      
             const int key = wrapper.message.getNoteNumber();
             const int channel = wrapper.message.getChannel();
@@ -335,3 +364,216 @@ void PlayerThread::run()
     
     jassertfalse;
 }
+
+//===----------------------------------------------------------------------===//
+// LatencyCompensator
+//===----------------------------------------------------------------------===//
+
+PlayerThread::LatencyCompensator::LatencyCompensator(TransportPlaybackCache &sequences,
+    const Array<Instrument *> &instruments, MetronomeTicker &metronome,
+    MidiMessageCollector *metronomeListener, double metronomeLatencyMs) :
+    sequences(sequences),
+    metronome(metronome),
+    metronomeListener(metronomeListener),
+    metronomeLatencyMs(metronomeLatencyMs)
+{
+    for (auto *instrument : instruments)
+    {
+        const auto latencyMs = instrument->getLatencyMs();
+        if (latencyMs > 0.0)
+        {
+            this->latencies.add({ instrument, latencyMs });
+            this->maxLatencyMs = jmax(this->maxLatencyMs, latencyMs);
+        }
+    }
+}
+
+void PlayerThread::LatencyCompensator::reset(float beat) noexcept
+{
+    this->pendingMessages.clearQuick();
+    this->hasMoreMessages = true;
+    this->hasNextMessage = false;
+    this->lastFetchedBeat = beat;
+    this->minBeat = beat;
+}
+
+bool PlayerThread::LatencyCompensator::getNextEvent(CachedMidiMessage &result,
+    bool &isMetronomeTick, double msPerBeat)
+{
+    if (!this->hasNextMessage)
+    {
+        this->hasNextMessage = this->getNextMessage(this->nextMessage, msPerBeat);
+    }
+
+    const bool hasNextTick = this->metronomeListener != nullptr && this->metronome.hasNextTick();
+    const auto nextTickBeat = hasNextTick ?
+        this->getShiftedBeat(this->metronome.getNextTickBeat(), this->metronomeLatencyMs, msPerBeat) : 0.0;
+
+    if (hasNextTick &&
+        (!this->hasNextMessage || nextTickBeat <= this->nextMessage.message.getTimeStamp()))
+    {
+        constexpr auto metronomeChannel = 1;    // doesn't matter which one
+        constexpr auto metronomeVelocity = 1.f; // also will be ignored
+
+        const auto key = MetronomeSynth::getKeyForSyllable(this->metronome.getNextTickSyllable());
+        result.message = MidiMessage::noteOn(metronomeChannel, key, metronomeVelocity);
+        result.message.setTimeStamp(nextTickBeat);
+        result.listener = this->metronomeListener;
+        result.instrument = nullptr;
+        isMetronomeTick = true;
+        this->metronome.advance();
+    }
+    else if (this->hasNextMessage)
+    {
+        result = this->nextMessage;
+        isMetronomeTick = false;
+        this->hasNextMessage = false;
+    }
+    else
+    {
+        return false;
+    }
+
+    this->minBeat = result.message.getTimeStamp();
+    return true;
+}
+
+bool PlayerThread::LatencyCompensator::getNextMessage(CachedMidiMessage &result, double msPerBeat)
+{
+    if (this->latencies.isEmpty())
+    {
+        return this->sequences.getNextMessage(result);
+    }
+
+    const auto maxLatencyBeats = this->maxLatencyMs / msPerBeat;
+
+    // keep fetching, until none of the following messages
+    // can be shifted before the earliest pending one
+    while (this->hasMoreMessages &&
+        (this->pendingMessages.isEmpty() ||
+            this->pendingMessages.getReference(0).message.getTimeStamp() >
+                this->lastFetchedBeat - maxLatencyBeats))
+    {
+        CachedMidiMessage next;
+        if (!this->sequences.getNextMessage(next))
+        {
+            this->hasMoreMessages = false;
+            break;
+        }
+
+        this->lastFetchedBeat = next.message.getTimeStamp();
+
+        const auto shiftedBeat = this->getShiftedBeat(this->lastFetchedBeat,
+            this->getLatencyMsFor(next), msPerBeat);
+
+        next.message.setTimeStamp(shiftedBeat);
+
+        // after the messages with the same timestamp, which keeps the order
+        // of the simultaneous events of the same instrument, e.g. note-offs and note-ons
+        int insertIndex = this->pendingMessages.size();
+        while (insertIndex > 0 &&
+            this->pendingMessages.getReference(insertIndex - 1).message.getTimeStamp() > shiftedBeat)
+        {
+            --insertIndex;
+        }
+
+        this->pendingMessages.insert(insertIndex, next);
+    }
+
+    if (this->pendingMessages.isEmpty())
+    {
+        return false;
+    }
+
+    result = this->pendingMessages.getReference(0);
+    this->pendingMessages.remove(0);
+    return true;
+}
+
+double PlayerThread::LatencyCompensator::getShiftedBeat(double beat,
+    double latencyMs, double msPerBeat) const noexcept
+{
+    // the latency is a time offset, so it's converted to beats
+    // at the current tempo, the same way for the notes and the ticks;
+    // nothing can be sent before the seek position or the last sent event,
+    // which only happens right after a seek or a tempo change
+    return jmax(this->minBeat, beat - latencyMs / msPerBeat);
+}
+
+double PlayerThread::LatencyCompensator::getLatencyMsFor(const CachedMidiMessage &message) const noexcept
+{
+    // tempo changes are sent to everybody
+    if (message.message.isMetaEvent())
+    {
+        return 0.0;
+    }
+
+    for (const auto &latency : this->latencies)
+    {
+        if (latency.instrument == message.instrument)
+        {
+            return latency.latencyMs;
+        }
+    }
+
+    return 0.0;
+}
+
+//===----------------------------------------------------------------------===//
+// MetronomeTicker
+//===----------------------------------------------------------------------===//
+
+void PlayerThread::MetronomeTicker::seekToBeat(float beat) noexcept
+{
+    this->rangeIndex = 0;
+    this->tickIndex = 0;
+
+    while (this->rangeIndex < this->ranges.size() &&
+        this->ranges.getReference(this->rangeIndex).endBeat <= beat)
+    {
+        this->rangeIndex++;
+    }
+
+    if (this->rangeIndex < this->ranges.size())
+    {
+        const auto &range = this->ranges.getReference(this->rangeIndex);
+        const auto ticksPassed = (beat - range.startBeat) / range.tickLengthInBeats;
+        this->tickIndex = jmax(0, int(std::ceil(ticksPassed)));
+    }
+
+    this->skipFinishedRanges();
+}
+
+bool PlayerThread::MetronomeTicker::hasNextTick() const noexcept
+{
+    return this->rangeIndex < this->ranges.size();
+}
+
+float PlayerThread::MetronomeTicker::getNextTickBeat() const noexcept
+{
+    const auto &range = this->ranges.getReference(this->rangeIndex);
+    return range.startBeat + float(this->tickIndex) * range.tickLengthInBeats;
+}
+
+MetronomeScheme::Syllable PlayerThread::MetronomeTicker::getNextTickSyllable() const noexcept
+{
+    // accents are counted from the start of each time signature
+    const auto &scheme = this->ranges.getReference(this->rangeIndex).scheme;
+    return scheme.getSyllableAt(this->tickIndex % scheme.getSize());
+}
+
+void PlayerThread::MetronomeTicker::advance() noexcept
+{
+    this->tickIndex++;
+    this->skipFinishedRanges();
+}
+
+void PlayerThread::MetronomeTicker::skipFinishedRanges() noexcept
+{
+    while (this->hasNextTick() &&
+        this->getNextTickBeat() >= this->ranges.getReference(this->rangeIndex).endBeat)
+    {
+        this->rangeIndex++;
+        this->tickIndex = 0;
+    }
+}
@@ -44,6 +44,90 @@ private:
 
     Atomic<double> currentTempo = 0.f;
 
+    // generates the metronome ticks from the time signature ranges
+    // of the playback context, to be merged with the cached messages
+    class MetronomeTicker final
+    {
+    public:
+
+        explicit MetronomeTicker(const Array<Transport::PlaybackContext::MetronomeRange> &ranges) :
+            ranges(ranges) {}
+
+        void seekToBeat(float beat) noexcept;
+
+        bool hasNextTick() const noexcept;
+        float getNextTickBeat() const noexcept;
+        MetronomeScheme::Syllable getNextTickSyllable() const noexcept;
+        void advance() noexcept;
+
+    private:
+
+        void skipFinishedRanges() noexcept;
+
+        const Array<Transport::PlaybackContext::MetronomeRange> &ranges;
+
+        int rangeIndex = 0;
+        int tickIndex = 0;
+
+        JUCE_DECLARE_NON_COPYABLE(MetronomeTicker)
+    };
+
+    // Merges the cached messages with the metronome ticks and reorders them,
+    // so that each instrument, including the metronome, receives them earlier
+    // by its graph's latency, converted to beats at the current tempo,
+    // and the instruments with latent plugins sound in time with the others;
+    // the message timestamps are shifted accordingly
+    class LatencyCompensator final
+    {
+    public:
+
+        LatencyCompensator(TransportPlaybackCache &sequences,
+            const Array<Instrument *> &instruments, MetronomeTicker &metronome,
+            MidiMessageCollector *metronomeListener, double metronomeLatencyMs);
+
+        // to be called after each seek of the sequences and the metronome
+        void reset(float beat) noexcept;
+
+        bool getNextEvent(CachedMidiMessage &result,
+            bool &isMetronomeTick, double msPerBeat);
+
+    private:
+
+        bool getNextMessage(CachedMidiMessage &result, double msPerBeat);
+
+        double getLatencyMsFor(const CachedMidiMessage &message) const noexcept;
+        double getShiftedBeat(double beat, double latencyMs, double msPerBeat) const noexcept;
+
+        TransportPlaybackCache &sequences;
+        MetronomeTicker &metronome;
+
+        MidiMessageCollector *const metronomeListener;
+        const double metronomeLatencyMs;
+
+        struct InstrumentLatency final
+        {
+            Instrument *instrument;
+            double latencyMs;
+        };
+
+        Array<InstrumentLatency> latencies;
+        double maxLatencyMs = 0.0;
+
+        // sorted by the shifted timestamps
+        Array<CachedMidiMessage> pendingMessages;
+        bool hasMoreMessages = true;
+        double lastFetchedBeat = 0.0;
+
+        // the next cached message is fetched ahead to merge it with metronome ticks
+        CachedMidiMessage nextMessage;
+        bool hasNextMessage = false;
+
+        // the timestamp of the last event returned, or the seek position
+        double minBeat = 0.0;
+
+        JUCE_DECLARE_NON_COPYABLE(LatencyCompensator)
+    };
+
     // check if the thread needs to stop at least every x ms:
     static constexpr auto minStopCheckTimeMs = 200;
 
@@ -133,11 +133,51 @@ struct RenderBuffer final
     Instrument *instrument;
     AudioBuffer<float> sampleBuffer;
     MidiBuffer midiBuffer;
+
+    // delays the output of the instruments with less latency than others,
+    // so that all of them are aligned with the most latent one
+    AudioBuffer<float> delayLine;
+    int delayLinePosition = 0;
+
+    void setDelay(int numChannels, int numSamples)
+    {
+        this->delayLine.setSize(numChannels, numSamples);
+        this->delayLine.clear();
+        this->delayLinePosition = 0;
+    }
+
+    void applyDelay()
+    {
+        const auto delaySize = this->delayLine.getNumSamples();
+        if (delaySize == 0)
+        {
+            return;
+        }
+
+        const auto numChannels = jmin(this->delayLine.getNumChannels(),
+            this->sampleBuffer.getNumChannels());
+
+        int position = this->delayLinePosition;
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto *samples = this->sampleBuffer.getWritePointer(channel);
+            auto *delayed = this->delayLine.getWritePointer(channel);
+
+            position = this->delayLinePosition;
+            for (int i = 0; i < this->sampleBuffer.getNumSamples(); ++i)
+            {
+                std::swap(samples[i], delayed[position]);
+                position = (position + 1) % delaySize;
+            }
+        }
+
+        this->delayLinePosition = position;
+    }
 };
 
 void RendererThread::run()
 {
-    auto sequences = this->transport.buildPlaybackCache(false);
+    auto sequences = this->transport.buildPlaybackCache();
     sequences.seekToStart();
 
     CachedMidiMessage nextMessage;
@@ -194,6 +234,23 @@ void RendererThread::run()
     // let the processor graphs handle their async updates
     Thread::sleep(200);
 
+    // the latency compensation: the instruments' outputs are delayed
+    // to match the most latent one, and the whole mix is shifted back,
+    // i.e. the first maxLatency samples are skipped, and the tail is extended
+    int maxLatency = 0;
+    for (auto *subBuffer : subBuffers)
+    {
+        maxLatency = jmax(maxLatency, subBuffer->instrument->getLatencySamples());
+    }
+
+    for (auto *subBuffer : subBuffers)
+    {
+        subBuffer->setDelay(numOutChannels,
+            maxLatency - subBuffer->instrument->getLatencySamples());
+    }
+
+    int numSamplesToSkip = maxLatency;
+
     // the render loop itself
     
     // TODO: add double precision rendering someday (for processor graphs who support it)
@@ -207,7 +264,7 @@ void RendererThread::run()
     double nextEventTickDelta = 0.0;
 
     const double firstFrame = prevEventTick * sampleRate;
-    const double lastFrame = firstFrame + totalFrames;
+    const double lastFrame = firstFrame + totalFrames + maxLatency;
 
     double currentFrame = firstFrame;
     int messageFrame = 0;
@@ -284,6 +341,7 @@ void RendererThread::run()
             }
 
             subBuffer->midiBuffer.clear();
+            subBuffer->applyDelay();
             //Thread::yield();
         }
 
@@ -301,10 +359,15 @@ void RendererThread::run()
             }
         }
 
+        const auto numSamplesSkipped = jmin(numSamplesToSkip, bufferSize);
+        numSamplesToSkip -= numSamplesSkipped;
+
+        if (numSamplesSkipped < bufferSize)
         {
             const ScopedLock lock(this->writerLock);
             const bool writtenSuccessfully =
-                this->writer->writeFromAudioSampleBuffer(mixingBuffer, 0, mixingBuffer.getNumSamples());
+                this->writer->writeFromAudioSampleBuffer(mixingBuffer,
+                    numSamplesSkipped, bufferSize - numSamplesSkipped);
 
             if (!writtenSuccessfully)
             {
@@ -318,7 +381,7 @@ void RendererThread::run()
 
         const auto peakLevel = mixingBuffer.getMagnitude(0, mixingBuffer.getNumSamples());
 
-        this->percentsDone = float((currentFrame - firstFrame) / totalFrames);
+        this->percentsDone = jmin(1.f, float((currentFrame - firstFrame) / totalFrames));
 
         jassert(this->waveformThumbnail.size() > 0);
         const auto waveformFrameIndex =
@@ -30,6 +30,7 @@
 #include "KeyboardMapping.h"
 #include "ProjectMetadata.h"
 #include "ProjectTimeline.h"
+#include "TimeSignatureEvent.h"
 #include "BuiltInMicrotonalPlugin.h"
 #include "DefaultSynthAudioPlugin.h"
 
@@ -43,7 +44,6 @@ Transport::Transport(ProjectNode &project, OrchestraPit &orchestraPit) :
     this->renderer = make<RendererThread>(*this);
 
     this->project.addListener(this);
-    this->project.getTimeline()->getTimeSignaturesAggregator()->addListener(this);
     this->orchestra.addOrchestraListener(this);
 
     App::Config().getUiFlags()->addListener(this);
@@ -54,7 +54,6 @@ Transport::~Transport()
     App::Config().getUiFlags()->removeListener(this);
 
     this->orchestra.removeOrchestraListener(this);
-    this->project.getTimeline()->getTimeSignaturesAggregator()->removeListener(this);
     this->project.removeListener(this);
 
     this->renderer = nullptr;
@@ -640,25 +639,9 @@ void Transport::allNotesControllersAndSoundOff() const
 
 void Transport::onMetronomeFlagChanged(bool enabled)
 {
-    // metronome events are the part of playback cache,
-    // so we will have to rebuild it when the playback starts:
-    this->isMetronomeEnabled = enabled;
-    this->stopPlaybackAndRecording();
-    this->playbackCacheIsOutdated = true;
-}
-
-//===----------------------------------------------------------------------===//
-// TimeSignaturesAggregator::Listener
-//===----------------------------------------------------------------------===//
-
-void Transport::onTimeSignaturesUpdated()
-{
-    // almost same logic as in onMetronomeFlagChanged:
-    if (this->isMetronomeEnabled)
-    {
-        // this->stopPlaybackAndRecording(); // that's kinda too intrusive
-        this->playbackCacheIsOutdated = true;
-    }
+    // metronome ticks are generated by the player, which checks this flag
+    // for every tick, so there's no need to stop it or to rebuild the cache:
+    this->metronomeEnabled = enabled;
 }
 
 //===----------------------------------------------------------------------===//
@@ -733,6 +716,20 @@ void Transport::onAddMidiEvent(const MidiEvent &event)
 }
 
 void Transport::onRemoveMidiEvent(const MidiEvent &event) {}
+
+// all events of a group belong to the same track,
+// so the playback cache only needs to be invalidated once
+
+void Transport::onAddMidiEvents(const Array<const MidiEvent *> &events)
+{
+    this->onAddMidiEvent(*events.getFirst());
+}
+
+void Transport::onChangeMidiEvents(const Array<const MidiEvent *> &oldEvents,
+    const Array<const MidiEvent *> &newEvents)
+{
+    this->onChangeMidiEvent(*oldEvents.getFirst(), *newEvents.getFirst());
+}
 void Transport::onPostRemoveMidiEvent(MidiSequence *const sequence)
 {
     this->stopPlaybackAndRecording();
@@ -1016,9 +1013,65 @@ Transport::PlaybackContext::Ptr Transport::fillPlaybackContextAt(float targetBea
     context->totalTimeMs += (tempo * (this->projectLastBeat.get() - prevTimestamp));
     //jassert(context->totalTimeMs == this->findTimeAt(this->projectLastBeat.get()));
 
+    this->fillMetronomeRanges(*context);
+
     return context;
 }
 
+void Transport::fillMetronomeRanges(PlaybackContext &context) const
+{
+    auto *metronome = this->orchestra.getMetronomeInstrument();
+    if (metronome == nullptr)
+    {
+        return;
+    }
+
+    context.metronomeListener = &metronome->getProcessorPlayer().getMidiMessageCollector();
+    context.metronomeLatencyMs = metronome->getLatencyMs();
+
+    const auto firstBeat = this->projectFirstBeat.get();
+    const auto lastBeat = this->projectLastBeat.get();
+
+    const auto *timeSignatures =
+        this->project.getTimeline()->getTimeSignaturesAggregator()->getSequence();
+
+    if (timeSignatures->isEmpty())
+    {
+        PlaybackContext::MetronomeRange range;
+        range.startBeat = firstBeat;
+        range.endBeat = lastBeat;
+        context.metronomeRanges.add(range);
+        return;
+    }
+
+    // the beats before the first time signature use its meter,
+    // but their accents are counted from the project start:
+    const auto *firstEvent = static_cast<const TimeSignatureEvent *>(timeSignatures->getUnchecked(0));
+    if (firstBeat < firstEvent->getBeat())
+    {
+        PlaybackContext::MetronomeRange range;
+        range.startBeat = firstBeat;
+        range.endBeat = firstEvent->getBeat();
+        range.tickLengthInBeats = firstEvent->getDenominatorInBeats();
+        range.scheme = firstEvent->getMeter().getMetronome();
+        context.metronomeRanges.add(range);
+    }
+
+    for (int i = 0; i < timeSignatures->size(); ++i)
+    {
+        const auto *event = static_cast<const TimeSignatureEvent *>(timeSignatures->getUnchecked(i));
+        jassert(event->getMeter().getMetronome().isValid());
+
+        PlaybackContext::MetronomeRange range;
+        range.startBeat = event->getBeat();
+        range.endBeat = (i < timeSignatures->size() - 1) ?
+            timeSignatures->getUnchecked(i + 1)->getBeat() : lastBeat;
+        range.tickLengthInBeats = event->getDenominatorInBeats();
+        range.scheme = event->getMeter().getMetronome();
+        context.metronomeRanges.add(range);
+    }
+}
+
 //===----------------------------------------------------------------------===//
 // Playback cache management
 //===----------------------------------------------------------------------===//
@@ -1041,18 +1094,21 @@ void Transport::rebuildPlaybackCacheIfNeeded() const
 {
     if (this->playbackCacheIsOutdated.get())
     {
-        this->playbackCache = this->buildPlaybackCache(this->isMetronomeEnabled);
+        this->playbackCache = this->buildPlaybackCache();
         this->playbackCacheIsOutdated = false;
     }
 }
 
-TransportPlaybackCache Transport::buildPlaybackCache(bool withMetronome) const
+TransportPlaybackCache Transport::buildPlaybackCache() const
 {
     TransportPlaybackCache result;
     
     this->hasSoloClipsCache = this->findSoloClipFlagIfAny();
     auto &generatedSequences = *this->project.getGeneratedSequences();
 
+    // all clips of a track are collected unsorted and sorted once
+    Array<MidiMessage> exportedMessages;
+
     for (const auto *track : this->tracksCache)
     {
         const auto instrument = this->instrumentLinks[track->getTrackId()];
@@ -1065,21 +1121,23 @@ TransportPlaybackCache Transport::buildPlaybackCache(bool withMetronome) const
         {
             for (const auto *clip : track->getPattern()->getClips())
             {
-                cached->sequence->exportMidi(cached->midiMessages, *clip,
+                cached->sequence->exportMidi(exportedMessages, *clip,
                     keyMapping, generatedSequences,
-                    this->hasSoloClipsCache, withMetronome,
+                    this->hasSoloClipsCache,
                     this->projectFirstBeat.get(), this->projectLastBeat.get());
             }
         }
         else
         {
             static Clip noTransform;
-            cached->sequence->exportMidi(cached->midiMessages, noTransform,
+            cached->sequence->exportMidi(exportedMessages, noTransform,
                 keyMapping, generatedSequences,
-                this->hasSoloClipsCache, withMetronome,
+                this->hasSoloClipsCache,
                 this->projectFirstBeat.get(), this->projectLastBeat.get());
         }
 
+        MidiSequence::flushExportedMessages(exportedMessages, cached->midiMessages);
+
         result.addWrapper(cached);
     }
 
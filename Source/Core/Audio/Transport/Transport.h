@@ -31,13 +31,13 @@ class RendererThread;
 #include "RenderFormat.h"
 #include "Instrument.h"
 #include "Temperament.h"
+#include "Meter.h"
 #include "UserInterfaceFlags.h"
 #include "Config.h"
 
 class Transport final : public Serializable,
     public ProjectListener,
     public OrchestraListener,
-    public TimeSignaturesAggregator::Listener,
     public UserInterfaceFlags::Listener // needs the metronome on/off flag changes
 {
 public:
@@ -120,6 +120,21 @@ public:
 
         bool playbackLoopMode = false;
 
+        // the metronome ticks are not the part of the playback cache,
+        // instead the player generates them from these time signature ranges,
+        // so that enabling or disabling the metronome needs no cache rebuild
+        struct MetronomeRange final
+        {
+            float startBeat = 0.f;
+            float endBeat = 0.f;
+            float tickLengthInBeats = 1.f;
+            MetronomeScheme scheme;
+        };
+
+        Array<MetronomeRange> metronomeRanges;
+        MidiMessageCollector *metronomeListener = nullptr;
+        double metronomeLatencyMs = 0.0;
+
         // computed CC values: -1 if not found in any track,
         // otherwise, the controller value at the time of playback start;
         // CC numbers 102119 are undefined, and numbers 120-127 are
@@ -130,6 +145,12 @@ public:
 
     PlaybackContext::Ptr fillPlaybackContextAt(float beat) const;
 
+    // can be toggled during playback, the player checks it for each tick:
+    bool isMetronomeEnabled() const noexcept
+    {
+        return this->metronomeEnabled.get();
+    }
+
     TransportPlaybackCache getPlaybackCache();
 
     float getProjectFirstBeat() const noexcept
@@ -165,12 +186,6 @@ public:
 
     void onMetronomeFlagChanged(bool enabled) override;
 
-    //===------------------------------------------------------------------===//
-    // TimeSignaturesAggregator::Listener
-    //===------------------------------------------------------------------===//
-
-    void onTimeSignaturesUpdated() override;
-
     //===------------------------------------------------------------------===//
     // OrchestraListener
     //===------------------------------------------------------------------===//
@@ -188,6 +203,9 @@ public:
     void onAddMidiEvent(const MidiEvent &event) override;
     void onRemoveMidiEvent(const MidiEvent &event) override;
     void onPostRemoveMidiEvent(MidiSequence *const layer) override;
+    void onAddMidiEvents(const Array<const MidiEvent *> &events) override;
+    void onChangeMidiEvents(const Array<const MidiEvent *> &oldEvents,
+        const Array<const MidiEvent *> &newEvents) override;
 
     void onAddClip(const Clip &clip) override;
     void onChangeClip(const Clip &oldClip, const Clip &newClip) override;
@@ -253,7 +271,9 @@ private:
     mutable TransportPlaybackCache playbackCache;
     mutable Atomic<bool> playbackCacheIsOutdated = true;
     void rebuildPlaybackCacheIfNeeded() const;
-    TransportPlaybackCache buildPlaybackCache(bool withMetronome) const;
+    TransportPlaybackCache buildPlaybackCache() const;
+
+    void fillMetronomeRanges(PlaybackContext &context) const;
 
     mutable bool hasSoloClipsCache = false;
     bool findSoloClipFlagIfAny() const;
@@ -319,7 +339,7 @@ private:
     Atomic<float> loopStartBeat = 0.f;
     Atomic<float> loopEndBeat = Globals::Defaults::projectLength;
 
-    bool isMetronomeEnabled = App::Config().getUiFlags()->isMetronomeEnabled();
+    Atomic<bool> metronomeEnabled = App::Config().getUiFlags()->isMetronomeEnabled();
 
     ListenerList<TransportListener> transportListeners;
 
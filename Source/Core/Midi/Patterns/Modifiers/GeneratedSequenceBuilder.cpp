@@ -121,6 +121,25 @@ void GeneratedSequenceBuilder::onRemoveMidiEvent(const MidiEvent &event)
     }
 }
 
+// all events of a group belong to the same sequence,
+// so the first one tells which clips need to be rebuilt
+
+void GeneratedSequenceBuilder::onAddMidiEvents(const Array<const MidiEvent *> &events)
+{
+    this->onAddMidiEvent(*events.getFirst());
+}
+
+void GeneratedSequenceBuilder::onChangeMidiEvents(const Array<const MidiEvent *> &oldEvents,
+    const Array<const MidiEvent *> &newEvents)
+{
+    this->onChangeMidiEvent(*oldEvents.getFirst(), *newEvents.getFirst());
+}
+
+void GeneratedSequenceBuilder::onRemoveMidiEvents(const Array<const MidiEvent *> &events)
+{
+    this->onRemoveMidiEvent(*events.getFirst());
+}
+
 void GeneratedSequenceBuilder::onAddClip(const Clip &clip)
 {
     if (clip.hasModifiers())
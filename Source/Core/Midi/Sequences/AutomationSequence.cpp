@@ -22,6 +22,7 @@
 #include "ProjectNode.h"
 #include "MidiTrackNode.h"
 #include "UndoStack.h"
+#include "MidiTrack.h"
 
 AutomationSequence::AutomationSequence(MidiTrack &track,
     ProjectEventDispatcher &dispatcher) noexcept :
@@ -47,9 +48,10 @@ float AutomationSequence::getAverageControllerValue() const
 void AutomationSequence::importMidi(const MidiMessageSequence &sequence,
     short timeFormat, Optional<int> filterByCV)
 {
-    this->clearUndoHistory();
-    this->checkpoint();
-    
+    // doesn't touch the undo stack, so that the tracks
+    // can be imported in parallel, see ProjectNode::importMidi
+    Array<MidiEvent *> importedEvents;
+
     for (int i = 0; i < sequence.getNumEvents(); ++i)
     {
         const auto &message = sequence.getEventPointer(i)->message;
@@ -64,20 +66,56 @@ void AutomationSequence::importMidi(const MidiMessageSequence &sequence,
             }
 
             const int controllerValue = message.getControllerValue();
-            const AutomationEvent event(this, startBeat, float(controllerValue) / 127.f);
-            this->importMidiEvent<AutomationEvent>(event);
+            importedEvents.add(new AutomationEvent(this, startBeat, float(controllerValue) / 127.f));
         }
         else if (message.isTempoMetaEvent())
         {
             const float controllerValue = Transport::getControllerValueByTempo(message.getTempoSecondsPerQuarterNote());
-            const AutomationEvent event(this, startBeat, controllerValue);
-            this->importMidiEvent<AutomationEvent>(event);
+            importedEvents.add(new AutomationEvent(this, startBeat, controllerValue));
         }
     }
-    
+
+    this->addSortedGroup<AutomationEvent>(importedEvents);
     this->updateBeatRange(false);
 }
 
+void AutomationSequence::exportMidi(Array<MidiMessage> &outMessages,
+    const Clip &clip, const KeyboardMapping &keyMap,
+    GeneratedSequenceBuilder &generatedSequences,
+    bool projectHasSoloClips,
+    float projectFirstBeat, float projectLastBeat,
+    double timeFactor /*= 1.0*/) const
+{
+    if (this->midiEvents.isEmpty() ||
+        !MidiSequence::isClipAudible(clip, projectHasSoloClips))
+    {
+        return;
+    }
+
+    jassert(!clip.hasModifiers()); // only piano clips have them
+
+    const auto *track = this->getTrack();
+    const auto isTempoTrack = track->isTempoTrack();
+    const auto shouldInterpolate = !track->isOnOffAutomationTrack();
+    const auto channel = track->getTrackChannel();
+    const auto controllerNumber = track->getTrackControllerNumber();
+
+    // the events are sorted, so each one's curve ends at the next one,
+    // no need to look the neighbours up for each event
+    for (int i = 0; i < this->midiEvents.size(); ++i)
+    {
+        const auto *event = static_cast<const AutomationEvent *>(this->midiEvents.getUnchecked(i));
+        event->exportMessages(outMessages, clip, keyMap, timeFactor);
+
+        if (shouldInterpolate && i < this->midiEvents.size() - 1)
+        {
+            const auto *nextEvent = static_cast<const AutomationEvent *>(this->midiEvents.getUnchecked(i + 1));
+            AutomationEvent::exportCurve(outMessages, clip, *event, *nextEvent,
+                channel, controllerNumber, isTempoTrack, timeFactor);
+        }
+    }
+}
+
 //===----------------------------------------------------------------------===//
 // Undoable track editing
 //===----------------------------------------------------------------------===//
@@ -307,3 +345,92 @@ void AutomationSequence::reset()
     this->midiEvents.clear();
     this->usedEventIds.clear();
 }
+
+//===----------------------------------------------------------------------===//
+// Tests
+//===----------------------------------------------------------------------===//
+
+#if JUCE_UNIT_TESTS
+
+class AutomationCurveExportTests final : public UnitTest
+{
+public:
+    AutomationCurveExportTests() : UnitTest("Automation curve export tests", UnitTestCategories::helio) {}
+
+    void runTest() override
+    {
+        beginTest("Tabulated curves");
+
+        for (const auto curvature : { 0.f, 0.25f, 0.5f, 1.f })
+        {
+            for (int i = 0; i <= 1000; ++i)
+            {
+                const auto factor = float(i) / 1000.f;
+                expectWithinAbsoluteError(AutomationEvent::interpolateEvents(0.1f, 0.9f, factor, curvature),
+                    interpolateEventsWithPow(0.1f, 0.9f, factor, curvature), 0.0005f);
+                expectWithinAbsoluteError(AutomationEvent::interpolateEvents(0.9f, 0.1f, factor, curvature),
+                    interpolateEventsWithPow(0.9f, 0.1f, factor, curvature), 0.0005f);
+            }
+        }
+
+        beginTest("Adaptive curve points");
+
+        const Clip clip;
+        const AutomationEvent e1(nullptr, 0.f, 0.f);
+        const AutomationEvent e2(nullptr, 16.f, 1.f);
+
+        Array<MidiMessage> messages;
+        AutomationEvent::exportCurve(messages, clip, e1, e2, 1, 1, false, 1.0);
+
+        // each point changes the value by more than the threshold
+        expect(messages.size() > 16);
+        expect(messages.size() < int(1.f / AutomationEvent::curveInterpolationThreshold));
+
+        for (int i = 1; i < messages.size(); ++i)
+        {
+            expect(messages[i].getTimeStamp() > messages[i - 1].getTimeStamp());
+            expect(messages[i].getControllerValue() >= messages[i - 1].getControllerValue());
+        }
+
+        expect(messages.getLast().getTimeStamp() < 16.0);
+
+        beginTest("Tempo curve points");
+
+        // the tempo is not quantized to controller steps, so the tempo curves
+        // are exported denser, but still within the step limits
+        Array<MidiMessage> tempoMessages;
+        AutomationEvent::exportCurve(tempoMessages, clip, e1, e2, 1, 1, true, 1.0);
+
+        expect(tempoMessages.size() > messages.size());
+        expect(tempoMessages.size() < int(16.f / AutomationEvent::curveExportMinStepBeat));
+
+        for (int i = 1; i < tempoMessages.size(); ++i)
+        {
+            expect(tempoMessages[i].isTempoMetaEvent());
+            expect(tempoMessages[i].getTimeStamp() - tempoMessages[i - 1].getTimeStamp() >=
+                double(AutomationEvent::curveExportMinStepBeat) - 0.0001);
+        }
+
+        beginTest("Flat curves");
+
+        messages.clearQuick();
+        const AutomationEvent e3(nullptr, 32.f, 1.f);
+        AutomationEvent::exportCurve(messages, clip, e2, e3, 1, 1, false, 1.0);
+        expect(messages.isEmpty());
+    }
+
+private:
+
+    static float interpolateEventsWithPow(float cv1, float cv2, float factor, float curvature)
+    {
+        const float easing = (cv1 > cv2) ? curvature : (1.f - curvature);
+        const float delta = cv2 - cv1;
+        const float easeIn = delta * powf(2.f, 8.f * (factor - 1.f)) * easing;
+        const float easeOut = delta * (-powf(2.f, -8.f * factor) + 1.f) * (1.f - easing);
+        return cv1 + (easeIn + easeOut);
+    }
+};
+
+static AutomationCurveExportTests automationCurveExportTests;
+
+#endif
@@ -59,6 +59,13 @@ public:
     void importMidi(const MidiMessageSequence &sequence,
         short timeFormat, Optional<int> filterByCV) override;
 
+    void exportMidi(Array<MidiMessage> &outMessages,
+        const Clip &clip, const KeyboardMapping &keyMap,
+        GeneratedSequenceBuilder &generatedSequences,
+        bool soloPlaybackMode,
+        float projectFirstBeat, float projectLastBeat,
+        double timeFactor = 1.0) const override;
+
     //===------------------------------------------------------------------===//
     // Serializable
     //===------------------------------------------------------------------===//
@@ -44,12 +44,12 @@ AnnotationEvent::AnnotationEvent(WeakReference<MidiSequence> owner,
     colour(parametersToCopy.colour),
     length(parametersToCopy.length) {}
 
-void AnnotationEvent::exportMessages(MidiMessageSequence &outSequence,
+void AnnotationEvent::exportMessages(Array<MidiMessage> &outMessages,
     const Clip &clip, const KeyboardMapping &keyMap, double timeFactor) const noexcept
 {
     MidiMessage event(MidiMessage::textMetaEvent(1, this->getDescription()));
     event.setTimeStamp((this->beat + clip.getBeat()) * timeFactor);
-    outSequence.addEvent(event);
+    outMessages.add(event);
 }
 
 AnnotationEvent AnnotationEvent::withDeltaBeat(float beatOffset) const noexcept
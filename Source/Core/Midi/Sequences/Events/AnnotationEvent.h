@@ -32,7 +32,7 @@ public:
         const String &description = "",
         const Colour &newColour = Colours::white) noexcept;
     
-    void exportMessages(MidiMessageSequence &outSequence, const Clip &clip,
+    void exportMessages(Array<MidiMessage> &outMessages, const Clip &clip,
         const KeyboardMapping &keyMap, double timeFactor) const noexcept override;
 
     AnnotationEvent withDeltaBeat(float beatOffset) const noexcept;
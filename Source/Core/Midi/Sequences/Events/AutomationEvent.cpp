@@ -36,87 +36,130 @@ AutomationEvent::AutomationEvent(WeakReference<MidiSequence> owner,
     controllerValue(parametersToCopy.controllerValue),
     curvature(parametersToCopy.curvature) {}
 
-float easeInExpo(float delta, float factor)
+// the curve shapes only depend on the factor, so they are tabulated once,
+// and linearly interpolated instead of calling powf for each point
+struct AutomationCurveTables final
 {
-    return delta * powf(2.f, 8.f * (factor - 1.f));
+    AutomationCurveTables()
+    {
+        for (int i = 0; i <= AutomationCurveTables::size; ++i)
+        {
+            const auto factor = float(i) / float(AutomationCurveTables::size);
+            this->easeIn[i] = powf(2.f, 8.f * (factor - 1.f));
+            this->easeOut[i] = 1.f - powf(2.f, -8.f * factor);
+        }
+    }
+
+    static inline float lookup(const float *table, float factor) noexcept
+    {
+        const auto position = jlimit(0.f, 1.f, factor) * float(AutomationCurveTables::size);
+        const auto index = jmin(int(position), AutomationCurveTables::size - 1);
+        const auto fraction = position - float(index);
+        return table[index] + (table[index + 1] - table[index]) * fraction;
+    }
+
+    static constexpr auto size = 256;
+
+    float easeIn[size + 1];
+    float easeOut[size + 1];
 };
 
-float easeOutExpo(float delta, float factor)
+static const AutomationCurveTables curveTables;
+
+// easing == 0: ease out
+// easing == 1: ease in
+static inline float getCurveEasing(float cv1, float cv2, float curvature) noexcept
 {
-    return delta * (-powf(2.f, -8.f * factor) + 1.f);
-};
+    return (cv1 > cv2) ? curvature : (1.f - curvature);
+}
 
 float AutomationEvent::interpolateEvents(float cv1, float cv2, float factor, float curvature)
 {
-    // easing == 0: ease out
-    // easing == 1: ease in
-    const float easing = (cv1 > cv2) ? curvature : (1.f - curvature);
-    const float delta = cv2 - cv1;
-    const float easeIn = easeInExpo(delta, factor) * easing;
-    const float easeOut = easeOutExpo(delta, factor) * (1.f - easing);
-    return cv1 + (easeIn + easeOut);
+    const float easing = getCurveEasing(cv1, cv2, curvature);
+    const float easeIn = AutomationCurveTables::lookup(curveTables.easeIn, factor) * easing;
+    const float easeOut = AutomationCurveTables::lookup(curveTables.easeOut, factor) * (1.f - easing);
+    return cv1 + (cv2 - cv1) * (easeIn + easeOut);
+}
+
+float AutomationEvent::getCurveSlope(float cv1, float cv2, float factor, float curvature)
+{
+    // the derivatives of 2^(8(f - 1)) and 1 - 2^(-8f) are proportional
+    // to the functions themselves, so the same tables are used
+    static constexpr auto k = 8.f * 0.6931472f; // 8 ln 2
+    const float easing = getCurveEasing(cv1, cv2, curvature);
+    const float easeIn = AutomationCurveTables::lookup(curveTables.easeIn, factor) * easing;
+    const float easeOut = (1.f - AutomationCurveTables::lookup(curveTables.easeOut, factor)) * (1.f - easing);
+    return (cv2 - cv1) * k * (easeIn + easeOut);
+}
+
+static inline MidiMessage makeAutomationMessage(float controllerValue,
+    int channel, int controllerNumber, bool isTempoTrack, double timeStamp)
+{
+    auto message = isTempoTrack ?
+        MidiMessage::tempoMetaEvent(Transport::getTempoByControllerValue(controllerValue)) :
+        MidiMessage::controllerEvent(channel, controllerNumber, int(controllerValue * 127));
+
+    message.setTimeStamp(timeStamp);
+    return message;
 }
 
-void AutomationEvent::exportMessages(MidiMessageSequence &outSequence,
+void AutomationEvent::exportMessages(Array<MidiMessage> &outMessages,
     const Clip &clip, const KeyboardMapping &keyMap, double timeFactor) const noexcept
 {
-    MidiMessage cc;
-    const bool isTempoTrack = this->getSequence()->getTrack()->isTempoTrack();
+    const double startTime = (this->beat + clip.getBeat()) * timeFactor;
+    outMessages.add(makeAutomationMessage(this->controllerValue,
+        this->getTrackChannel(), this->getTrackControllerNumber(),
+        this->getSequence()->getTrack()->isTempoTrack(), startTime));
+}
 
-    if (isTempoTrack)
-    {
-        cc = MidiMessage::tempoMetaEvent(Transport::getTempoByControllerValue(this->controllerValue));
-    }
-    else
+void AutomationEvent::exportCurve(Array<MidiMessage> &outMessages, const Clip &clip,
+    const AutomationEvent &e1, const AutomationEvent &e2,
+    int channel, int controllerNumber, bool isTempoTrack, double timeFactor)
+{
+    const float cv1 = e1.controllerValue;
+    const float cv2 = e2.controllerValue;
+    const float length = e2.beat - e1.beat;
+
+    if (length <= 0.f ||
+        fabsf(cv2 - cv1) <= AutomationEvent::curveInterpolationThreshold)
     {
-        cc = MidiMessage::controllerEvent(this->getTrackChannel(),
-            this->getTrackControllerNumber(), int(this->controllerValue * 127));
+        return;
     }
 
-    const double startTime = (this->beat + clip.getBeat()) * timeFactor;
-    cc.setTimeStamp(startTime);
-    outSequence.addEvent(cc);
-
-    // add interpolated events, if needed
-    auto *sequence = static_cast<AutomationSequence *>(this->getSequence());
-    const int indexOfThis = sequence->indexOfSorted(this);
-    const bool isPedalOrSwitchEvent = this->getSequence()->getTrack()->isOnOffAutomationTrack();
-    if (!isPedalOrSwitchEvent && indexOfThis >= 0 && indexOfThis < (this->getSequence()->size() - 1))
+    float interpolatedBeat = e1.beat;
+    float lastAppliedValue = cv1;
+
+    const float valueStep = isTempoTrack ?
+        AutomationEvent::curveInterpolationThreshold :
+        AutomationEvent::curveExportValueStep;
+
+    while (true)
     {
-        const auto *nextEvent = static_cast<AutomationEvent *>(this->getSequence()->getUnchecked(indexOfThis + 1));
-        float interpolatedBeat = this->beat + AutomationEvent::curveInterpolationStepBeat;
-        float lastAppliedValue = this->controllerValue;
+        // the step is chosen so that the value changes by about
+        // one value step, judging by the slope at the current point
+        const float factor = (interpolatedBeat - e1.beat) / length;
+        const float slopePerBeat = fabsf(AutomationEvent::getCurveSlope(cv1, cv2, factor, e1.curvature)) / length;
+        const float step = slopePerBeat > 0.f ?
+            jlimit(AutomationEvent::curveExportMinStepBeat, AutomationEvent::curveExportMaxStepBeat,
+                valueStep / slopePerBeat) :
+            AutomationEvent::curveExportMaxStepBeat;
+
+        interpolatedBeat += step;
+        if (interpolatedBeat >= e2.beat)
+        {
+            break;
+        }
 
-        while (interpolatedBeat < nextEvent->beat)
+        const float interpolatedValue = AutomationEvent::interpolateEvents(cv1, cv2,
+            (interpolatedBeat - e1.beat) / length, e1.curvature);
+
+        if (fabsf(interpolatedValue - lastAppliedValue) > AutomationEvent::curveInterpolationThreshold)
         {
-            const float factor = (interpolatedBeat - this->beat) / (nextEvent->beat - this->beat);
-
-            const float interpolatedValue =
-                AutomationEvent::interpolateEvents(this->controllerValue,
-                    nextEvent->controllerValue, factor, this->curvature);
-
-            const float controllerDelta = fabsf(interpolatedValue - lastAppliedValue);
-            if (controllerDelta > AutomationEvent::curveInterpolationThreshold)
-            {
-                const double interpolatedTs = (interpolatedBeat + clip.getBeat()) * timeFactor;
-                if (isTempoTrack)
-                {
-                    MidiMessage ci(MidiMessage::tempoMetaEvent(Transport::getTempoByControllerValue(interpolatedValue)));
-                    ci.setTimeStamp(interpolatedTs);
-                    outSequence.addEvent(ci);
-                }
-                else
-                {
-                    MidiMessage ci(MidiMessage::controllerEvent(this->getTrackChannel(),
-                        this->getTrackControllerNumber(), int(interpolatedValue * 127)));
-                    ci.setTimeStamp(interpolatedTs);
-                    outSequence.addEvent(ci);
-                }
-
-                lastAppliedValue = interpolatedValue;
-            }
-
-            interpolatedBeat += AutomationEvent::curveInterpolationStepBeat;
+            const double interpolatedTs = (interpolatedBeat + clip.getBeat()) * timeFactor;
+            outMessages.add(makeAutomationMessage(interpolatedValue,
+                channel, controllerNumber, isTempoTrack, interpolatedTs));
+
+            lastAppliedValue = interpolatedValue;
         }
     }
 }
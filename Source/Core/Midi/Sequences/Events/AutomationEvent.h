@@ -38,14 +38,31 @@ public:
         float beatVal = 0.f,
         float controllerValue = 0.f) noexcept;
 
-    void exportMessages(MidiMessageSequence &outSequence, const Clip &clip,
+    // exports this event only, the curves between the events are exported
+    // by AutomationSequence::exportMidi, which walks the events pairwise
+    void exportMessages(Array<MidiMessage> &outMessages, const Clip &clip,
         const KeyboardMapping &keyMap, double timeFactor) const noexcept override;
 
+    // exports the interpolated points between two adjacent events,
+    // placed more densely where the curve is steeper
+    static void exportCurve(Array<MidiMessage> &outMessages, const Clip &clip,
+        const AutomationEvent &e1, const AutomationEvent &e2,
+        int channel, int controllerNumber, bool isTempoTrack, double timeFactor);
+
     static float interpolateEvents(float cv1, float cv2, float factor, float easing);
+    // the curve's derivative by factor, i.e. how fast the value changes
+    static float getCurveSlope(float cv1, float cv2, float factor, float easing);
 
     static constexpr auto curveInterpolationStepBeat = 0.25f;
     static constexpr auto curveInterpolationThreshold = 0.0025f;
 
+    // the adaptive export aims at one controller step between the points,
+    // or, for the tempo curves, which have no such steps, at the threshold above,
+    // but never places them closer or further apart than these limits
+    static constexpr auto curveExportValueStep = 1.f / 127.f;
+    static constexpr auto curveExportMinStepBeat = 1.f / 32.f;
+    static constexpr auto curveExportMaxStepBeat = 1.f;
+
     AutomationEvent withBeat(float newBeat) const noexcept;
     AutomationEvent withDeltaBeat(float deltaBeat) const noexcept;
     AutomationEvent withControllerValue(float cv) const noexcept;
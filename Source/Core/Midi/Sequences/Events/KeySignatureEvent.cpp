@@ -47,7 +47,7 @@ KeySignatureEvent::KeySignatureEvent(WeakReference<MidiSequence> owner,
     rootKeyName(parametersToCopy.rootKeyName),
     scale(parametersToCopy.scale) {}
 
-void KeySignatureEvent::exportMessages(MidiMessageSequence &outSequence,
+void KeySignatureEvent::exportMessages(Array<MidiMessage> &outMessages,
     const Clip &clip, const KeyboardMapping &keyMap, double timeFactor) const noexcept
 {
     // basically, we can have any non-standard scale here,
@@ -60,7 +60,7 @@ void KeySignatureEvent::exportMessages(MidiMessageSequence &outSequence,
     const int flatsOrSharps = this->getNumFlatsSharps();
     MidiMessage event(MidiMessage::keySignatureMetaEvent(flatsOrSharps, isMinor));
     event.setTimeStamp((this->beat + clip.getBeat()) * timeFactor);
-    outSequence.addEvent(event);
+    outMessages.add(event);
 }
 
 KeySignatureEvent KeySignatureEvent::withDeltaBeat(float beatOffset) const noexcept
@@ -39,7 +39,7 @@ public:
 
     String toString(const Temperament::Period &defaultKeyNames) const;
 
-    void exportMessages(MidiMessageSequence &outSequence, const Clip &clip,
+    void exportMessages(Array<MidiMessage> &outMessages, const Clip &clip,
         const KeyboardMapping &keyMap, double timeFactor) const noexcept override;
     
     KeySignatureEvent withDeltaBeat(float beatOffset) const noexcept;
@@ -97,6 +97,193 @@ MidiEvent::Id MidiEvent::createId() const noexcept
     return {};
 }
 
+//===----------------------------------------------------------------------===//
+// Allocation
+//===----------------------------------------------------------------------===//
+
+// The events are deleted by the sequences, the undo actions and the copies
+// independently of the sequence which created them, so instead of per-sequence
+// arenas, the pool is process-wide, and each slab keeps its own free list
+// and the number of blocks in use, so that it is released as soon as
+// all its events are deleted, e.g. after removing lots of notes
+
+class MidiEventPool final
+{
+public:
+
+    static MidiEventPool &getInstance()
+    {
+        // never deleted, so that the events outliving
+        // the static objects' destruction can still be freed
+        static auto *pool = new MidiEventPool();
+        return *pool;
+    }
+
+    void *allocate(size_t size)
+    {
+        const auto sizeClass = MidiEventPool::getSizeClass(size);
+
+        const SpinLock::ScopedLockType lock(this->lock);
+        this->stats.numAllocations++;
+        this->stats.numLiveEvents++;
+
+        if (sizeClass >= numSizeClasses)
+        {
+            this->stats.numSystemAllocations++;
+            return ::operator new(size);
+        }
+
+        auto &availableSlabs = this->availableSlabs[sizeClass];
+        if (availableSlabs.empty())
+        {
+            availableSlabs.push_back(this->allocateSlab(sizeClass));
+        }
+
+        auto *slab = availableSlabs.back();
+        auto *block = slab->freeList;
+        slab->freeList = block->next;
+        slab->numBlocksInUse++;
+
+        if (slab->freeList == nullptr)
+        {
+            availableSlabs.pop_back();
+        }
+
+        return block;
+    }
+
+    void deallocate(void *ptr, size_t size) noexcept
+    {
+        const auto sizeClass = MidiEventPool::getSizeClass(size);
+
+        const SpinLock::ScopedLockType lock(this->lock);
+        this->stats.numLiveEvents--;
+
+        if (sizeClass >= numSizeClasses)
+        {
+            ::operator delete(ptr);
+            return;
+        }
+
+        // the slab with the greatest start address not above the pointer
+        auto slabIt = this->slabsByAddress.upper_bound(static_cast<const char *>(ptr));
+        jassert(slabIt != this->slabsByAddress.begin());
+        auto *slab = (--slabIt)->second;
+        jassert(slab->sizeClass == sizeClass);
+
+        auto &availableSlabs = this->availableSlabs[sizeClass];
+        if (slab->freeList == nullptr)
+        {
+            availableSlabs.push_back(slab);
+        }
+
+        auto *block = static_cast<FreeBlock *>(ptr);
+        block->next = slab->freeList;
+        slab->freeList = block;
+        slab->numBlocksInUse--;
+
+        // keep one empty slab per size class, so that adding
+        // and removing a single event doesn't hit the system allocator
+        // each time, unless there are no events left at all
+        if (slab->numBlocksInUse == 0 &&
+            (availableSlabs.size() > 1 || this->stats.numLiveEvents == 0))
+        {
+            availableSlabs.erase(std::find(availableSlabs.begin(), availableSlabs.end(), slab));
+            this->slabsByAddress.erase(slab->data);
+            this->releaseSlab(slab);
+        }
+    }
+
+    MidiEvent::AllocationStats getStats() const noexcept
+    {
+        const SpinLock::ScopedLockType lock(this->lock);
+        return this->stats;
+    }
+
+private:
+
+    MidiEventPool() = default;
+
+    struct FreeBlock final
+    {
+        FreeBlock *next;
+    };
+
+    struct Slab final
+    {
+        char *data;
+        size_t sizeClass;
+        size_t numBlocksInUse;
+        FreeBlock *freeList;
+    };
+
+    static constexpr size_t granularity = 16;
+    static constexpr size_t numSizeClasses = 16;
+    static constexpr size_t slabSize = 64 * 1024;
+
+    static inline size_t getSizeClass(size_t size) noexcept
+    {
+        return (size + granularity - 1) / granularity;
+    }
+
+    Slab *allocateSlab(size_t sizeClass)
+    {
+        const auto blockSize = sizeClass * granularity;
+
+        auto *slab = new Slab();
+        slab->data = static_cast<char *>(::operator new(slabSize));
+        slab->sizeClass = sizeClass;
+        slab->numBlocksInUse = 0;
+        slab->freeList = nullptr;
+
+        for (size_t offset = 0; offset + blockSize <= slabSize; offset += blockSize)
+        {
+            auto *block = reinterpret_cast<FreeBlock *>(slab->data + offset);
+            block->next = slab->freeList;
+            slab->freeList = block;
+        }
+
+        this->slabsByAddress[slab->data] = slab;
+        this->stats.numSystemAllocations++;
+        this->stats.numSlabs++;
+        return slab;
+    }
+
+    void releaseSlab(Slab *slab) noexcept
+    {
+        ::operator delete(slab->data);
+        delete slab;
+        this->stats.numSlabs--;
+    }
+
+    // the slabs with at least one free block, by size class
+    std::vector<Slab *> availableSlabs[numSizeClasses];
+    std::map<const char *, Slab *> slabsByAddress;
+
+    MidiEvent::AllocationStats stats;
+    SpinLock lock;
+
+    JUCE_DECLARE_NON_COPYABLE(MidiEventPool)
+};
+
+void *MidiEvent::operator new(size_t size)
+{
+    return MidiEventPool::getInstance().allocate(size);
+}
+
+void MidiEvent::operator delete(void *ptr, size_t size) noexcept
+{
+    if (ptr != nullptr)
+    {
+        MidiEventPool::getInstance().deallocate(ptr, size);
+    }
+}
+
+MidiEvent::AllocationStats MidiEvent::getAllocationStats() noexcept
+{
+    return MidiEventPool::getInstance().getStats();
+}
+
 String MidiEvent::packId(Id id)
 {
     const char c1 = static_cast<char>(id >> (0 * CHAR_BIT));
@@ -53,7 +53,7 @@ public:
     // with custom parameters (assumes the id is already valid and unique)
     MidiEvent(WeakReference<MidiSequence> owner, const MidiEvent &parameters) noexcept;
 
-    virtual void exportMessages(MidiMessageSequence &outSequence, const Clip &clip,
+    virtual void exportMessages(Array<MidiMessage> &outMessages, const Clip &clip,
         const KeyboardMapping &keyMap, double timeFactor) const noexcept = 0;
 
     //===------------------------------------------------------------------===//
@@ -89,6 +89,32 @@ public:
         return MidiEvent::compareElements(&first, &second);
     }
 
+    //===------------------------------------------------------------------===//
+    // Allocation
+    //===------------------------------------------------------------------===//
+
+    // The events are small and numerous, so instead of asking the system
+    // allocator for each one, they are taken from the pool of fixed-size blocks
+    // carved out of larger slabs; each slab is released as soon as
+    // all of its events are deleted, see MidiEventPool
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr, size_t size) noexcept;
+
+    // the placement forms are hidden by the above, but Array<Note> needs them
+    static void *operator new(size_t, void *ptr) noexcept { return ptr; }
+    static void operator delete(void *, void *) noexcept {}
+
+    struct AllocationStats final
+    {
+        int64 numAllocations = 0;
+        // slabs, and the events too large for the pool
+        int64 numSystemAllocations = 0;
+        int64 numLiveEvents = 0;
+        int64 numSlabs = 0;
+    };
+
+    static AllocationStats getAllocationStats() noexcept;
+
 protected:
 
     WeakReference<MidiSequence> sequence;
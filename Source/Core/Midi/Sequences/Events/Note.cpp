@@ -38,17 +38,25 @@ Note::Note(WeakReference<MidiSequence> owner, const Note &parametersToCopy) noex
     velocity(parametersToCopy.velocity),
     tuplet(parametersToCopy.tuplet) {}
 
-void Note::exportMessages(MidiMessageSequence &outSequence, const Clip &clip,
+void Note::exportMessages(Array<MidiMessage> &outMessages, const Clip &clip,
     const KeyboardMapping &keyMap, double timeFactor) const noexcept
 {
-    const auto keyWithOffset = this->key + clip.getKey();
-    const auto finalVolume = this->velocity * clip.getVelocity();
-    const auto tupletLength = this->length / float(this->tuplet);
-    const auto mapped = keyMap.map(keyWithOffset, this->sequence->getChannel());
+    Note::exportMessages(outMessages, clip, keyMap, this->sequence->getChannel(),
+        this->key, this->beat, this->length, this->velocity, this->tuplet, timeFactor);
+}
+
+void Note::exportMessages(Array<MidiMessage> &outMessages, const Clip &clip,
+    const KeyboardMapping &keyMap, int channel, Key key, float beat,
+    float length, float velocity, Tuplet tuplet, double timeFactor) noexcept
+{
+    const auto keyWithOffset = key + clip.getKey();
+    const auto finalVolume = velocity * clip.getVelocity();
+    const auto tupletLength = length / float(tuplet);
+    const auto mapped = keyMap.map(keyWithOffset, channel);
 
-    for (int i = 0; i < this->tuplet; ++i)
+    for (int i = 0; i < tuplet; ++i)
     {
-        const float tupletStart = this->beat + tupletLength * float(i);
+        const float tupletStart = beat + tupletLength * float(i);
 
         // slightly adjust volume for tuplet sequence: factor fading from 1 to 0.9;
         // this should sound anyway better than the same volume for all tuplets,
@@ -59,7 +67,7 @@ void Note::exportMessages(MidiMessageSequence &outSequence, const Clip &clip,
         MidiMessage eventNoteOn(MidiMessage::noteOn(mapped.channel, mapped.key, tupletVolume));
         const double startTime = (tupletStart + clip.getBeat()) * timeFactor;
         eventNoteOn.setTimeStamp(startTime);
-        outSequence.addEvent(eventNoteOn);
+        outMessages.add(eventNoteOn);
 
         // we want to subtract some little time offset from the the note-off
         // timestamps to make sure end/start times of neighbor notes never overlap:
@@ -73,10 +81,11 @@ void Note::exportMessages(MidiMessageSequence &outSequence, const Clip &clip,
         // be aligned accurately, so someday we might come up with a better fix:
         constexpr auto noteOffOffset = double(Globals::minNoteLength) / 16.0;
 
+        // right after its note-on, see MidiSequence::flushExportedMessages
         MidiMessage eventNoteOff(MidiMessage::noteOff(mapped.channel, mapped.key));
         const double endTime = (tupletStart + tupletLength + clip.getBeat()) * timeFactor - noteOffOffset;
         eventNoteOff.setTimeStamp(endTime);
-        outSequence.addEvent(eventNoteOff);
+        outMessages.add(eventNoteOff);
     }
 }
 
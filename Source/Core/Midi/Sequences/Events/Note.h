@@ -39,8 +39,13 @@ public:
         Key keyVal = 0, float beatVal = 0.f,
         float lengthVal = 1.f, float velocityVal = 1.f) noexcept;
 
-    void exportMessages(MidiMessageSequence &outSequence, const Clip &clip,
+    void exportMessages(Array<MidiMessage> &outMessages, const Clip &clip,
         const KeyboardMapping &keyMap, double timeFactor) const noexcept override;
+
+    // the same, but for the notes stored elsewhere, see PianoSequence::Columns
+    static void exportMessages(Array<MidiMessage> &outMessages, const Clip &clip,
+        const KeyboardMapping &keyMap, int channel, Key key, float beat,
+        float length, float velocity, Tuplet tuplet, double timeFactor) noexcept;
     
     // use these methods to perform undo/redo actions
     Note withKey(Key newKey) const noexcept;
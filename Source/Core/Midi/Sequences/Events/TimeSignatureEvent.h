@@ -49,7 +49,7 @@ public:
         int newNumerator = Globals::Defaults::timeSignatureNumerator,
         int newDenominator = Globals::Defaults::timeSignatureDenominator) noexcept;
     
-    void exportMessages(MidiMessageSequence &outSequence, const Clip &clip,
+    void exportMessages(Array<MidiMessage> &outMessages, const Clip &clip,
         const KeyboardMapping &keyMap, double timeFactor) const noexcept override;
 
     TimeSignatureEvent withDeltaBeat(float beatOffset) const noexcept;
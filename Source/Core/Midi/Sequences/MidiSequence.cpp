@@ -23,21 +23,78 @@
 #include "MidiTrack.h"
 #include "GeneratedSequenceBuilder.h"
 
+// Enumerates all ids of 2, 3 and 4 characters, in this order,
+// so that the shorter ones are used first, as they were before,
+// when the ids were random; see MidiEvent::packId for the format
 struct EventIdGenerator final
 {
-    static MidiEvent::Id generateId(int length = 2)
+    static constexpr int numIdChars = 62;
+    static constexpr int numIds2 = numIdChars * numIdChars;
+    static constexpr int numIds3 = numIds2 * numIdChars;
+    static constexpr int numIds4 = numIds3 * numIdChars;
+    static constexpr int numIds = numIds2 + numIds3 + numIds4;
+
+    static MidiEvent::Id getIdByIndex(int index)
     {
-        jassert(length <= 4);
-        MidiEvent::Id id = 0;
-        static Random r;
-        r.setSeedRandomly();
+        jassert(index >= 0 && index < numIds);
+
+        int length = 2;
+        if (index >= numIds2)
+        {
+            index -= numIds2;
+            length = 3;
+
+            if (index >= numIds3)
+            {
+                index -= numIds3;
+                length = 4;
+            }
+        }
+
         static const char idChars[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+
+        MidiEvent::Id id = 0;
         for (int i = 0; i < length; ++i)
         {
-            id |= idChars[r.nextInt(62)] << (i * CHAR_BIT);
+            id |= idChars[index % numIdChars] << (i * CHAR_BIT);
+            index /= numIdChars;
         }
+
         return id;
     }
+
+    // takes the first free id at the cursor or after it, and moves the cursor
+    // past it, wrapping around; returns 0 if all ids are taken
+    static MidiEvent::Id takeNextId(int &cursor, FlatHashSet<MidiEvent::Id> &usedIds)
+    {
+        for (int i = 0; i < numIds; ++i)
+        {
+            const auto eventId = getIdByIndex(cursor);
+            cursor = (cursor + 1) % numIds;
+
+            if (usedIds.insert(eventId).second)
+            {
+                return eventId;
+            }
+        }
+
+        return 0;
+    }
+
+    static int getRandomStartIndex()
+    {
+        // the tracks may be imported in parallel, so this can't use
+        // setSeedRandomly(), which takes the seed from the shared system Random;
+        // the thread id and the call counter keep apart the sequences
+        // which happen to be created at the same tick
+        static thread_local uint64 numCalls = 0;
+        const auto threadId = uint64(pointer_sized_int(Thread::getCurrentThreadId()));
+        const auto seed = uint64(Time::getHighResolutionTicks()) ^
+            ((threadId + ++numCalls) * 0x9e3779b97f4a7c15ull);
+
+        Random r(int64(seed));
+        return r.nextInt(numIds2);
+    }
 };
 
 MidiSequence::MidiSequence(MidiTrack &parentTrack,
@@ -83,15 +140,15 @@ void MidiSequence::clearUndoHistory()
 // Import/export
 //===----------------------------------------------------------------------===//
 
-void MidiSequence::exportMidi(MidiMessageSequence &outSequence,
+void MidiSequence::exportMidi(Array<MidiMessage> &outMessages,
     const Clip &clip, const KeyboardMapping &keyMap,
     GeneratedSequenceBuilder &generatedSequences,
-    bool projectHasSoloClips, bool exportMetronome,
+    bool projectHasSoloClips,
     float projectFirstBeat, float projectLastBeat,
     double timeFactor /*= 1.0*/) const
 {
-    if (this->midiEvents.isEmpty() || clip.isMuted() ||
-        (projectHasSoloClips && !clip.isSoloed() && clip.canBeSoloed()))
+    if (this->midiEvents.isEmpty() ||
+        !MidiSequence::isClipAudible(clip, projectHasSoloClips))
     {
         return;
     }
@@ -103,7 +160,7 @@ void MidiSequence::exportMidi(MidiMessageSequence &outSequence,
         jassert(sequence != nullptr);
         for (const auto *event : sequence->midiEvents)
         {
-            event->exportMessages(outSequence, clip, keyMap, timeFactor);
+            event->exportMessages(outMessages, clip, keyMap, timeFactor);
         }
     }
     else
@@ -111,11 +168,71 @@ void MidiSequence::exportMidi(MidiMessageSequence &outSequence,
         // original events
         for (const auto *event : this->midiEvents)
         {
-            event->exportMessages(outSequence, clip, keyMap, timeFactor);
+            event->exportMessages(outMessages, clip, keyMap, timeFactor);
+        }
+    }
+}
+
+void MidiSequence::flushExportedMessages(Array<MidiMessage> &exportedMessages,
+    MidiMessageSequence &outSequence)
+{
+    const auto getOrder = [](const MidiMessage &message)
+    {
+        return message.isNoteOn() ? 2 : (message.isNoteOff() ? 1 : 0);
+    };
+
+    // each note is exported as a note-on immediately followed by its note-off,
+    // see Note::exportMessages, so the pairs are known from the export order;
+    // the indices are sorted instead of the messages to keep track of them
+    const auto numMessages = exportedMessages.size();
+    std::vector<int> order(size_t(numMessages), 0);
+    std::iota(order.begin(), order.end(), 0);
+
+    // stable, so that the export order breaks the remaining ties
+    std::stable_sort(order.begin(), order.end(),
+        [&exportedMessages, &getOrder](int i1, int i2)
+        {
+            const auto &a = exportedMessages.getReference(i1);
+            const auto &b = exportedMessages.getReference(i2);
+            const auto t1 = a.getTimeStamp();
+            const auto t2 = b.getTimeStamp();
+            return t1 < t2 || (t1 == t2 && getOrder(a) < getOrder(b));
+        });
+
+    // appending in the sorted order, addEvent never has to look back,
+    // unless the output sequence already has some later events
+    outSequence.ensureStorageAllocated(outSequence.getNumEvents() + numMessages);
+
+    std::vector<MidiMessageSequence::MidiEventHolder *> holders(size_t(numMessages), nullptr);
+    for (const auto i : order)
+    {
+        holders[size_t(i)] = outSequence.addEvent(exportedMessages.getReference(i));
+    }
+
+    for (int i = 0; i < numMessages; ++i)
+    {
+        auto *holder = holders[size_t(i)];
+        if (!holder->message.isNoteOn())
+        {
+            continue;
         }
+
+        auto *noteOff = i + 1 < numMessages ? holders[size_t(i + 1)] : nullptr;
+        jassert(noteOff != nullptr && noteOff->message.isNoteOff() &&
+            noteOff->message.getNoteNumber() == holder->message.getNoteNumber() &&
+            noteOff->message.getChannel() == holder->message.getChannel());
+
+        holder->noteOffObject =
+            (noteOff != nullptr && noteOff->message.isNoteOff()) ? noteOff : nullptr;
     }
 
-    outSequence.updateMatchedPairs();
+    exportedMessages.clearQuick();
+}
+
+bool MidiSequence::isClipAudible(const Clip &clip, bool projectHasSoloClips) noexcept
+{
+    return !clip.isMuted() &&
+        !(projectHasSoloClips && !clip.isSoloed() && clip.canBeSoloed());
 }
 
 float MidiSequence::midiTicksToBeats(double ticks, int timeFormat) noexcept
@@ -170,6 +287,44 @@ UndoStack *MidiSequence::getUndoStack() const noexcept
     return this->eventDispatcher.getProject()->getUndoStack();
 }
 
+void MidiSequence::detachGroup(Array<int> &indices, Array<MidiEvent *> &outDetachedEvents)
+{
+    if (indices.isEmpty())
+    {
+        return;
+    }
+
+    std::sort(indices.begin(), indices.end());
+    const auto numIndices = int(std::unique(indices.begin(), indices.end()) - indices.begin());
+    indices.removeLast(indices.size() - numIndices);
+
+    outDetachedEvents.ensureStorageAllocated(outDetachedEvents.size() + numIndices);
+
+    // one pass moving the remaining pointers over the detached ones
+    auto **events = this->midiEvents.begin();
+    const auto numEvents = this->midiEvents.size();
+    int writeIndex = indices.getFirst();
+    int nextDetached = 0;
+
+    for (int readIndex = writeIndex; readIndex < numEvents; ++readIndex)
+    {
+        if (nextDetached < numIndices && indices.getUnchecked(nextDetached) == readIndex)
+        {
+            outDetachedEvents.add(events[readIndex]);
+            ++nextDetached;
+        }
+        else
+        {
+            events[writeIndex++] = events[readIndex];
+        }
+    }
+
+    jassert(nextDetached == numIndices);
+
+    // the tail now holds the duplicates of the moved pointers
+    this->midiEvents.removeLast(numIndices, false);
+}
+
 //===----------------------------------------------------------------------===//
 // Events change listener
 //===----------------------------------------------------------------------===//
@@ -196,15 +351,17 @@ void MidiSequence::updateBeatRange(bool shouldNotifyIfChanged)
 
 MidiEvent::Id MidiSequence::createUniqueEventId() const noexcept
 {
-    int length = 2;
-    auto eventId = EventIdGenerator::generateId(length);
-    while (this->usedEventIds.contains(eventId))
+    // the ids are allocated one after another, starting from a random point,
+    // so that the diverged revisions of the project are still unlikely
+    // to produce the same ids for different events; the only ids skipped
+    // are the ones taken by the events loaded or copied from elsewhere
+    if (this->nextEventIdIndex < 0)
     {
-        length = jmin(4, length + 1);
-        eventId = EventIdGenerator::generateId(length);
+        this->nextEventIdIndex = EventIdGenerator::getRandomStartIndex();
     }
-    
-    this->usedEventIds.insert(eventId);
+
+    const auto eventId = EventIdGenerator::takeNextId(this->nextEventIdIndex, this->usedEventIds);
+    jassert(eventId != 0); // all ~15 million ids are taken, how?
     return eventId;
 }
 
@@ -237,9 +394,9 @@ public:
     {
         beginTest("Legacy note id serialization");
 
-        const auto id2 = EventIdGenerator::generateId(2);
-        const auto id3 = EventIdGenerator::generateId(3);
-        const auto id4 = EventIdGenerator::generateId(4);
+        const auto id2 = EventIdGenerator::getIdByIndex(EventIdGenerator::numIds2 - 1);
+        const auto id3 = EventIdGenerator::getIdByIndex(EventIdGenerator::numIds2);
+        const auto id4 = EventIdGenerator::getIdByIndex(EventIdGenerator::numIds - 1);
 
         const auto p2 = MidiEvent::packId(id2);
         expectEquals(p2.length(), 2);
@@ -268,4 +425,108 @@ public:
 
 static LegacyEventFormatSupportTests legacyFormatSupportTests;
 
+class EventIdGeneratorTests final : public UnitTest
+{
+public:
+    EventIdGeneratorTests() : UnitTest("Event id generator tests", UnitTestCategories::helio) {}
+
+    void runTest() override
+    {
+        constexpr auto numIds = 3000;
+
+        beginTest("Taking ids across the wrap-around never probes");
+
+        FlatHashSet<MidiEvent::Id> usedIds;
+        int cursor = EventIdGenerator::numIds - numIds / 2;
+
+        for (int i = 0; i < numIds; ++i)
+        {
+            const auto expectedId = EventIdGenerator::getIdByIndex(cursor);
+            const auto eventId = EventIdGenerator::takeNextId(cursor, usedIds);
+            if (eventId != expectedId)
+            {
+                expect(false, "Probed for an id at " + String(i));
+                break;
+            }
+        }
+
+        expectEquals(cursor, numIds / 2);
+        expectEquals(int(usedIds.size()), numIds);
+
+        beginTest("Skipping the ids already taken");
+
+        // as if the taken ids came from the loaded events
+        cursor = 0;
+        const auto eventId = EventIdGenerator::takeNextId(cursor, usedIds);
+        expectEquals(eventId, EventIdGenerator::getIdByIndex(numIds / 2));
+        expectEquals(cursor, numIds / 2 + 1);
+        expectEquals(int(usedIds.size()), numIds + 1);
+    }
+};
+
+static EventIdGeneratorTests eventIdGeneratorTests;
+
+class MidiExportTests final : public UnitTest
+{
+public:
+    MidiExportTests() : UnitTest("MIDI export tests", UnitTestCategories::helio) {}
+
+    void runTest() override
+    {
+        beginTest("Ordering the messages with equal timestamps");
+
+        // the notes are exported as note-on and note-off pairs
+        Array<MidiMessage> exported;
+        exported.add(MidiMessage::noteOn(1, 60, 0.5f).withTimeStamp(1.0));
+        exported.add(MidiMessage::noteOff(1, 60).withTimeStamp(2.0));
+        exported.add(MidiMessage::controllerEvent(1, 64, 127).withTimeStamp(1.0));
+        exported.add(MidiMessage::noteOn(1, 60, 0.5f).withTimeStamp(0.0));
+        exported.add(MidiMessage::noteOff(1, 60).withTimeStamp(1.0));
+
+        MidiMessageSequence sequence;
+        MidiSequence::flushExportedMessages(exported, sequence);
+
+        expect(exported.isEmpty());
+        expectEquals(sequence.getNumEvents(), 5);
+        expect(sequence.getEventPointer(0)->message.isNoteOn());
+        expect(sequence.getEventPointer(1)->message.isController());
+        expect(sequence.getEventPointer(2)->message.isNoteOff());
+        expect(sequence.getEventPointer(3)->message.isNoteOn());
+        expect(sequence.getEventPointer(4)->message.isNoteOff());
+
+        beginTest("Matching note-offs");
+
+        expect(sequence.getEventPointer(0)->noteOffObject == sequence.getEventPointer(2));
+        expect(sequence.getEventPointer(3)->noteOffObject == sequence.getEventPointer(4));
+
+        beginTest("Matching overlapping notes of the same key");
+
+        exported.add(MidiMessage::noteOn(2, 60, 0.5f).withTimeStamp(0.0));
+        exported.add(MidiMessage::noteOff(2, 60).withTimeStamp(2.0));
+        exported.add(MidiMessage::noteOn(2, 60, 0.5f).withTimeStamp(1.0));
+        exported.add(MidiMessage::noteOff(2, 60).withTimeStamp(3.0));
+
+        MidiMessageSequence overlapping;
+        MidiSequence::flushExportedMessages(exported, overlapping);
+
+        expect(overlapping.getEventPointer(0)->noteOffObject == overlapping.getEventPointer(2));
+        expect(overlapping.getEventPointer(1)->noteOffObject == overlapping.getEventPointer(3));
+
+        beginTest("Matching nested notes of the same key");
+
+        exported.add(MidiMessage::noteOn(3, 60, 0.5f).withTimeStamp(0.0));
+        exported.add(MidiMessage::noteOff(3, 60).withTimeStamp(10.0));
+        exported.add(MidiMessage::noteOn(3, 60, 0.5f).withTimeStamp(1.0));
+        exported.add(MidiMessage::noteOff(3, 60).withTimeStamp(2.0));
+
+        MidiMessageSequence nested;
+        MidiSequence::flushExportedMessages(exported, nested);
+
+        expect(nested.getEventPointer(0)->noteOffObject == nested.getEventPointer(3));
+        expect(nested.getEventPointer(1)->noteOffObject == nested.getEventPointer(2));
+    }
+};
+
+static MidiExportTests midiExportTests;
+
 #endif
@@ -53,13 +53,26 @@ public:
     static float midiTicksToBeats(double ticks, int timeFormat) noexcept;
     virtual void importMidi(const MidiMessageSequence &sequence,
         short timeFormat, Optional<int> customFilter) = 0;
-    virtual void exportMidi(MidiMessageSequence &outSequence,
+
+    // Appends the clip's messages, unsorted, to the flat buffer,
+    // which collects all clips of the track (or a group of tracks);
+    // when done, call flushExportedMessages to get the MIDI sequence
+    virtual void exportMidi(Array<MidiMessage> &outMessages,
         const Clip &clip, const KeyboardMapping &keyMap,
         GeneratedSequenceBuilder &generatedSequences,
-        bool soloPlaybackMode, bool exportMetronome,
+        bool soloPlaybackMode,
         float projectFirstBeat, float projectLastBeat,
         double timeFactor = 1.0) const;
 
+    // Sorts the messages once and links each note-on to its note-off,
+    // expecting every note-on to be exported immediately followed by its note-off,
+    // so that the nested notes of the same key are paired correctly;
+    // the messages with equal timestamps are ordered
+    // deterministically: meta and controller events, then note-offs,
+    // then note-ons, each in the order they were exported
+    static void flushExportedMessages(Array<MidiMessage> &exportedMessages,
+        MidiMessageSequence &outSequence);
+
     //===------------------------------------------------------------------===//
     // Track editing
     //===------------------------------------------------------------------===//
@@ -181,13 +194,50 @@ protected:
     virtual float findFirstBeat() const noexcept;
     virtual float findLastBeat() const noexcept;
 
+    // checks the clip's mute and solo flags
+    static bool isClipAudible(const Clip &clip, bool projectHasSoloClips) noexcept;
+
     ProjectEventDispatcher &eventDispatcher;
     ProjectNode *getProject() const noexcept;
     UndoStack *getUndoStack() const noexcept;
 
+    // Bulk counterparts of addSorted and remove for the group edits:
+    // adding or removing k events out of n takes O(n + k log k)
+    // instead of an O(n) memmove for each of them
+
+    template <typename T>
+    void addSortedGroup(Array<MidiEvent *> &ownedEvents)
+    {
+        static T comparator;
+        const auto isLess = [](const MidiEvent *a, const MidiEvent *b)
+        {
+            return comparator.compareElements(a, b) < 0;
+        };
+
+        std::sort(ownedEvents.begin(), ownedEvents.end(), isLess);
+
+        const auto numSortedEvents = this->midiEvents.size();
+        this->midiEvents.ensureStorageAllocated(numSortedEvents + ownedEvents.size());
+        for (auto *event : ownedEvents)
+        {
+            this->midiEvents.add(event);
+        }
+
+        std::inplace_merge(this->midiEvents.begin(),
+            this->midiEvents.begin() + numSortedEvents,
+            this->midiEvents.end(), isLess);
+    }
+
+    // takes the events at the given indices out of the array
+    // without deleting them; the indices are sorted and deduplicated
+    void detachGroup(Array<int> &indices, Array<MidiEvent *> &outDetachedEvents);
+
     OwnedArray<MidiEvent> midiEvents;
 
     mutable FlatHashSet<MidiEvent::Id> usedEventIds;
 
+    // see createUniqueEventId, -1 means not started yet
+    mutable int nextEventIdIndex = -1;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiSequence)
 };
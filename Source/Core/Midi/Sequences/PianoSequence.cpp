@@ -22,6 +22,9 @@
 #include "NoteActions.h"
 #include "SerializationKeys.h"
 #include "UndoStack.h"
+#include "GeneratedSequenceBuilder.h"
+#include "KeyboardMapping.h"
+#include "MidiTrack.h"
 
 PianoSequence::PianoSequence(MidiTrack &track,
     ProjectEventDispatcher &dispatcher) noexcept :
@@ -41,6 +44,8 @@ PianoSequence::PianoSequence(MidiTrack &track,
         jassert(dynamic_cast<const Note *>(event) != nullptr);
         this->midiEvents.add(new Note(this, static_cast<const Note &>(*event)));
     }
+
+    this->rebuildNoteIndices();
 }
 //===----------------------------------------------------------------------===//
 // Import/export
@@ -49,42 +54,102 @@ PianoSequence::PianoSequence(MidiTrack &track,
 void PianoSequence::importMidi(const MidiMessageSequence &sequence,
     short timeFormat, Optional<int> filterByChannel)
 {
-    this->clearUndoHistory();
-    this->checkpoint();
+    // Pairs each note-on with the next note-on or note-off of the same
+    // channel and key, just like MidiMessageSequence::updateMatchedPairs does,
+    // but in a single pass, keeping track of the pending note-ons;
+    // doesn't touch the undo stack, so that the tracks can be imported
+    // in parallel, see ProjectNode::importMidi
+
+    struct PendingNote final
+    {
+        double timeStamp = -1.0;
+        float velocity = 0.f;
+    };
+
+    constexpr auto numKeys = 128;
+    std::vector<PendingNote> pendingNotes(Globals::numChannels * numKeys);
+
+    Array<MidiEvent *> importedNotes;
+    importedNotes.ensureStorageAllocated(sequence.getNumEvents() / 2);
 
     for (int i = 0; i < sequence.getNumEvents(); ++i)
     {
         const auto &message = sequence.getEventPointer(i)->message;
 
-        if (filterByChannel.hasValue() &&
-            message.getChannel() != *filterByChannel)
+        if (!message.isNoteOnOrOff() ||
+            (filterByChannel.hasValue() && message.getChannel() != *filterByChannel))
         {
             continue;
         }
 
-        if (message.isNoteOn())
+        const int key = message.getNoteNumber();
+        const int channel = jlimit(1, Globals::numChannels, message.getChannel());
+        auto &pendingNote = pendingNotes[(channel - 1) * numKeys + key];
+
+        if (pendingNote.timeStamp >= 0.0)
         {
-            const int key = message.getNoteNumber();
-            const float velocity = message.getVelocity() / 128.f;
-            const float startBeat = MidiSequence::midiTicksToBeats(message.getTimeStamp(), timeFormat);
-            const int noteOffIndex = sequence.getIndexOfMatchingKeyUp(i);
-            if (noteOffIndex > 0)
+            const float startBeat = MidiSequence::midiTicksToBeats(pendingNote.timeStamp, timeFormat);
+            const float endBeat = MidiSequence::midiTicksToBeats(message.getTimeStamp(), timeFormat);
+            if (endBeat > startBeat)
             {
-                const MidiMessage &messageOff = sequence.getEventPointer(noteOffIndex)->message;
-                const float endBeat = MidiSequence::midiTicksToBeats(messageOff.getTimeStamp(), timeFormat);
-                if (endBeat > startBeat)
-                {
-                    const float length = endBeat - startBeat;
-                    const Note note(this, key, startBeat, length, velocity);
-                    this->importMidiEvent<Note>(note);
-                }
+                importedNotes.add(new Note(this, key, startBeat,
+                    endBeat - startBeat, pendingNote.velocity));
             }
+
+            pendingNote.timeStamp = -1.0;
+        }
+
+        if (message.isNoteOn())
+        {
+            pendingNote.timeStamp = message.getTimeStamp();
+            pendingNote.velocity = message.getVelocity() / 128.f;
         }
     }
 
+    for (const auto *note : importedNotes)
+    {
+        this->indexNote(note);
+    }
+
+    this->addSortedGroup<Note>(importedNotes);
     this->updateBeatRange(false);
 }
 
+void PianoSequence::exportMidi(Array<MidiMessage> &outMessages,
+    const Clip &clip, const KeyboardMapping &keyMap,
+    GeneratedSequenceBuilder &generatedSequences,
+    bool projectHasSoloClips,
+    float projectFirstBeat, float projectLastBeat,
+    double timeFactor /*= 1.0*/) const
+{
+    if (this->midiEvents.isEmpty() ||
+        !MidiSequence::isClipAudible(clip, projectHasSoloClips))
+    {
+        return;
+    }
+
+    const auto *source = this;
+    if (clip.hasModifiers())
+    {
+        // generated events
+        auto *sequence = generatedSequences.getSequenceFor(clip);
+        jassert(dynamic_cast<PianoSequence *>(sequence) != nullptr);
+        source = static_cast<PianoSequence *>(sequence);
+    }
+
+    const auto &notes = source->getColumns();
+    const auto channel = source->getChannel();
+
+    outMessages.ensureStorageAllocated(outMessages.size() + notes.size() * 2);
+
+    for (int i = 0; i < notes.size(); ++i)
+    {
+        Note::exportMessages(outMessages, clip, keyMap, channel,
+            notes.keys[i], notes.beats[i], notes.lengths[i],
+            notes.velocities[i], notes.tuplets[i], timeFactor);
+    }
+}
+
 //===----------------------------------------------------------------------===//
 // Undoable track editing
 //===----------------------------------------------------------------------===//
@@ -101,6 +166,7 @@ MidiEvent *PianoSequence::insert(const Note &eventParams, const bool undoable)
     {
         auto *ownedNote = new Note(this, eventParams);
         this->midiEvents.addSorted(*ownedNote, ownedNote);
+        this->indexNote(ownedNote);
         this->eventDispatcher.dispatchAddEvent(*ownedNote);
         this->updateBeatRange(true);
         return ownedNote;
@@ -126,6 +192,7 @@ bool PianoSequence::remove(const Note &eventParams, const bool undoable)
             auto *removedNote = this->midiEvents.getUnchecked(index);
             jassert(removedNote->isValid());
             this->eventDispatcher.dispatchRemoveEvent(*removedNote);
+            this->unindexNote(removedNote);
             this->midiEvents.remove(index, true);
             this->updateBeatRange(true);
             this->eventDispatcher.dispatchPostRemoveEvent(this);
@@ -155,7 +222,9 @@ bool PianoSequence::change(const Note &oldParams,
         {
             auto *changedNote = static_cast<Note *>(this->midiEvents.getUnchecked(index));
             const Note oldNote(*changedNote);
+            this->unindexNote(changedNote);
             changedNote->applyChanges(newParams);
+            this->indexNote(changedNote);
             this->midiEvents.remove(index, false);
             this->midiEvents.addSorted(*changedNote, changedNote);
             this->eventDispatcher.dispatchChangeEvent(oldNote, *changedNote);
@@ -179,14 +248,21 @@ bool PianoSequence::insertGroup(Array<Note> &group, bool undoable)
     }
     else
     {
+        Array<MidiEvent *> ownedNotes;
+        Array<const MidiEvent *> addedNotes;
+        ownedNotes.ensureStorageAllocated(group.size());
+        addedNotes.ensureStorageAllocated(group.size());
+
         for (int i = 0; i < group.size(); ++i)
         {
-            const Note &eventParams = group.getUnchecked(i);
-            auto *ownedNote = new Note(this, eventParams);
-            this->midiEvents.addSorted(*ownedNote, ownedNote);
-            this->eventDispatcher.dispatchAddEvent(*ownedNote);
+            auto *ownedNote = new Note(this, group.getUnchecked(i));
+            this->indexNote(ownedNote);
+            ownedNotes.add(ownedNote);
+            addedNotes.add(ownedNote);
         }
 
+        this->addSortedGroup<Note>(ownedNotes);
+        this->eventDispatcher.dispatchAddEvents(addedNotes);
         this->updateBeatRange(true);
     }
 
@@ -203,6 +279,9 @@ bool PianoSequence::removeGroup(Array<Note> &group, bool undoable)
     }
     else
     {
+        Array<int> indices;
+        indices.ensureStorageAllocated(group.size());
+
         for (int i = 0; i < group.size(); ++i)
         {
             const Note &note = group.getUnchecked(i);
@@ -214,12 +293,23 @@ bool PianoSequence::removeGroup(Array<Note> &group, bool undoable)
             jassert(index >= 0);
             if (index >= 0)
             {
-                auto *removedNote = this->midiEvents.getUnchecked(index);
-                this->eventDispatcher.dispatchRemoveEvent(*removedNote);
-                this->midiEvents.remove(index, true);
+                indices.add(index);
             }
         }
 
+        Array<MidiEvent *> removedNotes;
+        this->detachGroup(indices, removedNotes);
+
+        Array<const MidiEvent *> notification;
+        notification.addArray(removedNotes);
+        this->eventDispatcher.dispatchRemoveEvents(notification);
+
+        for (auto *removedNote : removedNotes)
+        {
+            this->unindexNote(removedNote);
+            delete removedNote;
+        }
+
         this->updateBeatRange(true);
         this->eventDispatcher.dispatchPostRemoveEvent(this);
     }
@@ -249,10 +339,16 @@ bool PianoSequence::changeGroup(Array<Note> &groupBefore,
     }
     else
     {
+        // all lookups are done before any changes are applied,
+        // while the array is still sorted by the old parameters
+        Array<int> indices;
+        Array<int> changeIndices;
+        indices.ensureStorageAllocated(groupBefore.size());
+        changeIndices.ensureStorageAllocated(groupBefore.size());
+
         for (int i = 0; i < groupBefore.size(); ++i)
         {
             const Note &oldParams = groupBefore.getReference(i);
-            const Note &newParams = groupAfter.getReference(i);
             const int index = this->midiEvents.indexOfSorted(oldParams, &oldParams);
             // if you're hitting this assertion, one of the reasons might be
             // allowing user to somehow select notes of different clips simultaneously,
@@ -262,15 +358,47 @@ bool PianoSequence::changeGroup(Array<Note> &groupBefore,
             jassert(index >= 0);
             if (index >= 0)
             {
-                auto *changedNote = static_cast<Note *>(this->midiEvents.getUnchecked(index));
-                const Note oldNote(*changedNote);
-                changedNote->applyChanges(newParams);
-                this->midiEvents.remove(index, false);
-                this->midiEvents.addSorted(*changedNote, changedNote);
-                this->eventDispatcher.dispatchChangeEvent(oldNote, *changedNote);
+                indices.add(index);
+                changeIndices.add(i);
             }
         }
 
+        Array<Note> oldNotes;
+        Array<const MidiEvent *> oldNotesNotification;
+        Array<const MidiEvent *> newNotesNotification;
+        oldNotes.ensureStorageAllocated(indices.size());
+        oldNotesNotification.ensureStorageAllocated(indices.size());
+        newNotesNotification.ensureStorageAllocated(indices.size());
+
+        FlatHashSet<MidiEvent::Id> changedIds;
+        for (int i = 0; i < indices.size(); ++i)
+        {
+            auto *changedNote = static_cast<Note *>(this->midiEvents.getUnchecked(indices.getUnchecked(i)));
+            if (changedIds.contains(changedNote->getId()))
+            {
+                jassertfalse; // the same note is changed twice, see the comment above
+                continue;
+            }
+
+            changedIds.insert(changedNote->getId());
+            oldNotes.add(*changedNote);
+            this->unindexNote(changedNote);
+            changedNote->applyChanges(groupAfter.getReference(changeIndices.getUnchecked(i)));
+            this->indexNote(changedNote);
+            newNotesNotification.add(changedNote);
+        }
+
+        // no reallocations past this point, so the pointers are stable
+        for (const auto &oldNote : oldNotes)
+        {
+            oldNotesNotification.add(&oldNote);
+        }
+
+        Array<MidiEvent *> changedNotes;
+        this->detachGroup(indices, changedNotes);
+        this->addSortedGroup<Note>(changedNotes);
+
+        this->eventDispatcher.dispatchChangeEvents(oldNotesNotification, newNotesNotification);
         this->updateBeatRange(true);
     }
 
@@ -288,21 +416,199 @@ float PianoSequence::findLastBeat() const noexcept
         return 0.f;
     }
 
-    // FIXME:
-    // sometimes the last event is not the one that lasts longer
-    // (as events *must* be sorted by start beat, not by end beat),
-    // so here we have to iterate through a number of last events
-    // to guess where the sequence really ends, with still no guarantee
-    // we'll end up with right event (not sure how to fix it at the moment):
-    float lastBeat = -FLT_MAX;
-    const int checkStart = jmax(0, this->midiEvents.size() - 20);
-    for (int i = checkStart; i < this->midiEvents.size(); ++i)
+    // the last event is not necessarily the one that lasts longer,
+    // as the events are sorted by start beat, hence the index
+    jassert(this->noteEndBeats.size() == size_t(this->midiEvents.size()));
+    return *this->noteEndBeats.rbegin();
+}
+
+//===----------------------------------------------------------------------===//
+// Spatial index
+//===----------------------------------------------------------------------===//
+
+static inline int getNoteGridColumn(float beat, float cellBeats) noexcept
+{
+    return int(std::floor(beat / cellBeats));
+}
+
+static inline int getNoteGridRow(Note::Key key, int cellKeys) noexcept
+{
+    return key >= 0 ? key / cellKeys : -(-(key + 1) / cellKeys) - 1;
+}
+
+static inline int64 getNoteGridCell(int column, int row) noexcept
+{
+    return int64((uint64(uint32(column)) << 32) | uint64(uint32(row)));
+}
+
+static inline Range<int> getUnionOrSelf(Range<int> range, Range<int> other) noexcept
+{
+    return range.isEmpty() ? other : range.getUnionWith(other);
+}
+
+void PianoSequence::findNotesInArea(float startBeat, float endBeat,
+    Note::Key minKey, Note::Key maxKey, Array<const Note *> &outNotes) const
+{
+    if (this->noteGrid.empty() || endBeat < startBeat || maxKey < minKey)
+    {
+        return;
+    }
+
+    // clamped before converting, so that any huge ranges are fine
+    const auto minGridBeat = float(this->noteGridColumns.getStart()) * PianoSequence::noteGridCellBeats;
+    const auto maxGridBeat = float(this->noteGridColumns.getEnd()) * PianoSequence::noteGridCellBeats;
+
+    const auto firstColumn = getNoteGridColumn(jlimit(minGridBeat, maxGridBeat, startBeat),
+        PianoSequence::noteGridCellBeats);
+    const auto lastColumn = jmin(getNoteGridColumn(jlimit(minGridBeat, maxGridBeat, endBeat),
+        PianoSequence::noteGridCellBeats), this->noteGridColumns.getEnd() - 1);
+
+    const auto firstRow = jmax(getNoteGridRow(minKey, PianoSequence::noteGridCellKeys),
+        this->noteGridRows.getStart());
+    const auto lastRow = jmin(getNoteGridRow(maxKey, PianoSequence::noteGridCellKeys),
+        this->noteGridRows.getEnd() - 1);
+
+    for (int column = firstColumn; column <= lastColumn; ++column)
     {
-        const auto *n = static_cast<const Note *>(this->midiEvents.getUnchecked(i));
-        lastBeat = jmax(lastBeat, n->getBeat() + n->getLength());
+        for (int row = firstRow; row <= lastRow; ++row)
+        {
+            const auto cell = this->noteGrid.find(getNoteGridCell(column, row));
+            if (cell == this->noteGrid.end())
+            {
+                continue;
+            }
+
+            for (const auto *note : cell->second)
+            {
+                const auto beat = note->getBeat();
+                if (beat > endBeat || beat + note->getLength() < startBeat ||
+                    note->getKey() < minKey || note->getKey() > maxKey)
+                {
+                    continue;
+                }
+
+                // the long notes are found in several cells of the row,
+                // so each one is only reported from the first one searched
+                const auto noteColumn = getNoteGridColumn(beat, PianoSequence::noteGridCellBeats);
+                if (column == jmax(firstColumn, noteColumn))
+                {
+                    outNotes.add(note);
+                }
+            }
+        }
     }
+}
+
+void PianoSequence::indexNote(const MidiEvent *event)
+{
+    jassert(dynamic_cast<const Note *>(event) != nullptr);
+    const auto *note = static_cast<const Note *>(event);
+    const auto endBeat = note->getBeat() + note->getLength();
 
-    return lastBeat;
+    this->noteEndBeats.insert(endBeat);
+
+    const auto firstColumn = getNoteGridColumn(note->getBeat(), PianoSequence::noteGridCellBeats);
+    const auto lastColumn = getNoteGridColumn(endBeat, PianoSequence::noteGridCellBeats);
+    const auto row = getNoteGridRow(note->getKey(), PianoSequence::noteGridCellKeys);
+
+    for (int column = firstColumn; column <= lastColumn; ++column)
+    {
+        this->noteGrid[getNoteGridCell(column, row)].add(note);
+    }
+
+    this->noteGridColumns = getUnionOrSelf(this->noteGridColumns, { firstColumn, lastColumn + 1 });
+    this->noteGridRows = getUnionOrSelf(this->noteGridRows, { row, row + 1 });
+}
+
+void PianoSequence::unindexNote(const MidiEvent *event)
+{
+    jassert(dynamic_cast<const Note *>(event) != nullptr);
+    const auto *note = static_cast<const Note *>(event);
+    const auto endBeat = note->getBeat() + note->getLength();
+
+    const auto found = this->noteEndBeats.find(endBeat);
+    jassert(found != this->noteEndBeats.end());
+    if (found != this->noteEndBeats.end())
+    {
+        this->noteEndBeats.erase(found);
+    }
+
+    const auto firstColumn = getNoteGridColumn(note->getBeat(), PianoSequence::noteGridCellBeats);
+    const auto lastColumn = getNoteGridColumn(endBeat, PianoSequence::noteGridCellBeats);
+    const auto row = getNoteGridRow(note->getKey(), PianoSequence::noteGridCellKeys);
+
+    for (int column = firstColumn; column <= lastColumn; ++column)
+    {
+        const auto cell = this->noteGrid.find(getNoteGridCell(column, row));
+        jassert(cell != this->noteGrid.end());
+        if (cell != this->noteGrid.end())
+        {
+            cell.value().removeFirstMatchingValue(note);
+            if (cell->second.isEmpty())
+            {
+                this->noteGrid.erase(cell);
+            }
+        }
+    }
+}
+
+void PianoSequence::rebuildNoteIndices()
+{
+    this->noteEndBeats.clear();
+    this->noteGrid.clear();
+    this->noteGridColumns = {};
+    this->noteGridRows = {};
+
+    for (const auto *note : this->midiEvents)
+    {
+        this->indexNote(note);
+    }
+}
+
+//===----------------------------------------------------------------------===//
+// Dense storage
+//===----------------------------------------------------------------------===//
+
+const PianoSequence::Columns &PianoSequence::getColumns() const
+{
+    if (this->columnsOutdated)
+    {
+        const auto numNotes = size_t(this->midiEvents.size());
+        this->columns.beats.resize(numNotes);
+        this->columns.lengths.resize(numNotes);
+        this->columns.velocities.resize(numNotes);
+        this->columns.keys.resize(numNotes);
+        this->columns.tuplets.resize(numNotes);
+        this->columns.ids.resize(numNotes);
+
+        for (size_t i = 0; i < numNotes; ++i)
+        {
+            const auto *note = static_cast<const Note *>(this->midiEvents.getUnchecked(int(i)));
+            this->columns.beats[i] = note->getBeat();
+            this->columns.lengths[i] = note->getLength();
+            this->columns.velocities[i] = note->getVelocity();
+            this->columns.keys[i] = note->getKey();
+            this->columns.tuplets[i] = note->getTuplet();
+            this->columns.ids[i] = note->getId();
+        }
+
+        this->columnsOutdated = false;
+    }
+
+    return this->columns;
+}
+
+void PianoSequence::updateBeatRange(bool shouldNotifyIfChanged)
+{
+    // the notes were added or removed bypassing the editing methods
+    if (this->noteEndBeats.size() != size_t(this->midiEvents.size()))
+    {
+        this->rebuildNoteIndices();
+    }
+
+    this->columnsOutdated = true;
+
+    MidiSequence::updateBeatRange(shouldNotifyIfChanged);
 }
 
 //===----------------------------------------------------------------------===//
@@ -386,4 +692,699 @@ void PianoSequence::reset()
 {
     this->midiEvents.clear();
     this->usedEventIds.clear();
+    this->noteEndBeats.clear();
+    this->noteGrid.clear();
+    this->noteGridColumns = {};
+    this->noteGridRows = {};
+
+    this->columns = {};
+    this->columnsOutdated = true;
 }
+
+//===----------------------------------------------------------------------===//
+// Tests
+//===----------------------------------------------------------------------===//
+
+#if JUCE_UNIT_TESTS
+
+// A track and a dispatcher just enough to hold a sequence and to swallow its events,
+// only the non-undoable editing methods can be used without the project;
+// shared by all the tests below, along with the notes generator
+
+class PianoSequenceTestTrack final : public VirtualMidiTrack
+{
+public:
+
+    PianoSequenceTestTrack() :
+        dispatcher(make<Dispatcher>()),
+        sequence(make<PianoSequence>(*this, *this->dispatcher)) {}
+
+    MidiSequence *getSequence() const noexcept override
+    {
+        return this->sequence.get();
+    }
+
+    PianoSequence &getPianoSequence() noexcept
+    {
+        return *this->sequence;
+    }
+
+    // the notes with random keys and random beats on the quarter-beat grid,
+    // the same ones for each new track, so that the failures are reproducible
+    Array<Note> makeRandomNotes(int numNotes, int numBeats, float length = 0.25f)
+    {
+        Array<Note> notes;
+        notes.ensureStorageAllocated(numNotes);
+        for (int i = 0; i < numNotes; ++i)
+        {
+            notes.add(Note(this->sequence.get(), this->random.nextInt(128),
+                float(this->random.nextInt(numBeats * 4)) * 0.25f, length, 0.5f));
+        }
+
+        return notes;
+    }
+
+    // what the sequence has notified about, to check the editing methods
+    struct Notifications final
+    {
+        int numGroups = 0;
+        int numAdded = 0;
+        int numChanged = 0;
+        int numRemoved = 0;
+        int numPostRemoved = 0;
+        FlatHashSet<MidiEvent::Id> ids;
+    };
+
+    const Notifications &getNotifications() const noexcept
+    {
+        return this->dispatcher->notifications;
+    }
+
+    void resetNotifications()
+    {
+        this->dispatcher->notifications = {};
+    }
+
+    static bool isSorted(const PianoSequence &sequence)
+    {
+        for (int i = 1; i < sequence.size(); ++i)
+        {
+            if (Note::compareElements(sequence.getUnchecked(i - 1), sequence.getUnchecked(i)) >= 0)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+private:
+
+    struct Dispatcher final : public ProjectEventDispatcher
+    {
+        void dispatchAddEvent(const MidiEvent &event) override
+        {
+            this->notifications.numAdded++;
+            this->notifications.ids.insert(event.getId());
+        }
+
+        void dispatchChangeEvent(const MidiEvent &oldEvent, const MidiEvent &newEvent) override
+        {
+            jassert(oldEvent.getId() == newEvent.getId());
+            this->notifications.numChanged++;
+            this->notifications.ids.insert(newEvent.getId());
+        }
+
+        void dispatchRemoveEvent(const MidiEvent &event) override
+        {
+            this->notifications.numRemoved++;
+            this->notifications.ids.insert(event.getId());
+        }
+
+        void dispatchPostRemoveEvent(MidiSequence *const) override
+        {
+            this->notifications.numPostRemoved++;
+        }
+
+        void dispatchAddEvents(const Array<const MidiEvent *> &events) override
+        {
+            this->notifications.numGroups++;
+            ProjectEventDispatcher::dispatchAddEvents(events);
+        }
+
+        void dispatchChangeEvents(const Array<const MidiEvent *> &oldEvents,
+            const Array<const MidiEvent *> &newEvents) override
+        {
+            this->notifications.numGroups++;
+            ProjectEventDispatcher::dispatchChangeEvents(oldEvents, newEvents);
+        }
+
+        void dispatchRemoveEvents(const Array<const MidiEvent *> &events) override
+        {
+            this->notifications.numGroups++;
+            ProjectEventDispatcher::dispatchRemoveEvents(events);
+        }
+
+        void dispatchAddClip(const Clip &) override {}
+        void dispatchChangeClip(const Clip &, const Clip &) override {}
+        void dispatchRemoveClip(const Clip &) override {}
+        void dispatchPostRemoveClip(Pattern *const) override {}
+        void dispatchChangeTrackProperties() override {}
+        void dispatchChangeTrackBeatRange() override {}
+        void dispatchChangeProjectBeatRange() override {}
+
+        Notifications notifications;
+    };
+
+    UniquePointer<Dispatcher> dispatcher;
+    UniquePointer<PianoSequence> sequence;
+
+    Random random { 1 };
+};
+
+// Checks that the dense columns match the owned notes,
+// and that the export from either of them is the same
+
+class PianoSequenceColumnsTests final : public UnitTest
+{
+public:
+
+    PianoSequenceColumnsTests() :
+        UnitTest("Piano sequence columns tests", UnitTestCategories::helio) {}
+
+    void runTest() override
+    {
+        PianoSequenceTestTrack track;
+        auto &sequence = track.getPianoSequence();
+        sequence.insertGroup(track.makeRandomNotes(500, 100), false);
+
+        beginTest("Columns match the owned notes");
+
+        const auto columns = sequence.getColumns();
+        expectEquals(columns.size(), sequence.size());
+
+        for (int i = 0; i < columns.size(); ++i)
+        {
+            const auto &note = sequence.getNoteUnchecked(i);
+            if (columns.ids[i] != note.getId() ||
+                columns.beats[i] != note.getBeat() ||
+                columns.lengths[i] != note.getLength() ||
+                columns.keys[i] != note.getKey() ||
+                columns.velocities[i] != note.getVelocity() ||
+                columns.tuplets[i] != note.getTuplet())
+            {
+                expect(false, "The columns differ from the notes at " + String(i));
+                break;
+            }
+        }
+
+        beginTest("Exporting the columns");
+
+        static Clip noTransform;
+        KeyboardMapping keyMap;
+
+        Array<MidiMessage> ownedExport;
+        for (const auto *event : sequence)
+        {
+            event->exportMessages(ownedExport, noTransform, keyMap, 1.0);
+        }
+
+        Array<MidiMessage> columnsExport;
+        for (int i = 0; i < columns.size(); ++i)
+        {
+            Note::exportMessages(columnsExport, noTransform, keyMap, sequence.getChannel(),
+                columns.keys[i], columns.beats[i], columns.lengths[i],
+                columns.velocities[i], columns.tuplets[i], 1.0);
+        }
+
+        expectEquals(columnsExport.size(), ownedExport.size());
+        for (int i = 0; i < ownedExport.size(); ++i)
+        {
+            const auto &a = ownedExport.getReference(i);
+            const auto &b = columnsExport.getReference(i);
+            if (a.getTimeStamp() != b.getTimeStamp() || a.getNoteNumber() != b.getNoteNumber())
+            {
+                expect(false, "Exported messages differ at " + String(i));
+                break;
+            }
+        }
+
+        beginTest("Invalidating the columns");
+
+        sequence.remove(sequence.getNoteUnchecked(0), false);
+        expectEquals(sequence.getColumns().size(), sequence.size());
+        expectEquals(sequence.getColumns().ids.front(), sequence.getNoteUnchecked(0).getId());
+
+        // the copy taken before is not affected
+        expectEquals(columns.size(), sequence.size() + 1);
+    }
+};
+
+static PianoSequenceColumnsTests pianoSequenceColumnsTests;
+
+// Pastes lots of notes at once and checks that they are taken from the pool
+// rather than allocated one by one, and that the pool gives the memory back
+
+class PianoSequenceAllocationTests final : public UnitTest
+{
+public:
+
+    PianoSequenceAllocationTests() :
+        UnitTest("Piano sequence allocation tests", UnitTestCategories::helio) {}
+
+    void runTest() override
+    {
+        constexpr auto numNotes = 10000;
+
+        PianoSequenceTestTrack track;
+        auto &sequence = track.getPianoSequence();
+        const auto pastedNotes = track.makeRandomNotes(numNotes, 1000);
+
+        beginTest("Pasting a large group of notes");
+
+        const auto statsBefore = MidiEvent::getAllocationStats();
+        sequence.insertGroup(pastedNotes, false);
+        const auto statsAfterPaste = MidiEvent::getAllocationStats();
+
+        const auto numSystemAllocations =
+            statsAfterPaste.numSystemAllocations - statsBefore.numSystemAllocations;
+
+        expectEquals(sequence.size(), numNotes);
+        expectEquals(statsAfterPaste.numLiveEvents - statsBefore.numLiveEvents, int64(numNotes));
+
+        // one slab holds hundreds of notes
+        expect(numSystemAllocations > 0 && numSystemAllocations < numNotes / 100,
+            "Expected the notes to be allocated in slabs");
+
+        beginTest("Loading a large sequence");
+
+        {
+            // the way the project loading creates the notes
+            const auto serializedSequence = sequence.serialize();
+
+            PianoSequenceTestTrack loadedTrack;
+            auto &loadedSequence = loadedTrack.getPianoSequence();
+
+            const auto statsBeforeLoad = MidiEvent::getAllocationStats();
+            loadedSequence.deserialize(serializedSequence);
+            const auto statsAfterLoad = MidiEvent::getAllocationStats();
+
+            const auto numLoadSystemAllocations =
+                statsAfterLoad.numSystemAllocations - statsBeforeLoad.numSystemAllocations;
+
+            expectEquals(loadedSequence.size(), numNotes);
+            expectEquals(statsAfterLoad.numAllocations - statsBeforeLoad.numAllocations, int64(numNotes));
+            expect(numLoadSystemAllocations > 0 && numLoadSystemAllocations < numNotes / 100,
+                "Expected the loaded notes to be allocated in slabs");
+
+            loadedSequence.reset();
+        }
+
+        beginTest("Removing most of the notes");
+
+        // the notes pasted first fill the first slabs,
+        // which are released as soon as they are empty
+        Array<Note> removedNotes(pastedNotes);
+        removedNotes.removeLast(numNotes / 10);
+        sequence.removeGroup(removedNotes, false);
+
+        const auto statsAfterRemove = MidiEvent::getAllocationStats();
+        expectEquals(sequence.size(), numNotes / 10);
+        expect(statsAfterRemove.numSlabs - statsBefore.numSlabs <
+            (statsAfterPaste.numSlabs - statsBefore.numSlabs) / 2,
+            "Expected the empty slabs to be released");
+
+        beginTest("Freeing all notes");
+
+        sequence.reset();
+
+        expectEquals(sequence.size(), 0);
+        expectEquals(MidiEvent::getAllocationStats().numLiveEvents, statsBefore.numLiveEvents);
+        expect(MidiEvent::getAllocationStats().numSlabs <= statsBefore.numSlabs + 1);
+    }
+};
+
+static PianoSequenceAllocationTests pianoSequenceAllocationTests;
+
+// Pastes, moves and deletes groups of notes, and checks that the sequence
+// stays sorted, and that each edit is notified about once, as a group
+
+class PianoSequenceGroupEditTests final : public UnitTest
+{
+public:
+
+    PianoSequenceGroupEditTests() :
+        UnitTest("Piano sequence group edit tests", UnitTestCategories::helio) {}
+
+    void runTest() override
+    {
+        constexpr auto numExistingNotes = 300;
+        constexpr auto numPastedNotes = 100;
+
+        PianoSequenceTestTrack track;
+        auto &sequence = track.getPianoSequence();
+
+        sequence.insertGroup(track.makeRandomNotes(numExistingNotes, 100), false);
+        expectEquals(sequence.size(), numExistingNotes);
+        expect(PianoSequenceTestTrack::isSorted(sequence));
+
+        beginTest("Inserting a group");
+
+        auto pastedNotes = track.makeRandomNotes(numPastedNotes, 100);
+
+        track.resetNotifications();
+        sequence.insertGroup(pastedNotes, false);
+
+        expectEquals(sequence.size(), numExistingNotes + numPastedNotes);
+        expect(PianoSequenceTestTrack::isSorted(sequence));
+        expectEquals(track.getNotifications().numGroups, 1);
+        expectEquals(track.getNotifications().numAdded, numPastedNotes);
+        this->expectNotifiedAbout(track.getNotifications(), pastedNotes);
+
+        beginTest("Changing a group");
+
+        Array<Note> groupBefore, groupAfter;
+        for (int i = 0; i < numPastedNotes; ++i)
+        {
+            const auto &note = sequence.getNoteUnchecked(i * 3);
+            groupBefore.add(note);
+            groupAfter.add(note.withDeltaBeat(float(i % 7) * 4.f - 12.f));
+        }
+
+        track.resetNotifications();
+        sequence.changeGroup(groupBefore, groupAfter, false);
+
+        expectEquals(sequence.size(), numExistingNotes + numPastedNotes);
+        expect(PianoSequenceTestTrack::isSorted(sequence));
+        expectEquals(track.getNotifications().numGroups, 1);
+        expectEquals(track.getNotifications().numChanged, numPastedNotes);
+        this->expectNotifiedAbout(track.getNotifications(), groupAfter);
+
+        FlatHashMap<MidiEvent::Id, float> beats;
+        for (const auto *event : sequence)
+        {
+            beats[event->getId()] = event->getBeat();
+        }
+
+        for (const auto &note : groupAfter)
+        {
+            expectEquals(beats[note.getId()], note.getBeat());
+        }
+
+        beginTest("Removing a group");
+
+        track.resetNotifications();
+        sequence.removeGroup(groupAfter, false);
+
+        expectEquals(sequence.size(), numExistingNotes);
+        expect(PianoSequenceTestTrack::isSorted(sequence));
+        expectEquals(track.getNotifications().numGroups, 1);
+        expectEquals(track.getNotifications().numRemoved, numPastedNotes);
+        expectEquals(track.getNotifications().numPostRemoved, 1);
+        this->expectNotifiedAbout(track.getNotifications(), groupAfter);
+
+        for (const auto *event : sequence)
+        {
+            if (track.getNotifications().ids.contains(event->getId()))
+            {
+                expect(false, "The removed note is still there");
+                break;
+            }
+        }
+    }
+
+private:
+
+    void expectNotifiedAbout(const PianoSequenceTestTrack::Notifications &notifications,
+        const Array<Note> &notes)
+    {
+        expectEquals(int(notifications.ids.size()), notes.size());
+        for (const auto &note : notes)
+        {
+            expect(notifications.ids.contains(note.getId()));
+        }
+    }
+};
+
+static PianoSequenceGroupEditTests pianoSequenceGroupEditTests;
+
+class PianoSequenceImportTests final : public UnitTest
+{
+public:
+
+    PianoSequenceImportTests() :
+        UnitTest("Piano sequence import tests", UnitTestCategories::helio) {}
+
+    void runTest() override
+    {
+        constexpr short ticksPerBeat = 96;
+
+        MidiMessageSequence source;
+        source.addEvent(MidiMessage::noteOn(1, 60, 0.5f), 0.0);
+        source.addEvent(MidiMessage::noteOn(1, 62, 0.5f), 0.0); // never released
+        source.addEvent(MidiMessage::noteOn(2, 60, 0.5f), 48.0);
+        source.addEvent(MidiMessage::noteOn(1, 60, 0.5f), 96.0); // retriggered
+        source.addEvent(MidiMessage::noteOff(2, 60), 144.0);
+        source.addEvent(MidiMessage::noteOff(1, 60), 192.0);
+        // overlapping notes of the same key: the second note-on
+        // ends the first note, and the first note-off ends the second one
+        source.addEvent(MidiMessage::noteOn(1, 64, 0.5f), 288.0);
+        source.addEvent(MidiMessage::noteOn(1, 64, 0.25f), 336.0);
+        source.addEvent(MidiMessage::noteOff(1, 64), 384.0);
+        source.addEvent(MidiMessage::noteOff(1, 64), 480.0); // nothing to release
+        // the zero-length note is skipped
+        source.addEvent(MidiMessage::noteOn(1, 65, 0.5f), 480.0);
+        source.addEvent(MidiMessage::noteOff(1, 65), 480.0);
+        source.addEvent(MidiMessage::noteOn(3, 67, 0.5f), 576.0); // never released
+
+        beginTest("Pairing note-ons and note-offs");
+
+        {
+            PianoSequenceTestTrack track;
+            auto &sequence = track.getPianoSequence();
+            sequence.importMidi(source, ticksPerBeat, {});
+
+            expectEquals(sequence.size(), 5);
+            this->expectNote(sequence.getNoteUnchecked(0), 60, 0.f, 1.f, 0.5f);
+            this->expectNote(sequence.getNoteUnchecked(1), 60, 0.5f, 1.f, 0.5f);
+            this->expectNote(sequence.getNoteUnchecked(2), 60, 1.f, 1.f, 0.5f);
+            this->expectNote(sequence.getNoteUnchecked(3), 64, 3.f, 0.5f, 0.5f);
+            this->expectNote(sequence.getNoteUnchecked(4), 64, 3.5f, 0.5f, 0.25f);
+            expect(PianoSequenceTestTrack::isSorted(sequence));
+        }
+
+        beginTest("Filtering by channel");
+
+        {
+            PianoSequenceTestTrack track;
+            auto &sequence = track.getPianoSequence();
+            sequence.importMidi(source, ticksPerBeat, 2);
+
+            expectEquals(sequence.size(), 1);
+            this->expectNote(sequence.getNoteUnchecked(0), 60, 0.5f, 1.f, 0.5f);
+        }
+
+        {
+            PianoSequenceTestTrack track;
+            auto &sequence = track.getPianoSequence();
+            sequence.importMidi(source, ticksPerBeat, 3);
+            expectEquals(sequence.size(), 0);
+        }
+    }
+
+private:
+
+    void expectNote(const Note &note, int key, float beat, float length, float velocity)
+    {
+        expectEquals(note.getKey(), key);
+        expectEquals(note.getBeat(), beat);
+        expectEquals(note.getLength(), length);
+        expectWithinAbsoluteError(note.getVelocity(), velocity, 0.01f);
+    }
+};
+
+static PianoSequenceImportTests pianoSequenceImportTests;
+
+class PianoSequenceBeatRangeTests final : public UnitTest
+{
+public:
+
+    PianoSequenceBeatRangeTests() :
+        UnitTest("Piano sequence beat range tests", UnitTestCategories::helio) {}
+
+    void runTest() override
+    {
+        PianoSequenceTestTrack track;
+        auto &sequence = track.getPianoSequence();
+
+        beginTest("A long note followed by many short ones");
+
+        const Note longNote(&sequence, 60, 0.f, 100.f, 0.5f);
+        sequence.insert(longNote, false);
+
+        Array<Note> shortNotes;
+        for (int i = 0; i < 100; ++i)
+        {
+            shortNotes.add(Note(&sequence, 64, float(i) * 0.5f, 0.25f, 0.5f));
+        }
+
+        sequence.insertGroup(shortNotes, false);
+        expectEquals(sequence.getLastBeat(), 100.f);
+
+        beginTest("Changing and removing the longest note");
+
+        const auto changedNote = longNote.withLength(200.f);
+        sequence.change(longNote, changedNote, false);
+        expectEquals(sequence.getLastBeat(), 200.f);
+
+        sequence.remove(changedNote, false);
+        expectEquals(sequence.getLastBeat(), 49.75f);
+
+        beginTest("Changing and removing a group");
+
+        Array<Note> longerNotes;
+        for (const auto &note : shortNotes)
+        {
+            longerNotes.add(note.withLength(1.f));
+        }
+
+        sequence.changeGroup(shortNotes, longerNotes, false);
+        expectEquals(sequence.getLastBeat(), 50.5f);
+
+        longerNotes.removeLast(10);
+        sequence.removeGroup(longerNotes, false);
+        expectEquals(sequence.size(), 10);
+        expectEquals(sequence.getLastBeat(), 50.5f);
+
+        beginTest("Notes added bypassing the editing methods");
+
+        sequence.reset();
+        sequence.checkoutEvent<Note>(Note(&sequence, 60, 0.f, 10.f, 0.5f).serialize());
+        sequence.checkoutEvent<Note>(Note(&sequence, 60, 1.f, 1.f, 0.5f).serialize());
+        sequence.updateBeatRange(false);
+        expectEquals(sequence.getLastBeat(), 10.f);
+    }
+};
+
+static PianoSequenceBeatRangeTests pianoSequenceBeatRangeTests;
+
+class PianoSequenceSpatialIndexTests final : public UnitTest
+{
+public:
+
+    PianoSequenceSpatialIndexTests() :
+        UnitTest("Piano sequence spatial index tests", UnitTestCategories::helio) {}
+
+    void runTest() override
+    {
+        PianoSequenceTestTrack track;
+        auto &sequence = track.getPianoSequence();
+
+        // mostly short notes, and a few very long ones,
+        // spanning lots of grid cells in the first 2000 beats
+        auto notes = track.makeRandomNotes(2000, 2000);
+        for (int i = 0; i < notes.size(); i += 100)
+        {
+            notes.getReference(i) = notes.getReference(i).withLength(64.f);
+        }
+
+        sequence.insertGroup(notes, false);
+
+        Random random(1);
+
+        beginTest("Finding notes in areas");
+        this->expectSameAsFullScan(sequence, random);
+
+        beginTest("Finding notes after changes");
+
+        Array<Note> notesBefore;
+        Array<Note> notesAfter;
+        const auto movedNotes = track.makeRandomNotes(500, 2000);
+        for (int i = 0; i < movedNotes.size(); ++i)
+        {
+            notesBefore.add(notes.getReference(i));
+            notesAfter.add(notes.getReference(i).withKeyBeat(movedNotes.getReference(i).getKey(),
+                movedNotes.getReference(i).getBeat()));
+        }
+
+        sequence.changeGroup(notesBefore, notesAfter, false);
+        notesAfter.removeLast(250);
+        sequence.removeGroup(notesAfter, false);
+        this->expectSameAsFullScan(sequence, random);
+
+        beginTest("Finding notes after a rebuild");
+
+        const auto state = sequence.serialize();
+        sequence.deserialize(state);
+        this->expectSameAsFullScan(sequence, random);
+    }
+
+private:
+
+    void expectSameAsFullScan(const PianoSequence &sequence, Random &random)
+    {
+        for (int i = 0; i < 200; ++i)
+        {
+            const auto startBeat = float(random.nextInt(2100)) - 50.f;
+            const auto endBeat = startBeat + float(random.nextInt(64));
+            const auto minKey = random.nextInt(140) - 10;
+            const auto maxKey = minKey + random.nextInt(24);
+
+            Array<const Note *> found;
+            sequence.findNotesInArea(startBeat, endBeat, minKey, maxKey, found);
+
+            int numExpected = 0;
+            for (const auto *event : sequence)
+            {
+                const auto *note = static_cast<const Note *>(event);
+                if (note->getBeat() <= endBeat &&
+                    note->getBeat() + note->getLength() >= startBeat &&
+                    note->getKey() >= minKey && note->getKey() <= maxKey)
+                {
+                    expect(found.contains(note));
+                    numExpected++;
+                }
+            }
+
+            expectEquals(found.size(), numExpected);
+        }
+    }
+};
+
+static PianoSequenceSpatialIndexTests pianoSequenceSpatialIndexTests;
+
+class PianoSequenceEventIdTests final : public UnitTest
+{
+public:
+
+    PianoSequenceEventIdTests() :
+        UnitTest("Piano sequence event id tests", UnitTestCategories::helio) {}
+
+    void runTest() override
+    {
+        constexpr auto numNotes = 5000;
+
+        PianoSequenceTestTrack track;
+        auto &sequence = track.getPianoSequence();
+
+        beginTest("Creating unique note ids");
+
+        // more than all 2-character ids, so the generator
+        // has to move on to the 3-character ones at some point
+        const auto notes = track.makeRandomNotes(numNotes, 1000);
+
+        FlatHashSet<MidiEvent::Id> ids;
+        for (const auto &note : notes)
+        {
+            ids.insert(note.getId());
+        }
+
+        expectEquals(int(ids.size()), numNotes);
+
+        beginTest("Serializing the generated ids");
+
+        for (const auto &note : notes)
+        {
+            Note deserializedNote;
+            deserializedNote.deserialize(note.serialize());
+            if (deserializedNote.getId() != note.getId())
+            {
+                expect(false, "The note id changed after serialization");
+                break;
+            }
+        }
+
+        beginTest("Creating ids after loading the notes");
+
+        sequence.insertGroup(notes, false);
+        const auto state = sequence.serialize();
+        sequence.deserialize(state);
+
+        const Note newNote(&sequence, 60, 0.f, 1.f, 0.5f);
+        expect(!ids.contains(newNote.getId()));
+    }
+};
+
+static PianoSequenceEventIdTests pianoSequenceEventIdTests;
+
+#endif
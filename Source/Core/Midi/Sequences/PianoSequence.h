@@ -57,6 +57,13 @@ public:
     void importMidi(const MidiMessageSequence &sequence,
         short timeFormat, Optional<int> filterByChannel) override;
 
+    void exportMidi(Array<MidiMessage> &outMessages,
+        const Clip &clip, const KeyboardMapping &keyMap,
+        GeneratedSequenceBuilder &generatedSequences,
+        bool soloPlaybackMode,
+        float projectFirstBeat, float projectLastBeat,
+        double timeFactor = 1.0) const override;
+
     //===------------------------------------------------------------------===//
     // Undoable track editing
     //===------------------------------------------------------------------===//
@@ -70,6 +77,49 @@ public:
     bool changeGroup(Array<Note> &eventsBefore,
         Array<Note> &eventsAfter, bool undoable);
 
+    //===------------------------------------------------------------------===//
+    // Dense storage
+    //===------------------------------------------------------------------===//
+
+    // The notes' parameters, column by column, in the same order as the notes:
+    // the owned notes are still the primary storage used for editing, but the code
+    // which needs to go through lots of notes, like the export, can use these
+    // instead of chasing pointers; rebuilt lazily after any change
+    struct Columns final
+    {
+        std::vector<float> beats;
+        std::vector<float> lengths;
+        std::vector<float> velocities;
+        std::vector<Note::Key> keys;
+        std::vector<Note::Tuplet> tuplets;
+        std::vector<MidiEvent::Id> ids;
+
+        inline int size() const noexcept
+        {
+            return int(this->beats.size());
+        }
+    };
+
+    // like the rest of the sequence, this is not thread-safe: the editing
+    // methods don't lock anything, so the callers, including the export,
+    // are expected to run on the message thread; the reference is valid
+    // until the next change of the sequence
+    const Columns &getColumns() const;
+
+    // all the changes end up here, so this is where the columns get outdated
+    void updateBeatRange(bool shouldNotifyIfChanged) override;
+
+    //===------------------------------------------------------------------===//
+    // Spatial index
+    //===------------------------------------------------------------------===//
+
+    // Finds the notes touching the given beat range, with the keys
+    // within the given range, both inclusive, in no particular order;
+    // only looks into the grid cells which overlap the area,
+    // instead of going through all notes
+    void findNotesInArea(float startBeat, float endBeat,
+        Note::Key minKey, Note::Key maxKey, Array<const Note *> &outNotes) const;
+
     //===------------------------------------------------------------------===//
     // NoteListBase
     //===------------------------------------------------------------------===//
@@ -90,6 +140,31 @@ private:
 
     float findLastBeat() const noexcept override;
 
+    // The indices below are kept in sync by the editing methods,
+    // and rebuilt in updateBeatRange when the notes were added
+    // bypassing them, e.g. by deserialize or by checkoutEvent
+    void indexNote(const MidiEvent *note);
+    void unindexNote(const MidiEvent *note);
+    void rebuildNoteIndices();
+
+    // The end beats of all notes, so that the last beat is known exactly,
+    // without scanning the notes, since they are sorted by start beat
+    std::multiset<float> noteEndBeats;
+
+    // The notes by the grid cells of noteGridCellBeats x noteGridCellKeys,
+    // the note spanning several cells is added to each of them;
+    // the cells' extents only grow until the index is rebuilt,
+    // they just limit the number of cells the searches look into
+    FlatHashMap<int64, Array<const Note *>> noteGrid;
+    Range<int> noteGridColumns;
+    Range<int> noteGridRows;
+
+    static constexpr auto noteGridCellBeats = 16.f;
+    static constexpr auto noteGridCellKeys = 12;
+
+    mutable Columns columns;
+    mutable bool columnsOutdated = true;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PianoSequence)
     JUCE_DECLARE_WEAK_REFERENCEABLE(PianoSequence)
 };
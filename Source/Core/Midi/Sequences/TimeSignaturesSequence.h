@@ -33,10 +33,10 @@ public:
 
     void importMidi(const MidiMessageSequence &sequence,
         short timeFormat, Optional<int> customFilter) override;
-    void exportMidi(MidiMessageSequence &outSequence,
+    void exportMidi(Array<MidiMessage> &outMessages,
         const Clip &clip, const KeyboardMapping &keyMap,
         GeneratedSequenceBuilder &generatedSequences,
-        bool soloPlaybackMode, bool exportMetronome,
+        bool soloPlaybackMode,
         float projectFirstBeat, float projectLastBeat,
         double timeFactor = 1.0) const override;
 
@@ -203,6 +203,8 @@ namespace Serialization
         static const Identifier midiInputName = "midiInputName";
         static const Identifier midiInputId = "midiInputId";
         static const Identifier midiInputReadjusting = "midiInputReadjusting";
+        static const Identifier parallelProcessing = "parallelProcessing";
+        static const Identifier idleInstrumentsHangover = "idleInstrumentsHangover";
         static const Identifier midiOutputName = "midiOutputName";
         static const Identifier midiOutputId = "midiOutputId";
 
@@ -232,6 +234,8 @@ namespace Serialization
             static const Identifier soundFontConfig = "soundFontPlayer";
             static const Identifier filePath = "filePath";
             static const Identifier programIndex = "programIndex";
+            static const Identifier streamingPreloadTime = "streamingPreloadTime";
+            static const Identifier numVoices = "numVoices";
         } // namespace SoundFont
     } // namespace Audio
 
@@ -467,6 +467,31 @@ void MidiTrackNode::dispatchRemoveEvent(const MidiEvent &event)
     }
 }
 
+void MidiTrackNode::dispatchAddEvents(const Array<const MidiEvent *> &events)
+{
+    if (this->lastFoundParent != nullptr)
+    {
+        this->lastFoundParent->broadcastAddEvents(events);
+    }
+}
+
+void MidiTrackNode::dispatchChangeEvents(const Array<const MidiEvent *> &oldEvents,
+    const Array<const MidiEvent *> &newEvents)
+{
+    if (this->lastFoundParent != nullptr)
+    {
+        this->lastFoundParent->broadcastChangeEvents(oldEvents, newEvents);
+    }
+}
+
+void MidiTrackNode::dispatchRemoveEvents(const Array<const MidiEvent *> &events)
+{
+    if (this->lastFoundParent != nullptr)
+    {
+        this->lastFoundParent->broadcastRemoveEvents(events);
+    }
+}
+
 void MidiTrackNode::dispatchPostRemoveEvent(MidiSequence *const layer)
 {
     jassert(layer == this->sequence.get());
@@ -38,6 +38,34 @@ public:
     virtual void dispatchRemoveEvent(const MidiEvent &event) = 0;
     virtual void dispatchPostRemoveEvent(MidiSequence *const sequence) = 0;
 
+    // Sent by the group edits instead of the above, once per group;
+    // by default, fall back to notifying about each event separately
+    virtual void dispatchAddEvents(const Array<const MidiEvent *> &events)
+    {
+        for (const auto *event : events)
+        {
+            this->dispatchAddEvent(*event);
+        }
+    }
+
+    virtual void dispatchChangeEvents(const Array<const MidiEvent *> &oldEvents,
+        const Array<const MidiEvent *> &newEvents)
+    {
+        jassert(oldEvents.size() == newEvents.size());
+        for (int i = 0; i < newEvents.size(); ++i)
+        {
+            this->dispatchChangeEvent(*oldEvents.getUnchecked(i), *newEvents.getUnchecked(i));
+        }
+    }
+
+    virtual void dispatchRemoveEvents(const Array<const MidiEvent *> &events)
+    {
+        for (const auto *event : events)
+        {
+            this->dispatchRemoveEvent(*event);
+        }
+    }
+
     // Patterns and clips
     virtual void dispatchAddClip(const Clip &clip) = 0;
     virtual void dispatchChangeClip(const Clip &oldClip, const Clip &newClip) = 0;
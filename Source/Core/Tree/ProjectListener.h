@@ -36,6 +36,35 @@ public:
     virtual void onRemoveMidiEvent(const MidiEvent &event) {}
     virtual void onPostRemoveMidiEvent(MidiSequence *const sequence) {}
 
+    // Sent by the group edits instead of the above, once per group,
+    // all events in a group belong to the same sequence; by default,
+    // these fall back to the per-event callbacks, so the listeners
+    // only need to override them where handling a group at once pays off
+    virtual void onAddMidiEvents(const Array<const MidiEvent *> &events)
+    {
+        for (const auto *event : events)
+        {
+            this->onAddMidiEvent(*event);
+        }
+    }
+
+    virtual void onChangeMidiEvents(const Array<const MidiEvent *> &oldEvents,
+        const Array<const MidiEvent *> &newEvents)
+    {
+        for (int i = 0; i < newEvents.size(); ++i)
+        {
+            this->onChangeMidiEvent(*oldEvents.getUnchecked(i), *newEvents.getUnchecked(i));
+        }
+    }
+
+    virtual void onRemoveMidiEvents(const Array<const MidiEvent *> &events)
+    {
+        for (const auto *event : events)
+        {
+            this->onRemoveMidiEvent(*event);
+        }
+    }
+
     virtual void onAddClip(const Clip &clip) {}
     virtual void onChangeClip(const Clip &oldClip, const Clip &newClip) {}
     virtual void onRemoveClip(const Clip &clip) {}
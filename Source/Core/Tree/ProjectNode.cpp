@@ -618,10 +618,24 @@ void ProjectNode::importMidi(InputStream &stream)
     this->broadcastBeforeReloadProjectContent();
     this->timeline->reset();
 
+    this->undoStack->clearUndoHistory();
+    this->undoStack->beginNewTransaction();
+
     Random r;
     const auto colours = ColourIDs::getColoursList();
     const auto timeFormat = tempFile.getTimeFormat();
 
+    // the tracks' events are parsed later in parallel,
+    // while the tree is only modified on this thread
+    struct TrackImport final
+    {
+        MidiSequence *sequence;
+        const MidiMessageSequence *source;
+        Optional<int> filter;
+    };
+
+    std::vector<TrackImport> trackImports;
+
     for (int i = 0; i < tempFile.getNumTracks(); i++)
     {
         const auto *importedTrack = tempFile.getTrack(i);
@@ -686,8 +700,8 @@ void ProjectNode::importMidi(InputStream &stream)
             trackNode->setTrackColour(trackColour, false, dontSendNotification);
 
             const auto isSingleControllerTrack = automationControllers.size() == 1;
-            trackNode->getSequence()->importMidi(*importedTrack, timeFormat,
-                isSingleControllerTrack ? Optional<int>() : trackControllerNumber);
+            trackImports.push_back({ trackNode->getSequence(), importedTrack,
+                isSingleControllerTrack ? Optional<int>() : trackControllerNumber });
         }
 
         // split into several piano tracks, if needed
@@ -707,8 +721,8 @@ void ProjectNode::importMidi(InputStream &stream)
             trackNode->setTrackColour(trackColour, false, dontSendNotification);
 
             const auto isSingleChannelTrack = pianoChannels.size() == 1;
-            trackNode->getSequence()->importMidi(*importedTrack, timeFormat,
-                isSingleChannelTrack ? Optional<int>() : trackChannel);
+            trackImports.push_back({ trackNode->getSequence(), importedTrack,
+                isSingleChannelTrack ? Optional<int>() : trackChannel });
         }
 
         // if the track contains any key/time signatures, try importing them all,
@@ -718,6 +732,29 @@ void ProjectNode::importMidi(InputStream &stream)
         this->timeline->getKeySignatures()->getSequence()->importMidi(*importedTrack, timeFormat, {});
         this->timeline->getTimeSignatures()->getSequence()->importMidi(*importedTrack, timeFormat, {});
     }
+
+    if (!trackImports.empty())
+    {
+        // each sequence only touches its own events, so
+        // importing different tracks at once is safe
+        ThreadPool importPool(jlimit(1, int(trackImports.size()), SystemStats::getNumCpus()));
+        Atomic<int> numImportsLeft(int(trackImports.size()));
+        WaitableEvent allImportsDone;
+
+        for (const auto &trackImport : trackImports)
+        {
+            importPool.addJob([&trackImport, &numImportsLeft, &allImportsDone, timeFormat]()
+            {
+                trackImport.sequence->importMidi(*trackImport.source, timeFormat, trackImport.filter);
+                if (--numImportsLeft == 0)
+                {
+                    allImportsDone.signal();
+                }
+            });
+        }
+
+        allImportsDone.wait(-1);
+    }
     
     this->isTracksCacheOutdated = true;
     this->broadcastReloadProjectContent();
@@ -782,6 +819,29 @@ void ProjectNode::broadcastPostRemoveEvent(MidiSequence *const sequence)
     this->sendChangeMessage();
 }
 
+void ProjectNode::broadcastAddEvents(const Array<const MidiEvent *> &events)
+{
+    if (events.isEmpty()) { return; }
+    this->changeListeners.call(&ProjectListener::onAddMidiEvents, events);
+    this->sendChangeMessage();
+}
+
+void ProjectNode::broadcastChangeEvents(const Array<const MidiEvent *> &oldEvents,
+    const Array<const MidiEvent *> &newEvents)
+{
+    jassert(oldEvents.size() == newEvents.size());
+    if (newEvents.isEmpty()) { return; }
+    this->changeListeners.call(&ProjectListener::onChangeMidiEvents, oldEvents, newEvents);
+    this->sendChangeMessage();
+}
+
+void ProjectNode::broadcastRemoveEvents(const Array<const MidiEvent *> &events)
+{
+    if (events.isEmpty()) { return; }
+    this->changeListeners.call(&ProjectListener::onRemoveMidiEvents, events);
+    this->sendChangeMessage();
+}
+
 void ProjectNode::broadcastAddTrack(MidiTrack *const track)
 {
     this->isTracksCacheOutdated = true;
@@ -987,11 +1047,11 @@ bool ProjectNode::exportMidi(OutputStream &stream) const
     // in MIDI export, as I believe they shouldn't:
     const bool soloFlag = false;
 
-    // Metronome track flag is only needed for playback:
-    const bool metronomeFlag = false;
-
     const auto grouping = this->getTrackGroupingMode();
-    FlatHashMap<String, MidiMessageSequence, StringHash> sequences;
+
+    // all clips of the grouped tracks are collected
+    // unsorted and sorted once, see flushExportedMessages
+    FlatHashMap<String, Array<MidiMessage>, StringHash> sequences;
 
     for (const auto *track : this->getTracks())
     {
@@ -1010,7 +1070,7 @@ bool ProjectNode::exportMidi(OutputStream &stream) const
             {
                 track->getSequence()->exportMidi(sequence, *clip,
                     simpleMapping, *this->generatedSequenceBuilder,
-                    soloFlag, metronomeFlag,
+                    soloFlag,
                     this->beatRange.getStart(), this->beatRange.getEnd(),
                     midiClock);
             }
@@ -1019,7 +1079,7 @@ bool ProjectNode::exportMidi(OutputStream &stream) const
         {
             track->getSequence()->exportMidi(sequence, noTransform,
                 simpleMapping, *this->generatedSequenceBuilder,
-                soloFlag, metronomeFlag,
+                soloFlag,
                 this->beatRange.getStart(), this->beatRange.getEnd(),
                 midiClock);
         }
@@ -1030,7 +1090,8 @@ bool ProjectNode::exportMidi(OutputStream &stream) const
         // the project will not necessarily start from 0 timestamp;
         // normally we don't care (not caring about that also makes the code simpler),
         // but when exporting to MIDI file, let's make sure the start is at zero:
-        auto &sequence = sequences[i.first];
+        MidiMessageSequence sequence;
+        MidiSequence::flushExportedMessages(sequences[i.first], sequence);
         sequence.addTimeToMessages(-this->beatRange.getStart() * midiClock);
         tempFile.addTrack(sequence);
     }
@@ -146,6 +146,11 @@ public:
     void broadcastRemoveEvent(const MidiEvent &event);
     void broadcastPostRemoveEvent(MidiSequence *const sequence);
 
+    void broadcastAddEvents(const Array<const MidiEvent *> &events);
+    void broadcastChangeEvents(const Array<const MidiEvent *> &oldEvents,
+        const Array<const MidiEvent *> &newEvents);
+    void broadcastRemoveEvents(const Array<const MidiEvent *> &events);
+
     void broadcastAddTrack(MidiTrack *const track);
     void broadcastRemoveTrack(MidiTrack *const track);
     void broadcastChangeTrackProperties(MidiTrack *const track);
@@ -19,7 +19,8 @@
 #include "SpectralLogo.h"
 #include "ColourIDs.h"
 
-SpectralLogo::SpectralLogo()
+SpectralLogo::SpectralLogo(WeakReference<AudioMonitor> audioMonitor) :
+    audioMonitor(audioMonitor)
 {
     for (int i = 0; i < SpectralLogo::bandCount; ++i)
     {
@@ -39,9 +40,44 @@ void SpectralLogo::timerCallback()
         MathConstants<float>::pi / pulseSpeed,
         MathConstants<float>::twoPi);
 
+    if (this->audioMonitor != nullptr)
+    {
+        this->updateBandLevels();
+    }
+
     this->repaint();
 }
 
+void SpectralLogo::updateBandLevels()
+{
+    this->audioMonitor->getSpectrum(this->spectrum);
+
+    // each band covers the same number of octaves,
+    // from about 40 Hz at 44.1 kHz up to Nyquist
+    static constexpr auto minBin = 2.f;
+    static constexpr auto maxBin = float(AudioMonitor::spectrumSize);
+    static constexpr auto minDecibels = -60.f;
+
+    const auto getBandStart = [](int band)
+    {
+        return int(minBin * powf(maxBin / minBin, float(band) / float(SpectralLogo::bandCount)));
+    };
+
+    for (int i = 0; i < SpectralLogo::bandCount; ++i)
+    {
+        const auto startBin = getBandStart(i);
+        const auto endBin = jlimit(startBin + 1, AudioMonitor::spectrumSize, getBandStart(i + 1));
+
+        float loudest = minDecibels;
+        for (int bin = startBin; bin < endBin; ++bin)
+        {
+            loudest = jmax(loudest, this->spectrum[bin]);
+        }
+
+        this->bandLevels[i] = (loudest - minDecibels) / -minDecibels;
+    }
+}
+
 float SpectralLogo::getLineThickness() const noexcept
 {
     return this->lineThickness;
@@ -111,7 +147,8 @@ void SpectralLogo::paint(Graphics &g)
             const float v =
                 (heptagramShape * bandSize) -
                 (r.nextFloat() * this->randomnessRange) -
-                (pulseMultiplier * pulseMultiplier * this->randomnessRange * (0.5f - heptagramShape) * 0.5f);
+                (pulseMultiplier * pulseMultiplier * this->randomnessRange * (0.5f - heptagramShape) * 0.5f) +
+                (this->bandLevels[i] * this->randomnessRange);
             
             const float radians = float(i) * (MathConstants<float>::twoPi / float(SpectralLogo::bandCount));
             g.fillPath(this->bands[i]->buildPath(v, cx, cy, bandSize, radians, coreCircleSize, timeNow));
@@ -18,12 +18,14 @@
 #pragma once
 
 #include "ColourIDs.h"
+#include "AudioMonitor.h"
 
 class SpectralLogo final : public Component, private Timer
 {
 public:
 
-    SpectralLogo();
+    // the rays follow the spectrum of whatever is playing, if the monitor is given
+    explicit SpectralLogo(WeakReference<AudioMonitor> audioMonitor = nullptr);
     ~SpectralLogo() override;
     
     void paint(Graphics &g) override;
@@ -86,6 +88,11 @@ private:
     
     static constexpr auto bandCount = 70;
 
+    WeakReference<AudioMonitor> audioMonitor;
+    float spectrum[AudioMonitor::spectrumSize] = {};
+    float bandLevels[bandCount] = {};
+    void updateBandLevels();
+
     float pulse = 0.f;
     
     float randomnessRange = 0;
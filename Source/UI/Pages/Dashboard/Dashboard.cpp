@@ -18,6 +18,8 @@
 #include "Common.h"
 #include "Dashboard.h"
 #include "SpectralLogo.h"
+#include "Workspace.h"
+#include "AudioCore.h"
 #include "OverlayButton.h"
 #include "DashboardMenu.h"
 #include "PageBackgroundA.h"
@@ -50,7 +52,7 @@ Dashboard::Dashboard(Workspace &workspace) : workspace(workspace)
 
     this->skew = make<SeparatorVerticalSkew>();
     this->addAndMakeVisible(this->skew.get());
-    this->logo = make<SpectralLogo>();
+    this->logo = make<SpectralLogo>(this->workspace.getAudioCore().getMonitor());
     this->addAndMakeVisible(this->logo.get());
 
     this->projectsList = make<DashboardMenu>(this->workspace);
@@ -792,13 +792,43 @@ void VelocityEditor::onChangeMidiEvent(const MidiEvent &e1, const MidiEvent &e2)
 {
     if (e1.isTypeOf(MidiEvent::Type::Note))
     {
-        const Note &note = static_cast<const Note &>(e1);
-        const Note &newNote = static_cast<const Note &>(e2);
-        const auto *track = newNote.getSequence()->getTrack();
+        this->onChangeMidiEvents({ &e1 }, { &e2 });
+    }
+}
 
-        forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
+void VelocityEditor::onAddMidiEvent(const MidiEvent &event)
+{
+    if (event.isTypeOf(MidiEvent::Type::Note))
+    {
+        this->onAddMidiEvents({ &event });
+    }
+}
+
+void VelocityEditor::onRemoveMidiEvent(const MidiEvent &event)
+{
+    if (event.isTypeOf(MidiEvent::Type::Note))
+    {
+        this->onRemoveMidiEvents({ &event });
+    }
+}
+
+void VelocityEditor::onChangeMidiEvents(const Array<const MidiEvent *> &oldEvents,
+    const Array<const MidiEvent *> &newEvents)
+{
+    if (!oldEvents.getFirst()->isTypeOf(MidiEvent::Type::Note))
+    {
+        return;
+    }
+
+    const auto *track = newEvents.getFirst()->getSequence()->getTrack();
+
+    forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
+    {
+        auto &sequenceMap = *c.second.get();
+        for (int i = 0; i < oldEvents.size(); ++i)
         {
-            auto &sequenceMap = *c.second.get();
+            const auto &note = static_cast<const Note &>(*oldEvents.getUnchecked(i));
+            const auto &newNote = static_cast<const Note &>(*newEvents.getUnchecked(i));
             if (auto *component = sequenceMap[note].release())
             {
                 sequenceMap.erase(note);
@@ -809,56 +839,62 @@ void VelocityEditor::onChangeMidiEvent(const MidiEvent &e1, const MidiEvent &e2)
     }
 }
 
-void VelocityEditor::onAddMidiEvent(const MidiEvent &event)
+void VelocityEditor::onAddMidiEvents(const Array<const MidiEvent *> &events)
 {
-    if (event.isTypeOf(MidiEvent::Type::Note))
+    if (!events.getFirst()->isTypeOf(MidiEvent::Type::Note))
     {
-        const Note &note = static_cast<const Note &>(event);
-        const auto *track = note.getSequence()->getTrack();
+        return;
+    }
 
-        VELOCITY_MAP_BATCH_REPAINT_START
+    const auto *track = events.getFirst()->getSequence()->getTrack();
 
-        forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
-        {
-            auto &componentsMap = *c.second.get();
-            const auto *targetClipId = &c.first;
-            const int i = track->getPattern()->indexOfSorted(targetClipId);
-            jassert(i >= 0);
+    VELOCITY_MAP_BATCH_REPAINT_START
 
-            const auto *clip = track->getPattern()->getUnchecked(i);
-            const bool isEditable = this->activeClip == *clip;
+    forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
+    {
+        auto &componentsMap = *c.second.get();
+        const auto *targetClipId = &c.first;
+        const int i = track->getPattern()->indexOfSorted(targetClipId);
+        jassert(i >= 0);
+
+        const auto *clip = track->getPattern()->getUnchecked(i);
+        const bool isEditable = this->activeClip == *clip;
 
+        for (const auto *event : events)
+        {
+            const auto &note = static_cast<const Note &>(*event);
             auto *noteComponent = new VelocityEditorNoteComponent(note, *clip);
             noteComponent->setEditable(isEditable);
             componentsMap[note] = UniquePointer<VelocityEditorNoteComponent>(noteComponent);
             this->addAndMakeVisible(noteComponent);
             this->triggerBatchRepaintFor(noteComponent);
         }
-
-        VELOCITY_MAP_BATCH_REPAINT_END
     }
+
+    VELOCITY_MAP_BATCH_REPAINT_END
 }
 
-void VelocityEditor::onRemoveMidiEvent(const MidiEvent &event)
+void VelocityEditor::onRemoveMidiEvents(const Array<const MidiEvent *> &events)
 {
-    if (event.isTypeOf(MidiEvent::Type::Note))
+    if (!events.getFirst()->isTypeOf(MidiEvent::Type::Note))
     {
-        const Note &note = static_cast<const Note &>(event);
-        const auto *track = note.getSequence()->getTrack();
+        return;
+    }
 
-        VELOCITY_MAP_BATCH_REPAINT_START
+    const auto *track = events.getFirst()->getSequence()->getTrack();
 
-        forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
+    VELOCITY_MAP_BATCH_REPAINT_START
+
+    forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
+    {
+        auto &sequenceMap = *c.second.get();
+        for (const auto *event : events)
         {
-            auto &sequenceMap = *c.second.get();
-            if (sequenceMap.contains(note))
-            {
-                sequenceMap.erase(note);
-            }
+            sequenceMap.erase(static_cast<const Note &>(*event));
         }
-
-        VELOCITY_MAP_BATCH_REPAINT_END
     }
+
+    VELOCITY_MAP_BATCH_REPAINT_END
 }
 
 void VelocityEditor::onAddClip(const Clip &clip)
@@ -103,59 +103,94 @@ void PianoProjectMap::onChangeMidiEvent(const MidiEvent &e1, const MidiEvent &e2
 {
     if (e1.isTypeOf(MidiEvent::Type::Note))
     {
-        const Note &note = static_cast<const Note &>(e1);
-        const Note &newNote = static_cast<const Note &>(e2);
-        const auto *track = newNote.getSequence()->getTrack();
+        this->onChangeMidiEvents({ &e1 }, { &e2 });
+    }
+}
+
+void PianoProjectMap::onAddMidiEvent(const MidiEvent &event)
+{
+    if (event.isTypeOf(MidiEvent::Type::Note))
+    {
+        this->onAddMidiEvents({ &event });
+    }
+}
 
-        forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
+void PianoProjectMap::onRemoveMidiEvent(const MidiEvent &event)
+{
+    if (event.isTypeOf(MidiEvent::Type::Note))
+    {
+        this->onRemoveMidiEvents({ &event });
+    }
+}
+
+void PianoProjectMap::onChangeMidiEvents(const Array<const MidiEvent *> &oldEvents,
+    const Array<const MidiEvent *> &newEvents)
+{
+    if (!oldEvents.getFirst()->isTypeOf(MidiEvent::Type::Note))
+    {
+        return;
+    }
+
+    const auto *track = newEvents.getFirst()->getSequence()->getTrack();
+
+    forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
+    {
+        auto &sequenceMap = *c.second.get();
+        for (int i = 0; i < oldEvents.size(); ++i)
         {
-            auto &sequenceMap = *c.second.get();
+            const auto &note = static_cast<const Note &>(*oldEvents.getUnchecked(i));
             if (sequenceMap.contains(note))
             {
                 sequenceMap.erase(note);
-                sequenceMap.insert(newNote);
+                sequenceMap.insert(static_cast<const Note &>(*newEvents.getUnchecked(i)));
             }
         }
-
-        this->triggerAsyncUpdate();
     }
+
+    this->triggerAsyncUpdate();
 }
 
-void PianoProjectMap::onAddMidiEvent(const MidiEvent &event)
+void PianoProjectMap::onAddMidiEvents(const Array<const MidiEvent *> &events)
 {
-    if (event.isTypeOf(MidiEvent::Type::Note))
+    if (!events.getFirst()->isTypeOf(MidiEvent::Type::Note))
     {
-        const Note &note = static_cast<const Note &>(event);
-        const auto *track = note.getSequence()->getTrack();
+        return;
+    }
+
+    const auto *track = events.getFirst()->getSequence()->getTrack();
 
-        forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
+    forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
+    {
+        auto &sequenceMap = *c.second.get();
+        sequenceMap.reserve(sequenceMap.size() + events.size());
+        for (const auto *event : events)
         {
-            auto &sequenceMap = *c.second.get();
-            sequenceMap.insert(note);
+            sequenceMap.insert(static_cast<const Note &>(*event));
         }
-
-        this->triggerAsyncUpdate();
     }
+
+    this->triggerAsyncUpdate();
 }
 
-void PianoProjectMap::onRemoveMidiEvent(const MidiEvent &event)
+void PianoProjectMap::onRemoveMidiEvents(const Array<const MidiEvent *> &events)
 {
-    if (event.isTypeOf(MidiEvent::Type::Note))
+    if (!events.getFirst()->isTypeOf(MidiEvent::Type::Note))
     {
-        const Note &note = static_cast<const Note &>(event);
-        const auto *track = note.getSequence()->getTrack();
+        return;
+    }
 
-        forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
+    const auto *track = events.getFirst()->getSequence()->getTrack();
+
+    forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
+    {
+        auto &sequenceMap = *c.second.get();
+        for (const auto *event : events)
         {
-            auto &sequenceMap = *c.second.get();
-            if (sequenceMap.contains(note))
-            {
-                sequenceMap.erase(note);
-            }
+            sequenceMap.erase(static_cast<const Note &>(*event));
         }
-
-        this->triggerAsyncUpdate();
     }
+
+    this->triggerAsyncUpdate();
 }
 
 void PianoProjectMap::onAddClip(const Clip &clip)
@@ -87,48 +87,74 @@ void PianoClipComponent::paint(Graphics &g)
 
 void PianoClipComponent::onChangeMidiEvent(const MidiEvent &oldEvent, const MidiEvent &newEvent)
 {
-    if (oldEvent.isTypeOf(MidiEvent::Type::Note))
+    this->onChangeMidiEvents({ &oldEvent }, { &newEvent });
+}
+
+void PianoClipComponent::onAddMidiEvent(const MidiEvent &event)
+{
+    this->onAddMidiEvents({ &event });
+}
+
+void PianoClipComponent::onRemoveMidiEvent(const MidiEvent &event)
+{
+    this->onRemoveMidiEvents({ &event });
+}
+
+// every clip component listens to the project, so with the batched events
+// most of them only have to check the sequence once per group
+
+void PianoClipComponent::onChangeMidiEvents(const Array<const MidiEvent *> &oldEvents,
+    const Array<const MidiEvent *> &newEvents)
+{
+    if (newEvents.getFirst()->getSequence() != this->sequence ||
+        !newEvents.getFirst()->isTypeOf(MidiEvent::Type::Note))
     {
-        const Note &note = static_cast<const Note &>(oldEvent);
-        const Note &newNote = static_cast<const Note &>(newEvent);
-        if (newNote.getSequence() != this->sequence) { return; }
+        return;
+    }
 
+    for (int i = 0; i < oldEvents.size(); ++i)
+    {
+        const auto &note = static_cast<const Note &>(*oldEvents.getUnchecked(i));
         if (this->displayedNotes.contains(note))
         {
             this->displayedNotes.erase(note);
-            this->displayedNotes.insert(newNote);
+            this->displayedNotes.insert(static_cast<const Note &>(*newEvents.getUnchecked(i)));
         }
-
-        this->roll.triggerBatchRepaintFor(this);
     }
+
+    this->roll.triggerBatchRepaintFor(this);
 }
 
-void PianoClipComponent::onAddMidiEvent(const MidiEvent &event)
+void PianoClipComponent::onAddMidiEvents(const Array<const MidiEvent *> &events)
 {
-    if (event.isTypeOf(MidiEvent::Type::Note))
+    if (events.getFirst()->getSequence() != this->sequence ||
+        !events.getFirst()->isTypeOf(MidiEvent::Type::Note))
     {
-        const Note &note = static_cast<const Note &>(event);
-        if (note.getSequence() != this->sequence) { return; }
+        return;
+    }
 
-        this->displayedNotes.insert(note);
-        this->roll.triggerBatchRepaintFor(this);
+    for (const auto *event : events)
+    {
+        this->displayedNotes.insert(static_cast<const Note &>(*event));
     }
+
+    this->roll.triggerBatchRepaintFor(this);
 }
 
-void PianoClipComponent::onRemoveMidiEvent(const MidiEvent &event)
+void PianoClipComponent::onRemoveMidiEvents(const Array<const MidiEvent *> &events)
 {
-    if (event.isTypeOf(MidiEvent::Type::Note))
+    if (events.getFirst()->getSequence() != this->sequence ||
+        !events.getFirst()->isTypeOf(MidiEvent::Type::Note))
     {
-        const Note &note = static_cast<const Note &>(event);
-        if (note.getSequence() != this->sequence) { return; }
-
-        if (this->displayedNotes.contains(note))
-        {
-            this->displayedNotes.erase(note);
-        }
+        return;
+    }
 
-        this->roll.triggerBatchRepaintFor(this);
+    for (const auto *event : events)
+    {
+        this->displayedNotes.erase(static_cast<const Note &>(*event));
     }
+
+    this->roll.triggerBatchRepaintFor(this);
 }
 
 void PianoClipComponent::onChangeClip(const Clip &oldClip, const Clip &newClip)
@@ -563,6 +563,43 @@ int PianoRoll::getYPositionByKey(int targetKey) const
     return (this->getHeight() - this->rowHeight) - (targetKey * this->rowHeight);
 }
 
+void PianoRoll::findNoteComponentsInArea(float startBeat, float endBeat,
+    int minKey, int maxKey, Array<NoteComponent *> &outComponents) const
+{
+    Array<const Note *> notes;
+    for (const auto &c : this->patternMap)
+    {
+        const auto &clip = c.first;
+        const auto *sequence = clip.getPattern()->getTrack()->getSequence();
+        jassert(dynamic_cast<const PianoSequence *>(sequence) != nullptr);
+
+        notes.clearQuick();
+        static_cast<const PianoSequence *>(sequence)->findNotesInArea(
+            startBeat - clip.getBeat(), endBeat - clip.getBeat(),
+            minKey - clip.getKey(), maxKey - clip.getKey(), notes);
+
+        for (const auto *note : notes)
+        {
+            const auto found = c.second->find(*note);
+            if (found != c.second->end())
+            {
+                outComponents.add(found->second.get());
+            }
+        }
+    }
+}
+
+void PianoRoll::findNoteComponentsInArea(const Rectangle<int> &area,
+    Array<NoteComponent *> &outComponents) const
+{
+    // one more key on each side, just to be safe with the rows' borders
+    const auto startBeat = this->getBeatByXPosition(float(area.getX()));
+    const auto endBeat = this->getBeatByXPosition(float(area.getRight()));
+    const auto minKey = (this->getHeight() - area.getBottom()) / this->rowHeight - 1;
+    const auto maxKey = (this->getHeight() - area.getY()) / this->rowHeight + 1;
+    this->findNoteComponentsInArea(startBeat, endBeat, minKey, maxKey, outComponents);
+}
+
 //===----------------------------------------------------------------------===//
 // Drag helpers
 //===----------------------------------------------------------------------===//
@@ -628,26 +665,8 @@ void PianoRoll::onChangeMidiEvent(const MidiEvent &oldEvent, const MidiEvent &ne
 {
     if (oldEvent.isTypeOf(MidiEvent::Type::Note))
     {
-        const auto &note = static_cast<const Note &>(oldEvent);
-        const auto &newNote = static_cast<const Note &>(newEvent);
-        const auto *track = newEvent.getSequence()->getTrack();
-
-        forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
-        {
-            auto &sequenceMap = *c.second.get();
-            if (auto *component = sequenceMap[note].release())
-            {
-                // Pass ownership to another key:
-                sequenceMap.erase(note);
-                // Hitting this assert means that a track somehow contains events
-                // with duplicate id's. This should never, ever happen.
-                jassert(!sequenceMap.contains(newNote));
-                // Always erase before updating, as it may happen both events have the same hash code:
-                sequenceMap[newNote] = UniquePointer<NoteComponent>(component);
-                // Schedule to be repainted later:
-                this->triggerBatchRepaintFor(component);
-            }
-        }
+        this->onChangeMidiEvents({ &oldEvent }, { &newEvent });
+        return;
     }
     else if (oldEvent.isTypeOf(MidiEvent::Type::KeySignature))
     {
@@ -670,17 +689,100 @@ void PianoRoll::onAddMidiEvent(const MidiEvent &event)
 {
     if (event.isTypeOf(MidiEvent::Type::Note))
     {
-        const Note &note = static_cast<const Note &>(event);
-        const auto *track = note.getSequence()->getTrack();
+        this->onAddMidiEvents({ &event });
+        return;
+    }
+    else if (event.isTypeOf(MidiEvent::Type::KeySignature))
+    {
+        const auto &key = static_cast<const KeySignatureEvent &>(event);
+        this->updateBackgroundCacheFor(key);
+        this->noteNameGuides->triggerAsyncUpdate(); // possibly update key names
+        this->repaint();
+    }
 
-        forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
+    RollBase::onAddMidiEvent(event);
+}
+
+void PianoRoll::onRemoveMidiEvent(const MidiEvent &event)
+{
+    if (event.isTypeOf(MidiEvent::Type::Note))
+    {
+        this->onRemoveMidiEvents({ &event });
+        return;
+    }
+    else if (event.isTypeOf(MidiEvent::Type::KeySignature))
+    {
+        const KeySignatureEvent &key = static_cast<const KeySignatureEvent &>(event);
+        this->removeBackgroundCacheFor(key);
+        this->noteNameGuides->triggerAsyncUpdate(); // possibly update key names
+        this->repaint();
+    }
+
+    RollBase::onRemoveMidiEvent(event);
+}
+
+// The notes are handled in groups, looking up the sequence maps
+// of the track once per group; other events' groups are rare and small,
+// so they fall back to the per-event callbacks
+
+void PianoRoll::onChangeMidiEvents(const Array<const MidiEvent *> &oldEvents,
+    const Array<const MidiEvent *> &newEvents)
+{
+    if (!oldEvents.getFirst()->isTypeOf(MidiEvent::Type::Note))
+    {
+        ProjectListener::onChangeMidiEvents(oldEvents, newEvents);
+        return;
+    }
+
+    const auto *track = newEvents.getFirst()->getSequence()->getTrack();
+
+    forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
+    {
+        auto &sequenceMap = *c.second.get();
+        for (int i = 0; i < oldEvents.size(); ++i)
         {
-            auto &sequenceMap = *c.second.get();
-            const auto *targetClipId = &c.first;
-            const int i = track->getPattern()->indexOfSorted(targetClipId);
-            jassert(i >= 0);
-            
-            const auto *clip = track->getPattern()->getUnchecked(i);
+            const auto &note = static_cast<const Note &>(*oldEvents.getUnchecked(i));
+            const auto &newNote = static_cast<const Note &>(*newEvents.getUnchecked(i));
+            if (auto *component = sequenceMap[note].release())
+            {
+                // Pass ownership to another key:
+                sequenceMap.erase(note);
+                // Hitting this assert means that a track somehow contains events
+                // with duplicate id's. This should never, ever happen.
+                jassert(!sequenceMap.contains(newNote));
+                // Always erase before updating, as it may happen both events have the same hash code:
+                sequenceMap[newNote] = UniquePointer<NoteComponent>(component);
+                // Schedule to be repainted later:
+                this->triggerBatchRepaintFor(component);
+            }
+        }
+    }
+
+    RollBase::onChangeMidiEvents(oldEvents, newEvents);
+}
+
+void PianoRoll::onAddMidiEvents(const Array<const MidiEvent *> &events)
+{
+    if (!events.getFirst()->isTypeOf(MidiEvent::Type::Note))
+    {
+        ProjectListener::onAddMidiEvents(events);
+        return;
+    }
+
+    const auto *track = events.getFirst()->getSequence()->getTrack();
+
+    forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
+    {
+        auto &sequenceMap = *c.second.get();
+        const auto *targetClipId = &c.first;
+        const int i = track->getPattern()->indexOfSorted(targetClipId);
+        jassert(i >= 0);
+
+        const auto *clip = track->getPattern()->getUnchecked(i);
+
+        for (const auto *event : events)
+        {
+            const auto &note = static_cast<const Note &>(*event);
             auto *component = new NoteComponent(*this, note, *clip);
             sequenceMap[note] = UniquePointer<NoteComponent>(component);
             this->addAndMakeVisible(component);
@@ -704,30 +806,29 @@ void PianoRoll::onAddMidiEvent(const MidiEvent &event)
             }
         }
     }
-    else if (event.isTypeOf(MidiEvent::Type::KeySignature))
-    {
-        const auto &key = static_cast<const KeySignatureEvent &>(event);
-        this->updateBackgroundCacheFor(key);
-        this->noteNameGuides->triggerAsyncUpdate(); // possibly update key names
-        this->repaint();
-    }
 
-    RollBase::onAddMidiEvent(event);
+    RollBase::onAddMidiEvents(events);
 }
 
-void PianoRoll::onRemoveMidiEvent(const MidiEvent &event)
+void PianoRoll::onRemoveMidiEvents(const Array<const MidiEvent *> &events)
 {
-    if (event.isTypeOf(MidiEvent::Type::Note))
+    if (!events.getFirst()->isTypeOf(MidiEvent::Type::Note))
     {
-        this->hideDragHelpers();
-        this->hideAllGhostNotes();
+        ProjectListener::onRemoveMidiEvents(events);
+        return;
+    }
+
+    this->hideDragHelpers();
+    this->hideAllGhostNotes();
 
-        const Note &note = static_cast<const Note &>(event);
-        const auto *track = note.getSequence()->getTrack();
+    const auto *track = events.getFirst()->getSequence()->getTrack();
 
-        forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
+    forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
+    {
+        auto &sequenceMap = *c.second.get();
+        for (const auto *event : events)
         {
-            auto &sequenceMap = *c.second.get();
+            const auto &note = static_cast<const Note &>(*event);
             if (sequenceMap.contains(note))
             {
                 NoteComponent *deletedComponent = sequenceMap[note].get();
@@ -737,15 +838,8 @@ void PianoRoll::onRemoveMidiEvent(const MidiEvent &event)
             }
         }
     }
-    else if (event.isTypeOf(MidiEvent::Type::KeySignature))
-    {
-        const KeySignatureEvent &key = static_cast<const KeySignatureEvent &>(event);
-        this->removeBackgroundCacheFor(key);
-        this->noteNameGuides->triggerAsyncUpdate(); // possibly update key names
-        this->repaint();
-    }
 
-    RollBase::onRemoveMidiEvent(event);
+    RollBase::onRemoveMidiEvents(events);
 }
 
 void PianoRoll::onAddClip(const Clip &clip)
@@ -1128,9 +1222,13 @@ void PianoRoll::selectEventsInRange(float startBeat, float endBeat, bool shouldC
         this->selection.deselectAll();
     }
 
-    forEachEventComponent(this->patternMap, e)
+    // any key, including the ones of the clips transposed out of view
+    Array<NoteComponent *> components;
+    this->findNoteComponentsInArea(startBeat, endBeat,
+        -this->getNumKeys(), this->getNumKeys() * 2, components);
+
+    for (auto *component : components)
     {
-        auto *component = e.second.get();
         if (component->isActiveAndEditable() &&
             (component->getNote().getBeat() + component->getClip().getBeat()) >= startBeat &&
             (component->getNote().getBeat() + component->getClip().getBeat()) < endBeat)
@@ -1142,9 +1240,11 @@ void PianoRoll::selectEventsInRange(float startBeat, float endBeat, bool shouldC
 
 NoteComponent *PianoRoll::findNoteComponentAt(const Point<int> &point) const
 {
-    forEachEventComponent(this->patternMap, e)
+    Array<NoteComponent *> components;
+    this->findNoteComponentsInArea({ point, point }, components);
+
+    for (auto *component : components)
     {
-        auto *component = e.second.get();
         if (component->getBounds().contains(point))
         {
             return component;
@@ -1157,9 +1257,11 @@ NoteComponent *PianoRoll::findNoteComponentAt(const Point<int> &point) const
 void PianoRoll::findLassoItemsInArea(Array<SelectableComponent *> &itemsFound,
     const Rectangle<int> &rectangle)
 {
-    forEachEventComponent(this->patternMap, e)
+    Array<NoteComponent *> components;
+    this->findNoteComponentsInArea(rectangle, components);
+
+    for (auto *component : components)
     {
-        auto *component = e.second.get();
         if (component->isActiveAndEditable() &&
             rectangle.intersects(component->getBounds()))
         {
@@ -1172,9 +1274,11 @@ void PianoRoll::findLassoItemsInArea(Array<SelectableComponent *> &itemsFound,
 void PianoRoll::findLassoItemsInPolygon(Array<SelectableComponent *> &itemsFound,
     const Rectangle<int> &bounds, const Array<Point<float>> &polygon)
 {
-    forEachEventComponent(this->patternMap, e)
+    Array<NoteComponent *> components;
+    this->findNoteComponentsInArea(bounds, components);
+
+    for (auto *component : components)
     {
-        auto *component = e.second.get();
         if (!component->isActiveAndEditable() ||
             !bounds.intersects(component->getBounds())) // fast path
         {
@@ -2018,9 +2122,11 @@ void PianoRoll::startErasingEvents(const Point<float> &mousePosition)
 
 void PianoRoll::continueErasingEvents(const Point<float> &mousePosition)
 {
-    forEachEventComponent(this->patternMap, it)
+    Array<NoteComponent *> components;
+    this->findNoteComponentsInArea({ mousePosition.toInt(), mousePosition.toInt() }, components);
+
+    for (auto *nc : components)
     {
-        auto *nc = it.second.get();
         if (!nc->isActiveAndEditable() || !nc->isVisible())
         {
             continue;
@@ -2080,12 +2186,22 @@ void PianoRoll::continueCuttingEvents(const Point<float> &mousePosition)
         this->knifeToolHelper->setEndPosition(mousePosition);
         this->knifeToolHelper->updateBounds();
 
-        bool addsPoint;
+        const auto line = this->knifeToolHelper->getLine();
+        const auto lineBounds = Rectangle<float>(line.getStart(), line.getEnd()).getSmallestIntegerContainer();
+
+        Array<NoteComponent *> components;
+        this->findNoteComponentsInArea(lineBounds, components);
+
+        // the notes out of the line's bounds can't have the cut points,
+        // so only the existing ones need to be checked for them
+        Array<Note> previouslyCutNotes;
+        Array<float> previousCutBeats;
+        this->knifeToolHelper->getCutPoints(previouslyCutNotes, previousCutBeats);
+
+        FlatHashSet<MidiEvent::Id> cutNoteIds;
         Point<float> intersection;
-        forEachEventComponent(this->patternMap, e)
+        for (auto *nc : components)
         {
-            addsPoint = false;
-            auto *nc = e.second.get();
             if (!nc->isActiveAndEditable())
             {
                 continue;
@@ -2095,21 +2211,24 @@ void PianoRoll::continueCuttingEvents(const Point<float> &mousePosition)
             const Line<float> noteLine(nc->getPosition().translated(0, h2).toFloat(),
                 nc->getPosition().translated(nc->getWidth(), h2).toFloat());
 
-            if (this->knifeToolHelper->getLine().intersects(noteLine, intersection))
+            if (line.intersects(noteLine, intersection))
             {
                 const float relativeCutBeat = this->getRoundBeatSnapByXPosition(int(intersection.getX()))
                     - this->activeClip.getBeat() - nc->getBeat();
  
                 if (relativeCutBeat > 0.f && relativeCutBeat < nc->getLength())
                 {
-                    addsPoint = true;
+                    cutNoteIds.insert(nc->getNote().getId());
                     this->knifeToolHelper->addOrUpdateCutPoint(nc, relativeCutBeat);
                 }
             }
+        }
 
-            if (!addsPoint)
+        for (const auto &note : previouslyCutNotes)
+        {
+            if (!cutNoteIds.contains(note.getId()))
             {
-                this->knifeToolHelper->removeCutPointIfExists(nc->getNote());
+                this->knifeToolHelper->removeCutPointIfExists(note);
             }
         }
     }
@@ -2136,10 +2255,12 @@ void PianoRoll::startMergingEvents(const Point<float> &mousePosition)
 {
     this->deselectAll();
 
+    Array<NoteComponent *> components;
+    this->findNoteComponentsInArea({ mousePosition.toInt(), mousePosition.toInt() }, components);
+
     NoteComponent *targetNote = nullptr;
-    forEachEventComponent(this->patternMap, e)
+    for (auto *nc : components)
     {
-        auto *nc = e.second.get();
         if (nc->isActiveAndEditable() &&
             nc->getBounds().contains(mousePosition.toInt()))
         {
@@ -2162,10 +2283,12 @@ void PianoRoll::continueMergingEvents(const Point<float> &mousePosition)
         return;
     }
 
+    Array<NoteComponent *> components;
+    this->findNoteComponentsInArea({ mousePosition.toInt(), mousePosition.toInt() }, components);
+
     NoteComponent *targetNote = nullptr;
-    forEachEventComponent(this->patternMap, e)
+    for (auto *nc : components)
     {
-        auto *nc = e.second.get();
         if (nc->isActiveAndEditable() &&
             nc->getBounds().contains(mousePosition.toInt()) &&
             this->mergeToolHelper->canMergeInto(nc))
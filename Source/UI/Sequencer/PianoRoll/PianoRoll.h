@@ -120,6 +120,10 @@ public:
     void onChangeMidiEvent(const MidiEvent &oldEvent, const MidiEvent &newEvent) override;
     void onAddMidiEvent(const MidiEvent &event) override;
     void onRemoveMidiEvent(const MidiEvent &event) override;
+    void onAddMidiEvents(const Array<const MidiEvent *> &events) override;
+    void onChangeMidiEvents(const Array<const MidiEvent *> &oldEvents,
+        const Array<const MidiEvent *> &newEvents) override;
+    void onRemoveMidiEvents(const Array<const MidiEvent *> &events) override;
 
     void onAddClip(const Clip &clip) override;
     void onChangeClip(const Clip &oldClip, const Clip &newClip) override;
@@ -255,6 +259,14 @@ private:
     void switchToClipInViewport() const;
     int getYPositionByKey(int targetKey) const;
 
+    // uses the sequences' spatial indices instead of going through
+    // all note components; the results are only the candidates,
+    // the callers still check the exact bounds they need
+    void findNoteComponentsInArea(float startBeat, float endBeat,
+        int minKey, int maxKey, Array<NoteComponent *> &outComponents) const;
+    void findNoteComponentsInArea(const Rectangle<int> &area,
+        Array<NoteComponent *> &outComponents) const;
+
     UniquePointer<KnifeToolHelper> knifeToolHelper;
     void startCuttingEvents(const Point<float> &mousePosition);
     void continueCuttingEvents(const Point<float> &mousePosition);
@@ -1044,6 +1044,26 @@ void RollBase::onRemoveMidiEvent(const MidiEvent &event)
     }
 }
 
+// all events of a group belong to the same sequence, so they are all
+// of the same type, and the roll only needs to react once per group;
+// the subclasses handling the events themselves should override these too
+
+void RollBase::onAddMidiEvents(const Array<const MidiEvent *> &events)
+{
+    RollBase::onAddMidiEvent(*events.getFirst());
+}
+
+void RollBase::onChangeMidiEvents(const Array<const MidiEvent *> &oldEvents,
+    const Array<const MidiEvent *> &newEvents)
+{
+    RollBase::onChangeMidiEvent(*oldEvents.getFirst(), *newEvents.getFirst());
+}
+
+void RollBase::onRemoveMidiEvents(const Array<const MidiEvent *> &events)
+{
+    RollBase::onRemoveMidiEvent(*events.getFirst());
+}
+
 void RollBase::onChangeClip(const Clip &clip, const Clip &newClip)
 {
     if (this->isEnabled())
@@ -27,6 +27,8 @@ WaveformAudioMonitorComponent::WaveformAudioMonitorComponent(WeakReference<Audio
 
     if (this->audioMonitor != nullptr)
     {
+        this->audioMonitor->setTruePeakEnabled(true);
+        this->historyReadPosition = this->audioMonitor->getHistoryEnd();
         this->startTimerHz(30);
     }
 }
@@ -41,12 +43,27 @@ void WaveformAudioMonitorComponent::setTargetAnalyzer(WeakReference<AudioMonitor
     if (targetAnalyzer != nullptr)
     {
         this->audioMonitor = targetAnalyzer;
+        this->audioMonitor->setTruePeakEnabled(true);
+        this->historyReadPosition = this->audioMonitor->getHistoryEnd();
         this->startTimerHz(30);
     }
 }
 
 void WaveformAudioMonitorComponent::timerCallback()
 {
+    if (this->audioMonitor == nullptr)
+    {
+        return;
+    }
+
+    // e.g. the sidebars of the other open projects, which don't need
+    // to catch up with what was played while they were hidden
+    if (!this->isShowing())
+    {
+        this->historyReadPosition = this->audioMonitor->getHistoryEnd();
+        return;
+    }
+
     constexpr auto lastFrameIndex = WaveformAudioMonitorComponent::bufferSize - 1;
 
     // Shift buffers:
@@ -58,11 +75,35 @@ void WaveformAudioMonitorComponent::timerCallback()
         this->rmsBufferRight[i] = this->rmsBufferRight[i + 1];
     }
 
-    // Push next values:
-    this->peakBufferLeft[lastFrameIndex] = this->audioMonitor->getPeak(0);
-    this->peakBufferRight[lastFrameIndex] = this->audioMonitor->getPeak(1);
-    this->rmsBufferLeft[lastFrameIndex] = this->audioMonitor->getRootMeanSquare(0);
-    this->rmsBufferRight[lastFrameIndex] = this->audioMonitor->getRootMeanSquare(1);
+    // Push next values, combined from all the blocks played since the last frame:
+    float peakLeft = 0.f;
+    float peakRight = 0.f;
+    double squaresSumLeft = 0.0;
+    double squaresSumRight = 0.0;
+    int64 numSamples = 0;
+
+    int numFramesRead = 0;
+    while ((numFramesRead = this->audioMonitor->readHistory(this->historyReadPosition,
+        this->historyFrames, WaveformAudioMonitorComponent::maxFramesPerRead)) > 0)
+    {
+        for (int i = 0; i < numFramesRead; ++i)
+        {
+            const auto &frame = this->historyFrames[i];
+            const auto &left = frame.channels[0];
+            const auto &right = frame.channels[1];
+            // the inter-sample peaks are shown too, since they may clip in the DAC
+            peakLeft = jmax(peakLeft, left.truePeak);
+            peakRight = jmax(peakRight, right.truePeak);
+            squaresSumLeft += double(left.rms) * double(left.rms) * frame.numSamples;
+            squaresSumRight += double(right.rms) * double(right.rms) * frame.numSamples;
+            numSamples += frame.numSamples;
+        }
+    }
+
+    this->peakBufferLeft[lastFrameIndex] = peakLeft;
+    this->peakBufferRight[lastFrameIndex] = peakRight;
+    this->rmsBufferLeft[lastFrameIndex] = numSamples == 0 ? 0.f : float(sqrt(squaresSumLeft / double(numSamples)));
+    this->rmsBufferRight[lastFrameIndex] = numSamples == 0 ? 0.f : float(sqrt(squaresSumRight / double(numSamples)));
 
     if (this->peakBufferLeft[lastFrameIndex] > 0.f ||
         this->peakBufferRight[lastFrameIndex] > 0.f)
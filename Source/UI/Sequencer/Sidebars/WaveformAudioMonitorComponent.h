@@ -17,8 +17,7 @@
 
 #pragma once
 
-class AudioMonitor;
-
+#include "AudioMonitor.h"
 #include "ColourIDs.h"
 #include "SequencerLayout.h"
 
@@ -63,6 +62,10 @@ private:
 
     int emptyFramesCounter = bufferSize;
 
+    static constexpr auto maxFramesPerRead = 64;
+    AudioMonitor::HistoryFrame historyFrames[maxFramesPerRead];
+    int64 historyReadPosition = 0;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WaveformAudioMonitorComponent)
 
 };